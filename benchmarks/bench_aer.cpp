@@ -0,0 +1,88 @@
+#include <string>
+#include <sstream>
+#include <benchmark/benchmark.h>
+
+#include "framework/circuit.hpp"
+
+#include "quantum_task.hpp"
+#include "backends/simulators/AER/aer_helpers.hpp"
+#include "backends/simulators/AER/aer_adapters/aer_computation_adapter.hpp"
+#include "backends/simulators/AER/aer_adapters/aer_simulator_adapter.hpp"
+#include "bench_utils.hpp"
+
+using namespace cunqa;
+using namespace cunqa::sim;
+
+namespace {
+
+// Args: {n_qubits, n_layers}
+void BM_quantum_task_to_AER(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, 1024).dump());
+
+    for (auto _ : state) {
+        auto aer_quantum_task = quantum_task_to_AER(quantum_task);
+        benchmark::DoNotOptimize(aer_quantum_task);
+    }
+
+    state.SetItemsProcessed(state.iterations() * quantum_task.circuit.size());
+}
+BENCHMARK(BM_quantum_task_to_AER)
+    ->Args({4, 4})
+    ->Args({20, 50})
+    ->Args({30, 500})
+    ->Unit(benchmark::kMicrosecond);
+
+// Args: {n_clbits, n_keys}. AER reports counts with hexadecimal keys.
+void BM_convert_standard_results_Aer(benchmark::State& state)
+{
+    const int n_clbits = state.range(0);
+    JSON counts = JSON::object();
+    for (const auto& bitstring : bench::random_bitstrings(n_clbits, state.range(1))) {
+        std::ostringstream hex;
+        hex << "0x" << std::hex << std::stoull(bitstring, nullptr, 2);
+        counts[hex.str()] = 1;
+    }
+    JSON experiment = {{"data", {{"counts", counts}}}};
+    const JSON aer_result = {{"results", JSON::array({experiment})}};
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        JSON result = aer_result;
+        state.ResumeTiming();
+
+        convert_standard_results_Aer(result, n_clbits);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * counts.size());
+}
+BENCHMARK(BM_convert_standard_results_Aer)
+    ->Args({10, 1 << 10})
+    ->Args({30, 1 << 16})
+    ->Unit(benchmark::kMicrosecond);
+
+// Per-shot interpreter (execute_shot_) reached through the dynamic simulate().
+// Args: {n_qubits, n_layers, shots}; items/s is shots per second.
+void BM_AerSimulatorAdapter_execute_shot(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int shots = state.range(2);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, shots, true).dump());
+
+    AerComputationAdapter aer_ca(quantum_task);
+    AerSimulatorAdapter aer_sa(aer_ca);
+    for (auto _ : state) {
+        auto result = aer_sa.simulate();
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * shots);
+}
+BENCHMARK(BM_AerSimulatorAdapter_execute_shot)
+    ->Args({4, 4, 1000})
+    ->Args({16, 20, 100})
+    ->Unit(benchmark::kMillisecond);
+
+} // End of anonymous namespace
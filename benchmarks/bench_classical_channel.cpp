@@ -0,0 +1,69 @@
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "classical_channel/classical_channel.hpp"
+
+using namespace cunqa::comm;
+
+namespace {
+
+// Both channels live in the same process but, since every ClassicalChannel
+// owns its ZMQ context and binds a ROUTER on the node IP, the messages go
+// through the tcp transport, the same one used between QPUs of a node.
+struct ChannelPair {
+    ClassicalChannel a;
+    ClassicalChannel b;
+
+    ChannelPair()
+    {
+        a.connect(b.endpoint);
+        b.connect(a.endpoint);
+    }
+};
+
+ChannelPair& channel_pair()
+{
+    static ChannelPair pair;
+    return pair;
+}
+
+// One measure_and_send/recv exchange in each direction
+void BM_ClassicalChannel_measure_round_trip(benchmark::State& state)
+{
+    auto& [a, b] = channel_pair();
+
+    std::size_t shot = 0;
+    for (auto _ : state) {
+        a.send_measure(1, b.endpoint, shot);
+        benchmark::DoNotOptimize(b.recv_measure(a.endpoint, shot));
+        b.send_measure(0, a.endpoint, shot);
+        benchmark::DoNotOptimize(a.recv_measure(b.endpoint, shot));
+        shot++;
+    }
+
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ClassicalChannel_measure_round_trip)->Unit(benchmark::kMicrosecond);
+
+// Args: {payload bytes}
+void BM_ClassicalChannel_info_round_trip(benchmark::State& state)
+{
+    auto& [a, b] = channel_pair();
+    const std::string payload(state.range(0), 'x');
+
+    for (auto _ : state) {
+        a.send_info(payload, b.endpoint);
+        benchmark::DoNotOptimize(b.recv_info(a.endpoint));
+        b.send_info(payload, a.endpoint);
+        benchmark::DoNotOptimize(a.recv_info(b.endpoint));
+    }
+
+    state.SetBytesProcessed(state.iterations() * 2 * payload.size());
+}
+BENCHMARK(BM_ClassicalChannel_info_round_trip)
+    ->Arg(64)
+    ->Arg(4 << 10)
+    ->Arg(1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+} // End of anonymous namespace
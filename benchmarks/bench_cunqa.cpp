@@ -0,0 +1,58 @@
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "quantum_task.hpp"
+#include "backends/simulators/CUNQA/cunqa_adapters/cunqa_computation_adapter.hpp"
+#include "backends/simulators/CUNQA/cunqa_adapters/cunqa_simulator_adapter.hpp"
+#include "bench_utils.hpp"
+
+using namespace cunqa;
+using namespace cunqa::sim;
+
+namespace {
+
+// Per-shot interpreter (execute_shot_) reached through the dynamic simulate().
+// Args: {n_qubits, n_layers, shots}; items/s is shots per second.
+void BM_CunqaSimulatorAdapter_execute_shot(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int shots = state.range(2);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, shots, true).dump());
+
+    CunqaComputationAdapter cunqa_ca(quantum_task);
+    CunqaSimulatorAdapter cunqa_sa(cunqa_ca);
+    for (auto _ : state) {
+        auto result = cunqa_sa.simulate();
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * shots);
+}
+BENCHMARK(BM_CunqaSimulatorAdapter_execute_shot)
+    ->Args({4, 4, 1000})
+    ->Args({16, 20, 100})
+    ->Unit(benchmark::kMillisecond);
+
+// Static path (single Executor::run over all the shots), as reference for the above
+void BM_CunqaSimulatorAdapter_static(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int shots = state.range(2);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, shots).dump());
+
+    CunqaComputationAdapter cunqa_ca(quantum_task);
+    CunqaSimulatorAdapter cunqa_sa(cunqa_ca);
+    const Backend* no_backend = nullptr;
+    for (auto _ : state) {
+        auto result = cunqa_sa.simulate(no_backend);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * shots);
+}
+BENCHMARK(BM_CunqaSimulatorAdapter_static)
+    ->Args({4, 4, 1000})
+    ->Args({16, 20, 100})
+    ->Unit(benchmark::kMillisecond);
+
+} // End of anonymous namespace
@@ -0,0 +1,196 @@
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <benchmark/benchmark.h>
+
+#include "simulators/statevector/qubitvector.hpp"
+
+#include "backends/simulators/CUNQA/cunqa_adapters/statevector_kernels.hpp"
+
+using namespace cunqa::sim;
+
+namespace {
+
+using Complex = std::complex<double>;
+
+const kernels::Matrix2<double> RY = {std::cos(0.3), -std::sin(0.3), std::sin(0.3), std::cos(0.3)};
+const Complex RZ0 = std::exp(Complex(0.0, -0.3)), RZ1 = std::exp(Complex(0.0, 0.3));
+
+template<typename T = double>
+std::vector<std::complex<T>> initial_state(std::size_t n_qubits)
+{
+    std::vector<std::complex<T>> state(std::size_t(1) << n_qubits, std::complex<T>(0));
+    state[0] = 1;
+    return state;
+}
+
+AER::QV::QubitVector<double> aer_initial_state(std::size_t n_qubits)
+{
+    AER::QV::QubitVector<double> qv(n_qubits);
+    qv.initialize();
+    return qv;
+}
+
+// Dense 1q gate. Args: {n_qubits, qubit}; items/s is amplitudes per second.
+// Qubit 0 runs the in-vector shuffle kernel, higher qubits the strided one.
+void BM_kernels_apply_matrix(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), q = state.range(1);
+    auto sv = initial_state(n_qubits);
+
+    for (auto _ : state) {
+        kernels::apply_matrix(sv.data(), n_qubits, q, RY);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * sv.size());
+    state.SetLabel(std::string(kernels::isa_name(kernels::isa())));
+}
+BENCHMARK(BM_kernels_apply_matrix)
+    ->Args({20, 0})->Args({20, 1})->Args({20, 12})
+    ->Args({24, 0})->Args({24, 1})->Args({24, 20})
+    ->Unit(benchmark::kMillisecond);
+
+// Same gate on complex64 amplitudes ("precision": "single")
+void BM_kernels_apply_matrix_single(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), q = state.range(1);
+    auto sv = initial_state<float>(n_qubits);
+    const kernels::Matrix2<float> ry = {std::complex<float>(RY[0]), std::complex<float>(RY[1]), std::complex<float>(RY[2]), std::complex<float>(RY[3])};
+
+    for (auto _ : state) {
+        kernels::apply_matrix(sv.data(), n_qubits, q, ry);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * sv.size());
+}
+BENCHMARK(BM_kernels_apply_matrix_single)
+    ->Args({20, 0})->Args({20, 12})
+    ->Args({24, 0})->Args({24, 20})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_AER_apply_matrix(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), q = state.range(1);
+    auto qv = aer_initial_state(n_qubits);
+    // AER takes column-major matrices
+    const AER::cvector_t<double> matrix = {RY[0], RY[2], RY[1], RY[3]};
+
+    for (auto _ : state) {
+        qv.apply_matrix({q}, matrix);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * (std::size_t(1) << n_qubits));
+}
+BENCHMARK(BM_AER_apply_matrix)
+    ->Args({20, 0})->Args({20, 1})->Args({20, 12})
+    ->Args({24, 0})->Args({24, 1})->Args({24, 20})
+    ->Unit(benchmark::kMillisecond);
+
+// rz through the diagonal kernel. Args: {n_qubits, qubit}
+void BM_kernels_apply_diagonal(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), q = state.range(1);
+    auto sv = initial_state(n_qubits);
+
+    for (auto _ : state) {
+        kernels::apply_diagonal(sv.data(), n_qubits, q, RZ0, RZ1);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * sv.size());
+}
+BENCHMARK(BM_kernels_apply_diagonal)
+    ->Args({20, 0})->Args({20, 12})
+    ->Args({24, 0})->Args({24, 20})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_AER_apply_diagonal(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), q = state.range(1);
+    auto qv = aer_initial_state(n_qubits);
+
+    for (auto _ : state) {
+        qv.apply_diagonal_matrix(q, {RZ0, RZ1});
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * (std::size_t(1) << n_qubits));
+}
+BENCHMARK(BM_AER_apply_diagonal)
+    ->Args({20, 0})->Args({20, 12})
+    ->Args({24, 0})->Args({24, 20})
+    ->Unit(benchmark::kMillisecond);
+
+// Args: {n_qubits, control, target}
+void BM_kernels_apply_controlled_matrix(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), control = state.range(1), target = state.range(2);
+    auto sv = initial_state(n_qubits);
+
+    for (auto _ : state) {
+        kernels::apply_controlled_matrix(sv.data(), n_qubits, control, target, RY);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * sv.size());
+}
+BENCHMARK(BM_kernels_apply_controlled_matrix)
+    ->Args({20, 0, 1})->Args({20, 5, 12})
+    ->Args({24, 0, 1})->Args({24, 10, 20})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_AER_apply_controlled_matrix(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), control = state.range(1), target = state.range(2);
+    auto qv = aer_initial_state(n_qubits);
+    const AER::cvector_t<double> matrix = {RY[0], RY[2], RY[1], RY[3]};
+
+    for (auto _ : state) {
+        qv.apply_mcu({control, target}, matrix);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * (std::size_t(1) << n_qubits));
+}
+BENCHMARK(BM_AER_apply_controlled_matrix)
+    ->Args({20, 0, 1})->Args({20, 5, 12})
+    ->Args({24, 0, 1})->Args({24, 10, 20})
+    ->Unit(benchmark::kMillisecond);
+
+// Args: {n_qubits, control, target}
+void BM_kernels_apply_cx(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), control = state.range(1), target = state.range(2);
+    auto sv = initial_state(n_qubits);
+
+    for (auto _ : state) {
+        kernels::apply_cx(sv.data(), n_qubits, control, target);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * sv.size());
+}
+BENCHMARK(BM_kernels_apply_cx)
+    ->Args({20, 0, 1})->Args({24, 10, 20})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_AER_apply_cx(benchmark::State& state)
+{
+    const std::size_t n_qubits = state.range(0), control = state.range(1), target = state.range(2);
+    auto qv = aer_initial_state(n_qubits);
+
+    for (auto _ : state) {
+        qv.apply_mcx({control, target});
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * (std::size_t(1) << n_qubits));
+}
+BENCHMARK(BM_AER_apply_cx)
+    ->Args({20, 0, 1})->Args({24, 10, 20})
+    ->Unit(benchmark::kMillisecond);
+
+} // End of anonymous namespace
@@ -0,0 +1,31 @@
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+// Same as BENCHMARK_MAIN() but, unless told otherwise, the results are also
+// written as JSON to cunqa_bench.json so that runs can be compared over time
+// (e.g. with benchmark's tools/compare.py).
+int main(int argc, char** argv)
+{
+    std::vector<char*> args(argv, argv + argc);
+
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]).rfind("--benchmark_out=", 0) == 0)
+            has_out = true;
+
+    std::string out = "--benchmark_out=cunqa_bench.json";
+    std::string out_format = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out.data());
+        args.push_back(out_format.data());
+    }
+
+    int n_args = args.size();
+    benchmark::Initialize(&n_args, args.data());
+    if (benchmark::ReportUnrecognizedArguments(n_args, args.data()))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "quantum_task.hpp"
+#include "backends/simulators/Munich/munich_helpers.hpp"
+#include "backends/simulators/Munich/munich_adapters/quantum_computation_adapter.hpp"
+#include "backends/simulators/Munich/munich_adapters/munich_simulator_adapter.hpp"
+#include "bench_utils.hpp"
+
+using namespace cunqa;
+using namespace cunqa::sim;
+
+namespace {
+
+// Args: {n_qubits, n_layers}
+void BM_quantum_task_to_Munich(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, 1024).dump());
+
+    for (auto _ : state) {
+        auto qasm = quantum_task_to_Munich(quantum_task);
+        benchmark::DoNotOptimize(qasm);
+    }
+
+    state.SetItemsProcessed(state.iterations() * quantum_task.circuit.size());
+}
+BENCHMARK(BM_quantum_task_to_Munich)
+    ->Args({4, 4})
+    ->Args({20, 50})
+    ->Args({30, 500})
+    ->Unit(benchmark::kMicrosecond);
+
+// Per-shot interpreter (execute_shot_) reached through the dynamic simulate().
+// Args: {n_qubits, n_layers, shots}; items/s is shots per second.
+void BM_CircuitSimulatorAdapter_execute_shot(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int shots = state.range(2);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, state.range(1)), n_qubits, shots, true).dump());
+
+    CircuitSimulatorAdapter csa(std::make_unique<QuantumComputationAdapter>(quantum_task));
+    for (auto _ : state) {
+        auto result = csa.simulate();
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * shots);
+}
+BENCHMARK(BM_CircuitSimulatorAdapter_execute_shot)
+    ->Args({4, 4, 1000})
+    ->Args({16, 20, 100})
+    ->Unit(benchmark::kMillisecond);
+
+} // End of anonymous namespace
@@ -0,0 +1,94 @@
+#include <map>
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "quantum_task.hpp"
+#include "utils/helpers/reverse_bitstring.hpp"
+#include "bench_utils.hpp"
+
+using namespace cunqa;
+
+namespace {
+
+// Args: {n_qubits, n_layers}
+void BM_QuantumTask_update_circuit(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int n_layers = state.range(1);
+    const std::string message = bench::task_json(bench::random_circuit(n_qubits, n_layers), n_qubits, 1024).dump();
+
+    QuantumTask quantum_task;
+    for (auto _ : state) {
+        quantum_task.update_circuit(message);
+        benchmark::DoNotOptimize(quantum_task.circuit);
+    }
+
+    state.SetBytesProcessed(state.iterations() * message.size());
+    state.counters["instructions"] = quantum_task.circuit.size();
+}
+BENCHMARK(BM_QuantumTask_update_circuit)
+    ->Args({4, 4})
+    ->Args({20, 50})
+    ->Args({30, 500})
+    ->Unit(benchmark::kMicrosecond);
+
+// update_params_ is private; it is reached through update_circuit with a
+// {"params": [...]} message, exactly as QJob.upgrade_parameters does.
+void BM_QuantumTask_update_params(benchmark::State& state)
+{
+    const int n_qubits = state.range(0);
+    const int n_layers = state.range(1);
+    QuantumTask quantum_task(bench::task_json(bench::random_circuit(n_qubits, n_layers), n_qubits, 1024).dump());
+    const std::string message = bench::params_message(n_qubits, n_layers);
+
+    for (auto _ : state) {
+        quantum_task.update_circuit(message);
+        benchmark::DoNotOptimize(quantum_task.circuit);
+    }
+
+    state.SetItemsProcessed(state.iterations() * n_qubits * n_layers);
+}
+BENCHMARK(BM_QuantumTask_update_params)
+    ->Args({4, 4})
+    ->Args({20, 50})
+    ->Args({30, 500})
+    ->Unit(benchmark::kMicrosecond);
+
+// Args: {n_bits, n_keys}
+void BM_reverse_bitstring_keys_map(benchmark::State& state)
+{
+    std::map<std::string, std::size_t> counts;
+    for (const auto& key : bench::random_bitstrings(state.range(0), state.range(1)))
+        counts[key] = 1;
+
+    for (auto _ : state) {
+        reverse_bitstring_keys_json(counts);
+        benchmark::DoNotOptimize(counts);
+    }
+
+    state.SetItemsProcessed(state.iterations() * counts.size());
+}
+BENCHMARK(BM_reverse_bitstring_keys_map)
+    ->Args({10, 1 << 10})
+    ->Args({30, 1 << 16})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_reverse_bitstring_keys_json(benchmark::State& state)
+{
+    JSON result = {{"counts", JSON::object()}};
+    for (const auto& key : bench::random_bitstrings(state.range(0), state.range(1)))
+        result["counts"][key] = 1;
+
+    for (auto _ : state) {
+        reverse_bitstring_keys_json(result);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations() * result["counts"].size());
+}
+BENCHMARK(BM_reverse_bitstring_keys_json)
+    ->Args({10, 1 << 10})
+    ->Args({30, 1 << 16})
+    ->Unit(benchmark::kMicrosecond);
+
+} // End of anonymous namespace
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace bench {
+
+// Every benchmark builds its inputs from a fixed seed so that two runs of the
+// suite measure exactly the same work.
+constexpr std::uint64_t SEED = 1234;
+
+// Layered circuit: one random rotation per qubit followed by a brick of CX
+// gates, closed by a measurement of every qubit on the clbit with its index.
+inline JSON random_circuit(const int n_qubits, const int n_layers, const std::uint64_t seed = SEED)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+    const std::vector<std::string> rotations = {"rx", "ry", "rz"};
+
+    JSON instructions = JSON::array();
+    for (int layer = 0; layer < n_layers; ++layer) {
+        for (int q = 0; q < n_qubits; ++q) {
+            instructions.push_back({
+                {"name", rotations[rng() % rotations.size()]},
+                {"qubits", JSON::array({q})},
+                {"params", JSON::array({angle(rng)})}
+            });
+        }
+        for (int q = layer % 2; q + 1 < n_qubits; q += 2) {
+            instructions.push_back({
+                {"name", "cx"},
+                {"qubits", JSON::array({q, q + 1})}
+            });
+        }
+    }
+    for (int q = 0; q < n_qubits; ++q) {
+        instructions.push_back({
+            {"name", "measure"},
+            {"qubits", JSON::array({q})},
+            {"clbits", JSON::array({q})}
+        });
+    }
+    return instructions;
+}
+
+// Same message the python QJob sends to a QPU (see QJob._configure)
+inline JSON task_json(const JSON& instructions, const int n_qubits, const int shots, const bool is_dynamic = false)
+{
+    return {
+        {"id", "bench"},
+        {"config", {
+            {"shots", shots},
+            {"method", "statevector"},
+            {"avoid_parallelization", false},
+            {"num_qubits", n_qubits},
+            {"num_clbits", n_qubits},
+            {"seed", 123123}
+        }},
+        {"instructions", instructions},
+        {"sending_to", JSON::array()},
+        {"is_dynamic", is_dynamic},
+        {"has_cc", false}
+    };
+}
+
+// Same message QJob.upgrade_parameters sends, one value per rotation of random_circuit
+inline std::string params_message(const int n_qubits, const int n_layers, const std::uint64_t seed = SEED)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+    std::vector<double> params(static_cast<std::size_t>(n_qubits) * n_layers);
+    for (auto& param : params)
+        param = angle(rng);
+
+    JSON message = {{"params", params}};
+    return message.dump();
+}
+
+// Bitstrings of width n_bits with n_keys distinct values, as the simulators
+// produce them. n_keys cannot exceed 2^n_bits.
+inline std::vector<std::string> random_bitstrings(const int n_bits, const std::size_t n_keys, const std::uint64_t seed = SEED)
+{
+    std::mt19937_64 rng(seed);
+    std::unordered_set<std::string> drawn;
+    std::vector<std::string> keys;
+    keys.reserve(n_keys);
+    while (keys.size() < n_keys) {
+        std::string key(n_bits, '0');
+        for (auto& bit : key)
+            bit = (rng() & 1) ? '1' : '0';
+        if (drawn.insert(key).second)
+            keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+} // End of bench namespace
+} // End of cunqa namespace
@@ -0,0 +1,15 @@
+#include "logger.hpp"
+#include <string>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+using namespace std::literals;
+
+std::shared_ptr<spdlog::logger> logger;
+
+__attribute__((constructor)) void initializeLogger() {
+    // Benchmark logger initialization. Only warnings, so that logging does not
+    // end up in the measurements.
+    logger = spdlog::stdout_color_mt("bench_logger");
+    logger->set_level(spdlog::level::warn);
+    logger->set_pattern("(%D %r) [BENCH] %^%l: %v %$"s);
+}
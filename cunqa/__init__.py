@@ -1,4 +1,4 @@
-from cunqa.qjob import QJob, gather
+from cunqa.qjob import QJob, QJobBatch, QJobSharded, CircuitHandle, gather
 from cunqa.qutils import get_QPUs
 from cunqa.transpile import transpiler
-from cunqa.mappers import QJobMapper, QPUCircuitMapper
\ No newline at end of file
+from cunqa.mappers import QJobMapper, QPUCircuitMapper, run_sharded
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 
 #include "comm/client.hpp"
+#include "comm/sharded_run.hpp"
+#include "comm/dispatcher.hpp"
  
 namespace py = pybind11;
 using namespace cunqa::comm;
@@ -12,6 +15,13 @@ PYBIND11_MODULE(qclient, m) {
  
     py::class_<FutureWrapper<Client>>(m, "FutureWrapper")
         .def("get", &FutureWrapper<Client>::get)
+        // Result as a uint8 numpy array that owns the received message, so that
+        // binary result frames can be decoded without copying
+        .def("get_buffer", [](FutureWrapper<Client> &f) {
+            auto result = new std::string(f.get());
+            py::capsule owner(result, [](void *p) { delete static_cast<std::string*>(p); });
+            return py::array_t<std::uint8_t>(result->size(), reinterpret_cast<const std::uint8_t*>(result->data()), owner);
+        })
         .def("valid", &FutureWrapper<Client>::valid);
 
     py::class_<Client>(m, "QClient")
@@ -29,4 +39,34 @@ PYBIND11_MODULE(qclient, m) {
         .def("send_parameters", [](Client &c, const std::string& parameters) { 
             return FutureWrapper<Client>(c.send_parameters(parameters)); 
         });
+
+    // The clients stay referenced by the list kept alive with the run
+    py::class_<ShardedRun>(m, "ShardedRun")
+        .def(py::init<const std::vector<Client*>&, const std::string&>(), py::keep_alive<1, 2>())
+        .def("get_buffer", [](ShardedRun &r) {
+            std::string* result;
+            {
+                py::gil_scoped_release release;
+                result = new std::string(r.get());
+            }
+            py::capsule owner(result, [](void *p) { delete static_cast<std::string*>(p); });
+            return py::array_t<std::uint8_t>(result->size(), reinterpret_cast<const std::uint8_t*>(result->data()), owner);
+        });
+
+    py::class_<Dispatcher>(m, "Dispatcher")
+        .def(py::init<const std::vector<Client*>&, const std::vector<std::string>&, std::size_t>(), py::keep_alive<1, 2>(),
+             py::arg("clients"), py::arg("templates"), py::arg("max_batch") = 8)
+        // Results as bytes, to be decoded as the ones of FutureWrapper.get_buffer
+        .def("map", [](Dispatcher &d, const std::vector<std::string>& items) {
+            std::vector<std::string> results;
+            {
+                py::gil_scoped_release release;
+                results = d.map(items);
+            }
+            py::list buffers;
+            for (const auto& result : results)
+                buffers.append(py::bytes(result));
+            return buffers;
+        })
+        .def("assignment", &Dispatcher::assignment);
 }
\ No newline at end of file
@@ -57,7 +57,9 @@ from cunqa.logger import logger
 from cunqa.qjob import gather
 from cunqa.circuit import CunqaCircuit
 from cunqa.qpu import QPU
-from cunqa.qjob import QJob
+from cunqa.qjob import QJob, QJobSharded, QJobError
+from cunqa.qclient import Dispatcher
+from cunqa.result import Result, decode_result
 
 from qiskit import QuantumCircuit
 from qiskit.exceptions import QiskitError
@@ -67,6 +69,8 @@ from typing import  Optional, Union, Any
 
 import time
 import copy
+import json
+import uuid
 
 
 def run_distributed(circuits: "list[Union[dict, 'CunqaCircuit']]", qpus: "list['QPU']", **run_args: Any) -> "list[QJob]":
@@ -77,6 +81,11 @@ def run_distributed(circuits: "list[Union[dict, 'CunqaCircuit']]", qpus: "list['
     Because the function is destined for executions that require communications, only :py:class:`~cunqa.circuit.CunqaCircuit` or instruction sets are accepted.
     The arguments provided will be the same for all :py:class:`~cunqa.qjob.QJob` objects created.
     
+    With the Cunqa simulator, the shots of circuits that receive measurements from other QPUs run interleaved, so that the
+    simulation of some overlaps the wait of others; `cc_shots_in_flight` sets how many run at the same time (4 by default, 1
+    keeps them one after another). With `cc_shot_batch` they run instead in lockstep batches of that size, and each
+    `measure_and_send` sends the measurements of the whole batch as one message.
+
     .. warning::
         If *transpile*, *initial_layout* or *opt_level* are passed as *run_args* they will be ignored since for the current version
         transpilation is not supported when communications are present.
@@ -160,11 +169,58 @@ def run_distributed(circuits: "list[Union[dict, 'CunqaCircuit']]", qpus: "list['
     return distributed_qjobs
 
 
+def run_sharded(circuit: Union[dict, 'CunqaCircuit', 'QuantumCircuit'], qpus: "list['QPU']", transpile: Union[bool, str] = False, initial_layout: Optional["list[int]"] = None, opt_level: int = 1, **run_parameters: Any) -> QJobSharded:
+    """
+    Function to split the `shots` of one circuit among several virtual QPUs, typically all the ones of a family, so that the
+    sampling throughput grows with the number of QPUs:
+
+    >>> qpus = get_QPUs(family = "my_family")
+    >>> qjob = run_sharded(circuit, qpus, shots = 10**8)
+    >>> qjob.result.counts
+
+    Each QPU runs an even share of the shots with a seed derived from `seed`, and the shards are sent at once so they are simulated
+    concurrently. Their counts (and per-shot memory, if requested) are merged into one :py:class:`~cunqa.result.Result`, whose
+    time taken is the one of the slowest shard. The statistics of a sampled `cost` are pooled over the shards, except the CVaR,
+    which needs the whole distribution: sharded runs do not take a `cost` with ``"cvar"``.
+
+    Args:
+        circuit (dict | qiskit.QuantumCircuit | ~cunqa.circuit.CunqaCircuit): circuit to be sampled.
+
+        qpus (list[~cunqa.qpu.QPU]): QPU objects associated to the virtual QPUs that run the shards, all with the same simulator.
+
+        transpile (bool | str), initial_layout (list[int]), opt_level (int): transpilation, as in :py:meth:`~cunqa.qpu.QPU.run`,
+        with respect to the backend of the first QPU.
+
+        run_parameters: simulation instructions for the whole run, as in :py:meth:`~cunqa.qpu.QPU.run`.
+
+    Return:
+        A :py:class:`~cunqa.qjob.QJobSharded` object whose result is the merged result.
+    """
+    if len(qpus) == 0:
+        logger.error(f"At least one QPU is needed to run the shards [{ValueError.__name__}].")
+        raise SystemExit # User's level
+
+    circuit = qpus[0]._prepare(circuit, transpile, initial_layout, opt_level, run_parameters)
+    for qpu in qpus[1:]:
+        qpu._connect()
+
+    try:
+        qjob = QJob(qpus[0]._qclient, qpus[0]._backend, circuit, **run_parameters)
+        sharded = QJobSharded([qpu._qclient for qpu in qpus], qjob)
+        logger.debug(f"Circuit sharded over {len(qpus)} QPUs.")
+    except QJobError:
+        logger.error("Error when submitting the shards.")
+        raise SystemExit # User's level
+
+    return sharded
+
+
 class QJobMapper:
     """
     Class to map the method :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` to a set of jobs sent to virtual QPUs.
 
-    The core of the class is on its :py:meth:`~cunqa.mappers.QJobMapper.__call__` method, to which parameters that the method :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` takes are passed toguether with a cost function, so that a the value for this cost for each initial :py:class:`~cunqa.qjob.QJob` is returned.
+    The core of the class is on its :py:meth:`~cunqa.mappers.QJobMapper.__call__` method, to which parameters that the method :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` takes are passed toguether with a cost function, so that the value of this cost for each parameter vector is returned.
+    All the jobs must hold the same circuit, as each vector runs on whichever of their virtual QPUs is free first.
 
     An example is shown below, once we have a list of :py:class:`~cunqa.qjob.QJob` objects as *qjobs*:
 
@@ -185,25 +241,56 @@ class QJobMapper:
     We intuitively see how convinient this class can be for optimization algorithms: one has a parametric circuit to which updated sets of parameters can be sent
     obtaining the value of the cost back. Examples applied to optimizations are shown at the `Examples gallery <https://cesga-quantum-spain.github.io/cunqa/_examples/Optimizers_II_mapping.html>`_.
 
+    The population is evaluated by a work-stealing dispatcher: the circuit of the jobs is registered once at each virtual QPU, and every
+    QPU takes the next parameter vectors (several per message while many are left) as soon as it answers the previous ones. The population
+    can then be larger than the number of jobs, and a slow QPU evaluates fewer members instead of delaying the whole population.
+
     """
     qjobs: "list['QJob']" #: List of jobs that are mapped.
+    max_batch: int #: Maximum number of parameter vectors sent to a virtual QPU in one message.
 
-    def __init__(self, qjobs: "list['QJob']"):
+    def __init__(self, qjobs: "list['QJob']", max_batch: int = 8):
         """
         Class constructor.
 
         Args:
-            qjobs (list[~cunqa.qjob.QJob]): list of :py:class:`~cunqa.qjob.QJob` objects to be mapped.
+            qjobs (list[~cunqa.qjob.QJob]): list of :py:class:`~cunqa.qjob.QJob` objects to be mapped, all with the same circuit. At most one job
+            per virtual QPU is used.
+
+            max_batch (int): maximum number of parameter vectors sent to a virtual QPU in one message.
 
         """
+        if len({_circuit_structure(qjob) for qjob in qjobs}) > 1:
+            logger.error(f"The jobs of a QJobMapper must hold the same circuit, their parameters aside [{ValueError.__name__}].")
+            raise SystemExit # User's level
         self.qjobs = qjobs
+        self.max_batch = max_batch
+        self._dispatcher = None
+        self._qjobs_used = []
         logger.debug(f"QJobMapper initialized with {len(qjobs)} QJobs.")
 
+    def _build_dispatcher(self) -> None:
+        """Registers the circuit of the first job of each virtual QPU there, once its pending result is received."""
+        client_id = uuid.uuid4().hex
+        qclients, templates = [], []
+        for qjob in self.qjobs:
+            if any(qjob._qclient is qclient for qclient in qclients):
+                continue
+            handle, client = qjob._handle, qjob._client
+            if handle is None:
+                qjob.result # the reply to the submission must be received before registering
+                handle, client = qjob._register(client_id, None).handle, client_id
+            qclients.append(qjob._qclient)
+            templates.append(json.dumps({"handle": handle, "client": client}))
+            self._qjobs_used.append(qjob)
+        self._dispatcher = Dispatcher(qclients, templates, self.max_batch)
+
     def __call__(self, func, population):
         """
         Callable method to map the function *func* to the results of assigning *population* to the given jobs.
-        Regarding the *population*, each set of parameters will be assigned to each :py:class:`~cunqa.qjob.QJob` object, so the list must
-        have size (*N,p*), being *N* the lenght of :py:attr:`~cunqa.mappers.QJobMapper.qjobs` and *p* the number of parameters in the circuit.
+        Regarding the *population*, each set of parameters is run once, on whichever virtual QPU is free first, so the list has size (*N,p*),
+        being *N* any number of members and *p* the number of parameters in the circuit, which are assigned as in
+        :py:meth:`~cunqa.qjob.QJob.upgrade_parameters`. The :py:class:`~cunqa.qjob.QJob` objects themselves are not updated.
         Mainly, this is thought for the function to take a :py:class:`~cunqa.result.Result` object and to return a value.
         For example, the function can evaluate the expected value of an observable from the output of the circuit.
 
@@ -215,15 +302,14 @@ class QJobMapper:
         Return:
             List of outputs of the function applied to the results of each job for the given population.
         """
-        qjobs_ = []
-        for i, params in enumerate(population):
-            qjob = self.qjobs[i]
-            logger.debug(f"Uptading params for QJob {qjob}...")
-            qjob.upgrade_parameters(params.tolist())
-            qjobs_.append(qjob)
+        if self._dispatcher is None:
+            self._build_dispatcher()
 
-        logger.debug("About to gather results ...")
-        results = gather(qjobs_) # we only gather the qjobs we upgraded.
+        items = [json.dumps({"params": np.asarray(params, dtype = float).tolist()}) for params in population]
+        logger.debug(f"About to evaluate {len(items)} parameter sets on {len(self._qjobs_used)} QPUs ...")
+        buffers = self._dispatcher.map(items)
+        qjob = self._qjobs_used[0]
+        results = [_mapped_result(buffer, qjob._circuit_id, qjob._cregisters) for buffer in buffers]
 
         return [func(result) for result in results]
 
@@ -258,7 +344,9 @@ class QPUCircuitMapper:
     >>> 
     >>> cost_values = mapper(cost_function, new_parameters)
 
-    For each call of the mapper, circuits are assembled, jobs are sent, results are gathered and cost values are calculated.
+    For each call of the mapper, circuits are assembled, sent by a work-stealing dispatcher (each virtual QPU takes the next circuits, several
+    per message while many are left, as soon as it answers the previous ones) and cost values are calculated on their results. The population
+    can be larger than the number of QPUs, and a slow QPU simulates fewer circuits instead of delaying the whole population.
     Its implementation for optimization problems is shown at the `Examples gallery <https://cesga-quantum-spain.github.io/cunqa/_examples/Optimizers_II_mapping.html>`_.
 
     """
@@ -268,7 +356,7 @@ class QPUCircuitMapper:
     initial_layout: Optional["list[int]"] #: Transpilation information, qubits of the backend to which the qubits of the circuit are mapped.
     run_parameters: Optional[Any] #: Any other run instructions needed for the simulation.
 
-    def __init__(self, qpus: "list['QPU']", circuit: Union[dict,'QuantumCircuit','CunqaCircuit'], transpile: Optional[bool] = False, initial_layout: Optional["list[int]"] = None, **run_parameters: Any):
+    def __init__(self, qpus: "list['QPU']", circuit: Union[dict,'QuantumCircuit','CunqaCircuit'], transpile: Optional[bool] = False, initial_layout: Optional["list[int]"] = None, max_batch: int = 8, **run_parameters: Any):
         """
         Class constructor.
 
@@ -281,10 +369,14 @@ class QPUCircuitMapper:
 
             initial_layout (list[int]): Initial position of virtual qubits on physical qubits for transpilation.
 
+            max_batch (int): maximum number of circuits sent to a virtual QPU in one message.
+
             **run_parameters : any other simulation instructions.
 
         """
         self.qpus = qpus
+        self.max_batch = max_batch
+        self._dispatcher = None
 
         if isinstance(circuit, QuantumCircuit):
             self.circuit = circuit
@@ -302,8 +394,9 @@ class QPUCircuitMapper:
     def __call__(self, func, population):
         """
         Callable method to map the function *func* to the results of the circuits sent to the given QPUs after assigning them *population*.
-        Regarding the *population*, each set of parameters will be assigned to each circuit, so the list must
-        have size (*N,p*), being *N* the lenght of :py:attr:`~cunqa.mappers.QJobMapper.qpus` and *p* the number of parameters in the circuit.
+        Regarding the *population*, each set of parameters will be assigned to a circuit, so the list must
+        have size (*N,p*), being *N* any number of members and *p* the number of parameters in the circuit. With `transpile`, circuits
+        are transpiled for the backend of the first QPU, as all of them are meant to have the same one.
         Mainly, this is thought for the function to take a :py:class:`~cunqa.result.Result` object and to return a value.
         For example, the function can evaluate the expected value of an observable from the output of the circuit.
 
@@ -316,20 +409,23 @@ class QPUCircuitMapper:
             List of the results of the function applied to the output of the circuits sent to the QPUs.
         """
 
-        qjobs = []
-
         try:
             tick = time.time()
-            for i, params in enumerate(population):
-                qpu = self.qpus[i % len(self.qpus)]
-                circuit_assembled = self.circuit.assign_parameters(params)
-
-                logger.debug(f"Sending QJob to QPU {qpu._id}...")
-                qjobs.append(qpu.run(circuit_assembled, transpile = self.transpile, initial_layout = self.initial_layout, **self.run_parameters))
-
-            
-            logger.debug(f"About to gather {len(qjobs)} results ...")
-            results = gather(qjobs)
+            if self._dispatcher is None:
+                for qpu in self.qpus:
+                    qpu._connect()
+                self._dispatcher = Dispatcher([qpu._qclient for qpu in self.qpus], ["{}"] * len(self.qpus), self.max_batch)
+
+            qpu = self.qpus[0]
+            qjobs = []
+            for params in population:
+                run_parameters = dict(self.run_parameters)
+                circuit_assembled = qpu._prepare(self.circuit.assign_parameters(params), self.transpile, self.initial_layout, 1, run_parameters)
+                qjobs.append(QJob(qpu._qclient, qpu._backend, circuit_assembled, **run_parameters))
+
+            logger.debug(f"About to evaluate {len(qjobs)} circuits on {len(self.qpus)} QPUs ...")
+            buffers = self._dispatcher.map([qjob._execution_config for qjob in qjobs])
+            results = [_mapped_result(buffer, qjob._circuit_id, qjob._cregisters) for buffer, qjob in zip(buffers, qjobs)]
             tack = time.time()
             median = sum([res.time_taken for res in results])/len(results)
 
@@ -345,4 +441,24 @@ class QPUCircuitMapper:
         
         except Exception as error:
             logger.error(f"Some error occurred with the circuit [{type(error).__name__}]: {error}")
-            raise SystemExit # User's level
\ No newline at end of file
+            raise SystemExit # User's level
+
+
+def _circuit_structure(qjob: QJob) -> str:
+    """Circuit of a job without its parameters: its id or, for circuits without one, its instructions."""
+    structure = {"num_qubits": qjob.num_qubits, "num_clbits": qjob.num_clbits, "registers": qjob._cregisters}
+    if qjob._circuit_id or qjob._handle is not None:
+        structure["id"] = qjob._circuit_id
+    else:
+        instructions = json.loads(qjob._execution_config)["instructions"]
+        structure["instructions"] = [{k: v for k, v in instruction.items() if k != "params"} for instruction in instructions]
+    return json.dumps(structure, sort_keys = True)
+
+
+def _mapped_result(buffer: bytes, circuit_id: str, registers: dict) -> Result:
+    """:py:class:`~cunqa.result.Result` of one item evaluated by the dispatcher of the mappers."""
+    result = decode_result(buffer)
+    if "ERROR" in result:
+        logger.error(f"Error during the simulation of a member of the population: {result['ERROR']}")
+        raise SystemExit # User's level
+    return Result(result, circuit_id, registers = registers)
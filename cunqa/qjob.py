@@ -37,14 +37,51 @@ from cunqa.circuit import CunqaCircuit
 from cunqa.circuit.converters import convert, _registers_dict
 from cunqa.logger import logger
 from cunqa.backend import Backend
-from cunqa.result import Result
-from cunqa.qclient import QClient, FutureWrapper
+from cunqa.result import Result, decode_result
+from cunqa.qclient import QClient, FutureWrapper, ShardedRun
 
 
 class QJobError(Exception):
     """Exception for error during job submission to virtual QPUs."""
     pass
 
+class CircuitHandle:
+    """
+    Circuit registered at a virtual QPU with :py:meth:`~cunqa.qpu.QPU.register`.
+
+    The virtual QPU keeps the circuit already decoded, so running it with :py:meth:`~cunqa.qpu.QPU.run` only sends this handle plus
+    the `params`, `shots` and `seed` that change between runs:
+
+        >>> ansatz = qpu.register(circuit, shots = 2000)
+        >>> qpu.run(ansatz, params = [0.1, 0.2]).result
+        >>> qpu.run(ansatz, params = [0.3, 0.4], seed = 7).result
+
+    Every client can keep a limited number of circuits at a virtual QPU, beyond it the least recently used one is evicted and running
+    its handle returns an error. :py:meth:`~cunqa.qpu.QPU.release` frees a circuit that is no longer needed. Only the client that
+    registered a circuit can run, update or release it.
+    """
+    handle: str #: Handle assigned by the virtual QPU.
+    qpu_id: str #: Id of the :py:class:`~cunqa.qpu.QPU` the circuit is registered at.
+    client: str #: Client that registered the circuit, sent with the handle.
+    circuit_id: str
+    num_qubits: int
+    num_clbits: int
+    registers: dict
+    num_params: Optional[int] #: Number of parameters that :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` assigns.
+
+    def __init__(self, handle: str, qpu_id: str, client: str, circuit_id: str, num_qubits: int, num_clbits: int, registers: dict, num_params: Optional[int] = None):
+        self.handle = handle
+        self.qpu_id = qpu_id
+        self.client = client
+        self.circuit_id = circuit_id
+        self.num_qubits = num_qubits
+        self.num_clbits = num_clbits
+        self.registers = registers
+        self.num_params = num_params
+
+    def __repr__(self):
+        return f"CircuitHandle({self.handle}, qpu={self.qpu_id})"
+
 class QJob:
     """
     Class to handle jobs sent to virtual QPUs.
@@ -168,6 +205,8 @@ class QJob:
     _result: Optional['Result']
     _circuit_id: str 
     _sending_to: "list[str]"
+    _handle: Optional[str]
+    _client: Optional[str]
     _is_dynamic: bool
     _has_cc:bool
     _has_qc:bool
@@ -202,6 +241,8 @@ class QJob:
         self._future: 'FutureWrapper' = None
         self._result: Optional['Result'] = None
         self._circuit_id: str = ""
+        self._handle: Optional[str] = None
+        self._client: Optional[str] = None
 
         self._convert_circuit(circuit)
         self._configure(**run_parameters)
@@ -225,14 +266,14 @@ class QJob:
             if self._future is not None and self._future.valid():
                 if self._result is not None:
                     if not self._updated: # if the result was already obtained, we only call the server if an update was done
-                        res = self._future.get()
-                        self._result = Result(json.loads(res), circ_id=self._circuit_id, registers=self._cregisters)
+                        res = self._future.get_buffer()
+                        self._result = Result(decode_result(res), circ_id=self._circuit_id, registers=self._cregisters)
                         self._updated = True
                     else:
                         pass
                 else:
-                    res = self._future.get()
-                    self._result = Result(json.loads(res), self._circuit_id, registers=self._cregisters)
+                    res = self._future.get_buffer()
+                    self._result = Result(decode_result(res), self._circuit_id, registers=self._cregisters)
                     self._updated = True
             else:
                 logger.debug(f"self._future is None or non-valid, None is returned.")
@@ -313,7 +354,10 @@ class QJob:
         if isinstance(parameters, list):
 
             if all(isinstance(param, (int, float)) for param in parameters):  # Check if all elements are real numbers
-                message = """{{"params":{} }}""".format(parameters).replace("'", '"')
+                if self._handle is not None:
+                    message = json.dumps({"handle": self._handle, "client": self._client, "params": parameters})
+                else:
+                    message = """{{"params":{} }}""".format(parameters).replace("'", '"')
 
             else:
                 logger.error(f"Parameters must be real numbers [{ValueError.__name__}].")
@@ -332,9 +376,40 @@ class QJob:
         
         self._updated = False # We indicate that new results will come, in order to call server
 
-    def _convert_circuit(self, circuit: Union[str, dict, 'CunqaCircuit', 'QuantumCircuit']) -> None:
+    def _register(self, client: str, qpu_id: str) -> CircuitHandle:
+        """Registers the circuit of the job at the virtual QPU instead of running it, see :py:meth:`~cunqa.qpu.QPU.register`."""
+        message = json.loads(self._execution_config)
+        message["register"] = True
+        message["client"] = client
         try:
-            if isinstance(circuit, dict):
+            reply = decode_result(self._qclient.send_circuit(json.dumps(message)).get_buffer())
+        except Exception as error:
+            logger.error(f"Some error occured when registering the circuit [{type(error).__name__}].")
+            raise QJobError
+        if "ERROR" in reply:
+            logger.error(f"The virtual QPU could not register the circuit: {reply['ERROR']} [{QJobError.__name__}].")
+            raise QJobError
+        return CircuitHandle(reply["handle"], qpu_id, client, self._circuit_id, self.num_qubits, self.num_clbits, self._cregisters, reply.get("num_params"))
+
+    def _convert_circuit(self, circuit: Union[str, dict, 'CunqaCircuit', 'QuantumCircuit', CircuitHandle]) -> None:
+        try:
+            if isinstance(circuit, CircuitHandle):
+
+                logger.debug("A registered circuit was provided.")
+
+                self.num_qubits = circuit.num_qubits
+                self.num_clbits = circuit.num_clbits
+                self._cregisters = circuit.registers
+                self._circuit_id = circuit.circuit_id
+                self._handle = circuit.handle
+                self._client = circuit.client
+                self._sending_to = []
+                self._is_dynamic = False
+                self._has_cc = False
+                self._has_qc = False
+                instructions = None
+
+            elif isinstance(circuit, dict):
 
                 logger.debug("A circuit dict was provided.")
 
@@ -441,6 +516,17 @@ class QJob:
             raise QJobError # I capture the error in QPU.run() when creating the job
 
     def _configure(self, **run_parameters: Any) -> None:
+        # registered circuits only take what changes between runs
+        if self._handle is not None:
+            exec_config = {"handle": self._handle, "client": self._client}
+            for k, v in run_parameters.items():
+                if k in ("params", "shots", "seed", "gradient"):
+                    exec_config[k] = v
+                else:
+                    logger.warning(f"Run parameter {k} is ignored for registered circuits, it was fixed when registering.")
+            self._execution_config = json.dumps(exec_config)
+            return
+
         # configuration
         try:
             # config dict
@@ -485,6 +571,98 @@ class QJob:
         
 
 
+class QJobBatch:
+    """
+    Several circuits sent to a virtual QPU in one message with :py:meth:`~cunqa.qpu.QPU.run_batch`, executed together and
+    answered with one :py:class:`~cunqa.result.Result` per circuit, in the order they were given.
+
+    With the Cunqa simulator, circuits made of gates followed by measurements that start with the same instructions, as the
+    basis rotations of tomography, classical shadows or grouped Pauli measurements appended to one state preparation, simulate
+    their common prefixes only once; :py:attr:`info` reports how many of their instructions were actually simulated.
+    """
+    _qclient: 'QClient'
+    _qjobs: "list[QJob]"
+    _future: 'FutureWrapper'
+    _results: "Optional[list[Result]]"
+    _info: dict
+
+    def __init__(self, qclient: 'QClient', qjobs: "list[QJob]"):
+        self._qclient = qclient
+        self._qjobs = qjobs
+        self._future = None
+        self._results = None
+        self._info = {}
+
+    def submit(self) -> None:
+        """Asynchronous method to send the circuits of the batch to the virtual QPU."""
+        if self._future is not None:
+            logger.warning("QJobBatch has already been submitted.")
+            return
+        try:
+            message = '{"batch": [' + ", ".join(qjob._execution_config for qjob in self._qjobs) + ']}'
+            self._future = self._qclient.send_circuit(message)
+        except Exception as error:
+            logger.error(f"Some error occured when submitting the batch [{type(error).__name__}].")
+            raise QJobError
+
+    @property
+    def result(self) -> "list['Result']":
+        """Results of the circuits of the batch, in order. This is a blocking call, as :py:attr:`QJob.result`."""
+        if self._results is None:
+            if self._future is None:
+                logger.error(f"No QJobBatch submited [{QJobError.__name__}].")
+                raise SystemExit # User's level
+            reply = decode_result(self._future.get_buffer())
+            if "ERROR" in reply:
+                logger.error(f"Error during the simulation of the batch: {reply['ERROR']}")
+                raise SystemExit # User's level
+            self._info = {k: v for k, v in reply.items() if k != "results"}
+            self._results = [Result(res, qjob._circuit_id, registers=qjob._cregisters) for res, qjob in zip(reply["results"], self._qjobs)]
+        return self._results
+
+    @property
+    def info(self) -> dict:
+        """Information about the execution of the whole batch, such as ``"prefix_sharing"``, available once the result is received."""
+        self.result
+        return self._info
+
+
+class QJobSharded:
+    """
+    A circuit whose shots were split among several virtual QPUs with :py:func:`~cunqa.mappers.run_sharded`, each one sampling
+    its shard with its own seed. The results of the shards are merged in C++ into the :py:class:`~cunqa.result.Result` of a
+    single run of all the shots; :py:attr:`shards` reports the shots, seed and time taken of each shard.
+    """
+    _sharded_run: 'ShardedRun'
+    _qjob: QJob
+    _result: "Optional[Result]"
+
+    def __init__(self, qclients: "list['QClient']", qjob: QJob):
+        self._qjob = qjob
+        self._result = None
+        try:
+            self._sharded_run = ShardedRun(qclients, qjob._execution_config)
+        except Exception as error:
+            logger.error(f"Some error occured when submitting the shards [{type(error).__name__}].")
+            raise QJobError
+
+    @property
+    def result(self) -> 'Result':
+        """Merged result of the shards. This is a blocking call, as :py:attr:`QJob.result`."""
+        if self._result is None:
+            reply = decode_result(self._sharded_run.get_buffer())
+            if "ERROR" in reply:
+                logger.error(f"Error during the simulation of the shards: {reply['ERROR']}")
+                raise SystemExit # User's level
+            self._result = Result(reply, self._qjob._circuit_id, registers=self._qjob._cregisters)
+        return self._result
+
+    @property
+    def shards(self) -> "list[dict]":
+        """Shots, seed and time taken of every shard, available once the result is received."""
+        return self.result.result["shards"]
+
+
 def gather(qjobs: "list['QJob']") -> "list['Result']":
     """
         Function to get the results of several :py:class:`QJob` objects.
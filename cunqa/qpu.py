@@ -59,6 +59,8 @@
 """
 
 import os
+import json
+import uuid
 from typing import  Union, Any, Optional
 import inspect
 
@@ -68,7 +70,8 @@ from cunqa.qclient import QClient
 from cunqa.circuit import CunqaCircuit
 from cunqa.circuit.converters import _is_parametric
 from cunqa.backend import Backend
-from cunqa.qjob import QJob
+from cunqa.qjob import QJob, QJobBatch, CircuitHandle, QJobError
+from cunqa.result import decode_result
 from cunqa.logger import logger
 from cunqa.transpile import transpiler, TranspileError
 
@@ -87,6 +90,7 @@ class QPU:
     _family: str
     _endpoint: str 
     _connected: bool 
+    _client_id: str
     
     def __init__(self, id: int, qclient: 'QClient', backend: Backend, name: str, family: str, endpoint: str):
         """
@@ -114,6 +118,7 @@ class QPU:
         self._family = family
         self._endpoint = endpoint
         self._connected = False
+        self._client_id = uuid.uuid4().hex # Owner of the circuits registered through this object
         
         logger.debug(f"Object for QPU {id} created correctly.")
 
@@ -131,7 +136,7 @@ class QPU:
         """Object that provides the characteristics that the simulator at the virtual QPU uses to emulate a real device."""
         return self._backend
 
-    def run(self, circuit: Union[dict, 'CunqaCircuit', 'QuantumCircuit'], transpile: bool = False, initial_layout: Optional["list[int]"] = None, opt_level: int = 1, **run_parameters: Any) -> 'QJob':
+    def run(self, circuit: Union[dict, 'CunqaCircuit', 'QuantumCircuit', CircuitHandle], transpile: Union[bool, str] = False, initial_layout: Optional["list[int]"] = None, opt_level: int = 1, **run_parameters: Any) -> 'QJob':
         """
         Class method to send a circuit to the corresponding virtual QPU.
 
@@ -140,15 +145,27 @@ class QPU:
         Possible instructions to add as `**run_parameters` depend on the simulator, but mainly `shots` and `method` are used.
 
         Args:
-            circuit (dict | qiskit.QuantumCircuit | ~cunqa.circuit.CunqaCircuit): circuit to be simulated at the virtual QPU.
+            circuit (dict | qiskit.QuantumCircuit | ~cunqa.circuit.CunqaCircuit | ~cunqa.qjob.CircuitHandle): circuit to be simulated at the virtual QPU.
+            For a circuit registered with :py:meth:`register` only `params`, `shots`, `seed` and `gradient` are taken from `**run_parameters`.
 
-            transpile (bool): if True, transpilation will be done with respect to the backend of the given QPU. Default is set to False.
+            transpile (bool | str): if True, transpilation will be done with respect to the backend of the given QPU. With ``"server"`` the
+            virtual QPU transpiles the circuit itself (see :py:attr:`~cunqa.result.Result.transpilation`). Default is set to False.
 
             initial_layout (list[int]): Initial position of virtual qubits on physical qubits for transpilation.
 
             opt_level (int): optimization level for transpilation, default set to 1.
 
-            **run_parameters: any other simulation instructions.
+            **run_parameters: any other simulation instructions, among them:
+
+            - `method`: also ``"stabilizer"`` and ``"matrix_product_state"``, bounded by `matrix_product_state_max_bond_dimension` and `matrix_product_state_truncation_threshold` (see :py:attr:`~cunqa.result.Result.result`).
+            - `result_format="packed"`: counts as binary arrays (see :py:attr:`~cunqa.result.Result.packed_counts`).
+            - `memory=True`: outcome of every shot (see :py:attr:`~cunqa.result.Result.memory`).
+            - `save_state`, `save_state_compression`: final state (see :py:attr:`~cunqa.result.Result.state`).
+            - `precision="single"`: complex64 amplitudes in the Aer and Cunqa simulators.
+            - `prefix_checkpoints`, `prefix_checkpoints_max_memory_mb`: states kept to resume later runs (see :py:meth:`register`).
+            - `cost`: diagonal cost evaluated at the virtual QPU (see :py:attr:`~cunqa.result.Result.cost`).
+            - `gradient`: observable whose gradient is computed at the virtual QPU (see :py:attr:`~cunqa.result.Result.gradient`).
+            - `defer_measurements=False`, `prune_light_cone=False`: turn off the rewrites of the circuit (see :py:attr:`~cunqa.result.Result.result`).
 
         Return:
             A :py:class:`~cunqa.qjob.QJob` object related to the job sent.
@@ -163,8 +180,81 @@ class QPU:
 
         """
 
+        if "gradient" in run_parameters:
+            run_parameters["gradient"] = {"observable": _observable_definition(run_parameters["gradient"])}
+
+        if isinstance(circuit, CircuitHandle):
+            if circuit.qpu_id != self._id:
+                logger.error(f"Circuit {circuit.handle} is registered at QPU {circuit.qpu_id}, not at QPU {self._id}.")
+                raise SystemExit
+        else:
+            circuit = self._prepare(circuit, transpile, initial_layout, opt_level, run_parameters)
+
+        try:
+            qjob = QJob(self._qclient, self._backend, circuit, **run_parameters)
+            qjob.submit()
+            logger.debug(f"Qjob submitted to QPU {self._id}.")
+        except Exception as error:
+            logger.error(f"Error when submitting QJob [{type(error).__name__}].")
+            raise SystemExit
+
+        return qjob
+
+    def run_batch(self, circuits: "list[Union[dict, 'CunqaCircuit', 'QuantumCircuit']]", transpile: Union[bool, str] = False, initial_layout: Optional["list[int]"] = None, opt_level: int = 1, circuit_parameters: Optional["list[dict]"] = None, **run_parameters: Any) -> QJobBatch:
+        """
+        Sends several independent circuits to the virtual QPU in one message, to be executed together in one backend call.
+
+        The Cunqa simulator builds a trie of the circuits made of gates followed by measurements, so a common state preparation is
+        simulated once and only the different suffixes (e.g. the measurement bases of a tomography) are simulated for each circuit,
+        on copies of the shared state. Each circuit is still sampled independently, even if they all have the same `seed`.
+        The rest of the circuits run on a pool of threads, as all of them do on the Munich simulator, while the Aer simulator
+        executes the circuits that share their simulation options together in one call to its controller.
+
+        Args:
+            circuits (list[dict | qiskit.QuantumCircuit | ~cunqa.circuit.CunqaCircuit]): circuits to be simulated at the virtual QPU.
+
+            transpile (bool | str), initial_layout (list[int]), opt_level (int): transpilation of every circuit, as in :py:meth:`run`.
+
+            circuit_parameters (list[dict]): simulation instructions of each circuit (e.g. its own `shots`), over `run_parameters`.
+
+            **run_parameters: simulation instructions for every circuit, as in :py:meth:`run`.
+
+        Return:
+            A :py:class:`~cunqa.qjob.QJobBatch` whose result is the list of :py:class:`~cunqa.result.Result` of the circuits.
+        """
+        if any(isinstance(circuit, CircuitHandle) for circuit in circuits):
+            logger.error("Registered circuits can't be sent in a batch, run them with QPU.run().")
+            raise SystemExit
+
+        if circuit_parameters is None:
+            circuit_parameters = [{}] * len(circuits)
+        elif len(circuit_parameters) != len(circuits):
+            logger.error(f"{len(circuit_parameters)} sets of parameters were given for {len(circuits)} circuits.")
+            raise SystemExit
+        parameters = [{**run_parameters, **own_parameters} for own_parameters in circuit_parameters]
+
+        circuits = [self._prepare(circuit, transpile, initial_layout, opt_level, params) for circuit, params in zip(circuits, parameters)]
+        try:
+            batch = QJobBatch(self._qclient, [QJob(self._qclient, self._backend, circuit, **params) for circuit, params in zip(circuits, parameters)])
+            batch.submit()
+            logger.debug(f"Batch of {len(circuits)} circuits submitted to QPU {self._id}.")
+        except Exception as error:
+            logger.error(f"Error when submitting the batch [{type(error).__name__}].")
+            raise SystemExit
+
+        return batch
+
+    def _connect(self) -> None:
+        """Connects the :py:class:`QClient` to the virtual QPU, if it was not yet."""
+        if not self._connected:
+            self._qclient.connect(self._endpoint)
+            self._connected = True
+            logger.debug(f"QClient connection stabished for QPU {self._id} to endpoint {self._endpoint}.")
+
+    def _prepare(self, circuit: Union[dict, 'CunqaCircuit', 'QuantumCircuit'], transpile: Union[bool, str], initial_layout: Optional["list[int]"], opt_level: int, run_parameters: dict) -> Union[dict, 'CunqaCircuit', 'QuantumCircuit']:
+        """Checks the circuit, connects the :py:class:`QClient` and transpiles if requested, before running or registering the circuit."""
         # Disallow execution of distributed circuits
-        if inspect.stack()[1].function != "run_distributed": # Checks if the run() is called from run_distributed()
+        if inspect.stack()[2].function != "run_distributed": # Checks if the run() is called from run_distributed()
             if isinstance(circuit, CunqaCircuit):
                 if circuit.has_cc or circuit.has_qc:
                     logger.error("Distributed circuits can't run using QPU.run(), try run_distributed() instead.")
@@ -174,15 +264,14 @@ class QPU:
                     logger.error("Distributed circuits can't run using QPU.run(), try run_distributed() instead.")
                     raise SystemExit
 
-        # Handle connection to QClient
-        if not self._connected:
-            self._qclient.connect(self._endpoint)
-            self._connected = True
-            logger.debug(f"QClient connection stabished for QPU {self._id} to endpoint {self._endpoint}.")
-            self._connected = True
+        self._connect()
 
         # Transpilation if requested
-        if transpile:
+        if transpile == "server":
+            run_parameters["transpile"] = True
+            if initial_layout is not None:
+                run_parameters["initial_layout"] = initial_layout
+        elif transpile:
             try:
                 #logger.debug(f"About to transpile: {circuit}")
                 circuit = transpiler(circuit, self._backend, initial_layout = initial_layout, opt_level = opt_level)
@@ -191,12 +280,101 @@ class QPU:
                 logger.error(f"Transpilation failed [{type(error).__name__}].")
                 raise TranspileError # I capture the error in QPU.run() when creating the job
 
+        return circuit
+
+    def register(self, circuit: Union[dict, 'CunqaCircuit', 'QuantumCircuit'], transpile: Union[bool, str] = False, initial_layout: Optional["list[int]"] = None, opt_level: int = 1, **run_parameters: Any) -> CircuitHandle:
+        """
+        Registers a circuit at the virtual QPU, which keeps it decoded so that later runs only send the returned handle and the
+        `params`, `shots` and `seed` that change (see :py:class:`~cunqa.qjob.CircuitHandle`). Useful for workloads that alternate
+        between a few circuits, such as an ansatz and its measurement basis variants.
+
+        With `prefix_checkpoints=True` the Cunqa simulator keeps statevectors at the layer boundaries of a circuit made of gates
+        followed by measurements, within `prefix_checkpoints_max_memory_mb` (1024 by default), and a run whose later layers got new
+        parameters resumes from the last checkpoint before the first changed gate.
+
+        Args:
+            circuit (dict | qiskit.QuantumCircuit | ~cunqa.circuit.CunqaCircuit): circuit to be registered.
+
+            transpile (bool | str), initial_layout (list[int]), opt_level (int): transpilation, as in :py:meth:`run`.
+
+            **run_parameters: simulation instructions used by every run of the circuit, as in :py:meth:`run`.
+
+        Return:
+            The :py:class:`~cunqa.qjob.CircuitHandle` to pass to :py:meth:`run`.
+        """
+        circuit = self._prepare(circuit, transpile, initial_layout, opt_level, run_parameters)
         try:
-            qjob = QJob(self._qclient, self._backend, circuit, **run_parameters)
-            qjob.submit()
-            logger.debug(f"Qjob submitted to QPU {self._id}.")
-        except Exception as error:
-            logger.error(f"Error when submitting QJob [{type(error).__name__}].")
+            return QJob(self._qclient, self._backend, circuit, **run_parameters)._register(self._client_id, self._id)
+        except QJobError:
+            logger.error(f"Error when registering the circuit at QPU {self._id}.")
             raise SystemExit
 
-        return qjob
+    def optimize(self, circuit: CircuitHandle, observable: Union[dict, "list[tuple[str, float]]", Any], optimizer: str = "spsa", initial_params: Optional["list[float]"] = None, maxiter: int = 100, shots: Optional[int] = None, seed: Optional[int] = None, **options: Any) -> dict:
+        """
+        Runs a whole variational optimization at the virtual QPU, which only answers with the outcome: the loop of parameter
+        updates, simulations and cost evaluations never goes through the network.
+
+        The cost is the expectation value of `observable` in the state prepared by the registered circuit (its measurements are
+        replaced by the ones each observable needs), estimated with the `shots` of the circuit. The parameters are the ones that
+        :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` assigns, and the optimal ones stay at the registered circuit.
+
+        Args:
+            circuit (~cunqa.qjob.CircuitHandle): parametric circuit registered at this QPU with :py:meth:`register`.
+
+            observable (qiskit.quantum_info.SparsePauliOp | list[tuple[str, float]] | dict): Pauli operator as a ``SparsePauliOp`` or
+            as its ``to_list()``, a dict ``{"diagonal": [{"qubits": [...], "coeff": c}, ...]}`` of products of Z over the measured bits, or
+            an ``"ising"``, ``"maxcut"`` or ``"polynomial"`` cost as the `cost` option of :py:meth:`run` takes it (without ``"cvar"``).
+
+            optimizer (str): ``"spsa"``, ``"cobyla"``, ``"nelder_mead"`` or ``"adam"`` (with parameter shift gradients).
+
+            initial_params (list[float]): starting point, one value per parameter of the circuit. Its current parameters by default.
+
+            maxiter (int): maximum number of iterations of the optimizer.
+
+            shots (int), seed (int): override the ones of the registered circuit for this optimization.
+
+            **options: options of the optimizer, see ``src/optimization/optimizers.hpp``.
+
+        Return:
+            ``dict`` with the final ``"params"`` and ``"cost"``, the ``"trajectory"`` (parameters and cost of each iteration), the
+            number of cost ``"evaluations"`` and of simulated ``"circuits"``, and the ``"time_taken"``.
+        """
+        if circuit.qpu_id != self._id:
+            logger.error(f"Circuit {circuit.handle} is registered at QPU {circuit.qpu_id}, not at QPU {self._id}.")
+            raise SystemExit
+
+        request = {"observable": _observable_definition(observable), "optimizer": {"name": optimizer, "maxiter": maxiter, **options}}
+        if initial_params is not None:
+            if circuit.num_params is not None and len(initial_params) != circuit.num_params:
+                logger.error(f"initial_params has {len(initial_params)} values but the circuit has {circuit.num_params} parameters [{ValueError.__name__}].")
+                raise SystemExit # User's level
+            request["initial_params"] = [float(p) for p in initial_params]
+        message = {"handle": circuit.handle, "client": circuit.client, "optimize": request}
+        if shots is not None:
+            message["shots"] = shots
+        if seed is not None:
+            message["seed"] = seed
+
+        self._connect()
+        reply = decode_result(self._qclient.send_circuit(json.dumps(message)).get_buffer())
+        if "ERROR" in reply:
+            logger.error(f"The optimization at QPU {self._id} failed: {reply['ERROR']}")
+            raise SystemExit
+        return reply
+
+    def release(self, circuit: CircuitHandle) -> bool:
+        """
+        Frees a circuit registered with :py:meth:`register`. Returns ``False`` if the virtual QPU had already evicted it.
+        """
+        if not self._connected:
+            return False
+        reply = decode_result(self._qclient.send_circuit(json.dumps({"handle": circuit.handle, "client": circuit.client, "release": True})).get_buffer())
+        return reply.get("released", False)
+
+
+def _observable_definition(observable: Union[dict, "list[tuple[str, float]]", Any]) -> dict:
+    """Observable as the virtual QPU reads it, from a ``SparsePauliOp``, its ``to_list()`` or an already built ``dict``."""
+    if isinstance(observable, dict):
+        return observable
+    terms = observable.to_list() if hasattr(observable, "to_list") else observable
+    return {"pauli": [[label, float(complex(coeff).real)] for label, coeff in terms]}
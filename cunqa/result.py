@@ -19,8 +19,13 @@
 """
 from cunqa.logger import logger
 from typing import Union, Optional
+import json
+import zlib
 import numpy as np
 
+_WIRE_MAGIC = b"CUNQABIN"
+_WIRE_VERSION = 1
+
 class ResultError(Exception):
     """Exception for error received from a simulation."""
     pass
@@ -48,6 +53,37 @@ class Result:
             >>> result.time_taken
             0.056
 
+    - :py:attr:`Result.packed_counts` : if the job was run with ``result_format="packed"``, the counts as two parallel numpy arrays
+      of outcomes and counts, decoded without copying from the message received.
+
+            >>> result = qpu.run(circuit, result_format="packed").result
+            >>> outcomes, counts = result.packed_counts
+            >>> outcomes
+            array([0, 7], dtype=uint64)
+
+      The outcome is the integer value of the bit string (``'111'`` is ``7``). For more than 64 classical bits, each outcome is a row of
+      ``ceil(num_clbits/64)`` little-endian ``uint64`` words. :py:attr:`Result.counts` is still available, built from them.
+
+    - :py:attr:`Result.memory` : if the job was run with ``memory=True``, the outcome of every shot as packed ``uint64`` rows.
+
+    - :py:attr:`Result.state` : if the job was run with ``save_state``, the final state as a complex numpy array.
+
+            >>> result = qpu.run(circuit, save_state=True).result
+            >>> result.state
+            array([0.70710678+0.j, 0.        +0.j, 0.        +0.j, 0.70710678+0.j])
+
+    - :py:attr:`Result.cost` : if the job was run with a diagonal ``cost``, its statistics evaluated at the virtual QPU, which
+      returns them instead of the counts.
+
+            >>> result = qpu.run(circuit, cost={"maxcut": [[0, 1], [1, 2]], "cvar": 0.2}).result
+            >>> result.cost
+            {'value': -1.21, 'variance': 0.45, 'cvar': -2.0, 'alpha': 0.2, 'best': '010', 'best_value': -2.0, 'shots': 1024}
+
+    - :py:attr:`Result.gradient` and :py:attr:`Result.expectation` : if the job was run with ``gradient=observable``, the gradient
+      of the expectation value of the observable with respect to the circuit parameters, and that expectation value.
+
+    - :py:attr:`Result.circuit_hash` : hashes of the circuit that identify it modulo parameters (``"structure"``) and its parameter values (``"params"``).
+
     Nevertheless, depending on the simulator used, more output data is provided. For checking all the information from the simulation as a ``dict``, one can
     access the attribute :py:attr:`Result.result`.
 
@@ -96,12 +132,32 @@ class Result:
         YELLOW = "\033[33m"
         RESET = "\033[0m"   
         GREEN = "\033[32m"
-        return f"{YELLOW}{self._id}:{RESET} {'{'}counts: {self.counts}, \n\t time_taken: {GREEN}{self.time_taken} s{RESET}{'}'}\n"
+        if "cost" in self._result:
+            outcome = f"cost: {self.cost}"
+        elif "gradient" in self._result:
+            outcome = f"expectation: {self.expectation}, gradient: {self.gradient}"
+        else:
+            outcome = f"counts: {self.counts}"
+        return f"{YELLOW}{self._id}:{RESET} {'{'}{outcome}, \n\t time_taken: {GREEN}{self.time_taken} s{RESET}{'}'}\n"
 
 
     @property
     def result(self) -> dict:
-        """Raw output of the simulation, the ``dict`` format depends on the simulator used."""
+        """
+        Raw output of the simulation, the ``dict`` format depends on the simulator used. Besides the outcomes, it reports:
+
+        - ``"precision"``: the one the statevector was simulated with.
+        - The bond dimension reached and the truncation error of a ``"matrix_product_state"`` run of the Cunqa simulator. Circuits
+          made only of Clifford gates run on its stabilizer simulator with ``method="automatic"``, and beyond 28 qubits on an MPS,
+          unless they save the state or evaluate an exact cost, which take the statevector.
+        - ``"deferred_measurement"``: the ancillas added to run a dynamic circuit as a static one on a noiseless virtual QPU. When
+          the conditional gates are x, y, z, rx, ry or rz, each mid-circuit measurement is deferred to the end, through a CX onto an
+          ancilla if the qubit is used again, and each conditional gate is controlled by the qubit holding its clbit, so the circuit
+          is simulated once instead of once per shot. Circuits with ``c_if`` instructions, gates conditioned other than those,
+          classical communications, or more qubits than the virtual QPU once the ancillas are added are not rewritten.
+        - ``"light_cone"``: the qubits kept on a noiseless virtual QPU after removing the instructions outside the backward light cone
+          of the measurements. Runs that save the state, evaluate an exact cost or are transpiled at the virtual QPU keep them all.
+        """
         return self._result
     
 
@@ -109,7 +165,10 @@ class Result:
     def counts(self) -> dict:
         """Counts distribution from the sampling of the simulation, format is ``{"<bit string>":<number of counts as int>}``."""
         try:
-            if "results" in list(self._result.keys()): # aer
+            if "packed_counts" in self._result: # any simulator, with result_format="packed"
+                counts = _unpack_counts(self._result["packed_counts"])
+
+            elif "results" in list(self._result.keys()): # aer
                 counts = self._result["results"][0]["data"]["counts"]
 
             elif "counts" in list(self._result.keys()): # munich and cunqa
@@ -127,6 +186,99 @@ class Result:
         
         return counts
 
+    @property
+    def packed_counts(self) -> "tuple[np.ndarray, np.ndarray]":
+        """Outcomes and counts as parallel numpy arrays, only if the job was run with ``result_format="packed"``."""
+        if "packed_counts" not in self._result:
+            logger.error(f"Packed counts not available, run the job with result_format=\"packed\" [{ResultError.__name__}].")
+            raise ResultError
+        packed = self._result["packed_counts"]
+        return packed["outcomes"], packed["counts"]
+
+    @property
+    def memory(self) -> np.ndarray:
+        """
+        Per-shot outcomes, only if the job was run with ``memory=True``. It is a ``uint64`` numpy array of shape
+        ``(shots, ceil(num_clbits/64))``: row *i* holds the outcome of shot *i* with the same encoding as :py:attr:`Result.packed_counts`,
+        so for up to 64 classical bits ``format(result.memory[i, 0], f"0{num_clbits}b")`` is its bit string.
+        """
+        if "memory" not in self._result:
+            logger.error(f"Memory not available, run the job with memory=True [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["memory"]["rows"]
+
+    @property
+    def state(self) -> "np.ndarray | dict":
+        """
+        Final state, only if the job was run with ``save_state``. A statevector is a complex numpy array of shape ``(2**n,)`` and a
+        density matrix one of shape ``(2**n, 2**n)``, with qubit 0 as the least significant bit of the index. Both view the message
+        received, without copies, unless ``save_state_compression="zlib"`` was set. An MPS is a ``dict`` with the list of ``tensors``
+        (a pair of matrices per qubit) and the list of ``lambdas`` (Schmidt coefficients per bond).
+        """
+        if "state" not in self._result:
+            logger.error(f"State not available, run the job with save_state=True [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["state"]["data"]
+
+    @property
+    def cost(self) -> dict:
+        """
+        Statistics of the diagonal cost given as ``cost`` in the run parameters (``{"ising": {"h": [...], "J": [[i, j, Jij], ...]}}``,
+        ``{"maxcut": [[i, j, w], ...]}`` or ``{"polynomial": [{"bits": [...], "coeff": c}, ...]}``), which the virtual QPU returns
+        instead of the counts: its mean ``"value"`` and ``"variance"`` over the
+        shots (or over the probabilities of the statevector for an ``"exact"`` cost), the ``"cvar"`` of the lowest ``"alpha"``
+        fraction if requested and the ``"best"`` outcome found with its ``"best_value"``, written in the bit order of the
+        :py:attr:`counts` of the same simulator. Costs are minimized, so the one of a MaxCut is minus the weight of the cut.
+        """
+        if "cost" not in self._result:
+            logger.error(f"Cost not available, run the job with a cost [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["cost"]
+
+    @property
+    def gradient(self) -> "list[float]":
+        """
+        Gradient of the expectation value of the ``gradient`` observable with respect to the parameters of the circuit, in the order
+        :py:meth:`~cunqa.qjob.QJob.upgrade_parameters` takes them, computed with the adjoint method on the noiseless statevector at
+        the virtual QPU, which returns it instead of samples. The observable is given as in :py:meth:`~cunqa.qpu.QPU.optimize`.
+        """
+        if "gradient" not in self._result:
+            logger.error(f"Gradient not available, run the job with gradient=observable [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["gradient"]
+
+    @property
+    def expectation(self) -> float:
+        """Expectation value of the ``gradient`` observable in the state prepared by the circuit."""
+        if "expectation" not in self._result:
+            logger.error(f"Expectation value not available, run the job with gradient=observable [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["expectation"]
+
+    @property
+    def circuit_hash(self) -> dict:
+        """
+        Canonical hashes of the circuit computed at the virtual QPU, as ``{"structure": <hex>, "params": <hex>}``. Circuits that only
+        differ in their parameter values share the ``"structure"`` hash, so it can key caches of results or transpiled circuits.
+        """
+        if "circuit_hash" not in self._result:
+            logger.error(f"Circuit hash not available in this result [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["circuit_hash"]
+
+    @property
+    def transpilation(self) -> dict:
+        """
+        Report of the transpilation done at the virtual QPU for runs with ``transpile="server"`` (basis translation, SABRE routing over
+        the coupling map and single-qubit resynthesis, with the routing of each circuit structure cached): ``"initial_layout"`` and
+        ``"final_layout"`` (physical qubit of every circuit qubit before and after routing), ``"swaps"`` inserted and whether the
+        routing was ``"cached"`` from an earlier circuit with the same structure. Classical bits keep their order.
+        """
+        if "transpilation" not in self._result:
+            logger.error(f"Transpilation report not available in this result [{ResultError.__name__}].")
+            raise ResultError
+        return self._result["transpilation"]
+
     @property
     def time_taken(self) -> str:
         """Time that the simulation took in seconds, since it is recieved at the virtual QPU until it is finished."""
@@ -135,7 +287,7 @@ class Result:
                 time = self._result["results"][0]["time_taken"]
                 return time
 
-            elif "counts" in list(self._result.keys()): # munich and cunqa
+            elif "time_taken" in list(self._result.keys()): # munich and cunqa, or packed counts
                 time = self._result["time_taken"]          
                 return time
             else:
@@ -212,3 +364,63 @@ def _convert_counts(counts: dict, registers: dict) -> dict:
     
     return new_counts
 
+
+
+def decode_result(buffer) -> dict:
+    """
+    Decodes the message received from a virtual QPU. Plain results are JSON; results carrying binary arrays arrive as a frame
+    (see ``src/utils/helpers/binary_result.hpp``) whose arrays are returned as numpy arrays viewing *buffer*, without copies.
+
+    Args:
+        buffer (numpy.ndarray | bytes): message received, as returned by ``FutureWrapper.get_buffer``.
+
+    Return:
+        Result ``dict``.
+    """
+    view = memoryview(buffer)
+    if len(view) < 16 or bytes(view[:8]) != _WIRE_MAGIC:
+        return json.loads(bytes(view))
+
+    version = int.from_bytes(view[8:12], "little")
+    if version != _WIRE_VERSION:
+        logger.error(f"Unsupported binary result version {version} [{ResultError.__name__}].")
+        raise ResultError
+    header_size = int.from_bytes(view[12:16], "little")
+    header = json.loads(bytes(view[16:16 + header_size]))
+
+    return _attach_sections(header, buffer)
+
+
+def _attach_sections(node, buffer):
+    """Replaces the section descriptors of the frame header by numpy views of *buffer*."""
+    if isinstance(node, dict):
+        if "__section__" in node:
+            section = node["__section__"]
+            dtype = np.dtype(section["dtype"])
+            shape = tuple(section["shape"])
+            if section["nbytes"] == 0:
+                return np.empty(shape, dtype=dtype)
+            if section.get("compression") == "zlib":
+                start = section["offset"]
+                raw = zlib.decompress(memoryview(buffer)[start:start + section["nbytes"]])
+                return np.frombuffer(raw, dtype=dtype).reshape(shape)
+            array = np.frombuffer(buffer, dtype=dtype, count=section["nbytes"] // dtype.itemsize, offset=section["offset"])
+            return array.reshape(shape)
+        return {k: _attach_sections(v, buffer) for k, v in node.items()}
+    if isinstance(node, list):
+        return [_attach_sections(v, buffer) for v in node]
+    return node
+
+
+def _unpack_counts(packed: dict) -> dict:
+    """Builds the bit string counts ``dict`` from packed outcomes and counts."""
+    n_clbits = packed["n_clbits"]
+    outcomes = packed["outcomes"]
+    counts = packed["counts"]
+
+    if outcomes.ndim == 1:
+        values = outcomes.tolist()
+    else:
+        values = [sum(int(word) << (64 * i) for i, word in enumerate(row)) for row in outcomes]
+
+    return {format(value, f"0{n_clbits}b"): int(count) for value, count in zip(values, counts.tolist())}
@@ -0,0 +1,62 @@
+#include "utils/json.hpp"
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "comm/client.hpp"
+#include "comm/sharded_run.hpp"
+
+std::string circuit = R"(
+{
+    "config": {
+        "shots": 100000000,
+        "method": "statevector",
+        "num_clbits": 2,
+        "num_qubits": 2,
+        "seed": 1234
+    },
+    "instructions": [
+    {
+        "name": "h",
+        "qubits": [0]
+    },
+    {
+        "name": "cx",
+        "qubits": [0, 1]
+    },
+    {
+        "name": "measure",
+        "qubits": [0],
+        "clbits": [0]
+    },
+    {
+        "name": "measure",
+        "qubits": [1],
+        "clbits": [1]
+    }
+    ]
+}
+)";
+
+using namespace cunqa::comm;
+
+// Usage: example4 <endpoint> [<endpoint> ...], one per QPU of the family
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        std::cerr << "ERROR: Not introduced correct arguments.\n";
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Client>> clients;
+    std::vector<Client*> shard_clients;
+    for (int i = 1; i < argc; i++) {
+        clients.push_back(std::make_unique<Client>());
+        clients.back()->connect(argv[i]);
+        shard_clients.push_back(clients.back().get());
+    }
+
+    ShardedRun run(shard_clients, circuit);
+    std::cout << run.get() << "\n";
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "utils/json.hpp"
+#include <cmath>
+#include <memory>
+#include <iostream>
+#include "quantum_task.hpp"
+#include "backends/simple_backend.hpp"
+#include "backends/simulators/AER/aer_simple_simulator.hpp"
+#include "backends/simulators/Munich/munich_simple_simulator.hpp"
+#include "backends/simulators/CUNQA/cunqa_simple_simulator.hpp"
+#include "optimization/diagonal_cost.hpp"
+#include "optimization/observable.hpp"
+
+// Qubit 0 flipped, every qubit measured into the clbit of its index
+std::string circuit = R"(
+{
+    "id": "bit_order",
+    "config": {
+        "shots": 100,
+        "method": "statevector",
+        "num_clbits": 3,
+        "num_qubits": 3,
+        "seed": 1234,
+        "save_state": "statevector"
+    },
+    "instructions": [
+    {
+        "name": "x",
+        "qubits": [0]
+    },
+    {
+        "name": "measure",
+        "qubits": [0],
+        "clbits": [0]
+    },
+    {
+        "name": "measure",
+        "qubits": [1],
+        "clbits": [1]
+    },
+    {
+        "name": "measure",
+        "qubits": [2],
+        "clbits": [2]
+    }
+    ],
+    "sending_to": [],
+    "is_dynamic": false,
+    "has_cc": false
+}
+)";
+
+// Neither cost nor observable is symmetric under the reversal of the bits:
+// the cost is 1 and the expectation value -1 + 0.5 on every simulator
+const cunqa::JSON cost = cunqa::JSON::parse(R"({"polynomial": [{"bits": [0], "coeff": 1.0}, {"bits": [2], "coeff": 5.0}]})");
+const cunqa::JSON observable = cunqa::JSON::parse(R"({"pauli": [["IIZ", 1.0], ["ZII", 0.5]]})");
+
+using namespace cunqa;
+using namespace cunqa::sim;
+
+// Sampled and exact costs, from the counts and the state of the same run, and
+// expectation value of the observable
+bool check(const std::string& name, const SimpleBackend& backend)
+{
+    const QuantumTask quantum_task(circuit);
+    const JSON result = backend.execute(quantum_task);
+
+    JSON sampled = result, exact = result;
+    optimization::DiagonalCost(cost).evaluate(sampled);
+    JSON exact_cost = cost;
+    exact_cost["exact"] = true;
+    optimization::DiagonalCost(exact_cost).evaluate(exact);
+
+    const optimization::Observable pauli(observable, 3);
+    std::vector<JSON> measurements;
+    for (const auto& task : pauli.measurement_tasks(quantum_task))
+        measurements.push_back(backend.execute(task));
+    std::vector<const JSON*> measurement_results;
+    for (const auto& measurement : measurements)
+        measurement_results.push_back(&measurement);
+    const double expectation = pauli.expectation(measurement_results);
+
+    const bool ok = sampled.at("cost").at("value") == 1.0 && exact.at("cost").at("value") == 1.0
+                    && sampled.at("cost").at("best") == exact.at("cost").at("best") && std::abs(expectation + 0.5) < 1e-12;
+    std::cout << name << ": sampled " << sampled.at("cost") << ", exact " << exact.at("cost") << ", expectation "
+              << expectation << (ok ? "" : "  <-- WRONG") << "\n";
+    return ok;
+}
+
+// Usage: example5. Checks that the costs and the expectation values evaluated
+// at the QPU read the clbits of every simulator in the same order.
+int main()
+{
+    bool ok = true;
+    ok &= check("Aer", SimpleBackend(SimpleConfig(), std::make_unique<AerSimpleSimulator>()));
+    ok &= check("Munich", SimpleBackend(SimpleConfig(), std::make_unique<MunichSimpleSimulator>()));
+    ok &= check("Cunqa", SimpleBackend(SimpleConfig(), std::make_unique<CunqaSimpleSimulator>()));
+
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include "quantum_task.hpp"
 
@@ -17,6 +18,20 @@ class Backend {
 public:
     virtual ~Backend() = default;
     virtual inline JSON execute(const QuantumTask& quantum_task) const = 0;
+    // Independent circuits sent together, {"results": [...]} in their order.
+    // Simulators can override it to share work among the circuits.
+    virtual JSON execute_batch(const std::vector<QuantumTask>& quantum_tasks) const
+    {
+        JSON results = JSON::array();
+        for (const auto& quantum_task : quantum_tasks) {
+            try {
+                results.push_back(execute(quantum_task));
+            } catch (const std::exception& e) {
+                results.push_back({{"ERROR", std::string(e.what())}});
+            }
+        }
+        return {{"results", results}};
+    }
     virtual JSON to_json() const = 0;
 
     JSON config;
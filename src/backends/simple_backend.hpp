@@ -80,6 +80,11 @@ public:
         return simulator_->execute(*this, quantum_task);
     }
 
+    inline JSON execute_batch(const std::vector<QuantumTask>& quantum_tasks) const override
+    {
+        return simulator_->execute_batch(*this, quantum_tasks);
+    }
+
     // TODO: Achieve this using the JSON adl serializer
     JSON to_json() const override 
     {
@@ -1,4 +1,6 @@
 
+#include <map>
+#include <tuple>
 #include <unordered_map>
 #include <stack>
 #include <chrono>
@@ -19,6 +21,9 @@
 
 #include "utils/constants.hpp"
 #include "utils/helpers/reverse_bitstring.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/saved_state.hpp"
+#include "utils/helpers/precision.hpp"
 
 #include "logger.hpp"
 
@@ -46,7 +51,7 @@ struct GlobalState {
 namespace cunqa {
 namespace sim {
 
-std::string execute_shot_(AER::AerState* state, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel)
+void execute_shot_(AER::AerState* state, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel, std::size_t shot, std::uint64_t* outcome)
 {
     std::unordered_map<std::string, TaskState> Ts;
     GlobalState G;
@@ -123,6 +128,12 @@ std::string execute_shot_(AER::AerState* state, const std::vector<QuantumTask>&
         case constants::SX:
             state->apply_mcsx({qubits[0] + T.zero_qubit});
             break;
+        case constants::S:
+            state->apply_mcphase({qubits[0] + T.zero_qubit}, {0.0, 1.0});
+            break;
+        case constants::SDG:
+            state->apply_mcphase({qubits[0] + T.zero_qubit}, {0.0, -1.0});
+            break;
         case constants::CX:
         {
             unsigned long control = (qubits[0] == -1) ? G.n_qubits - 1 : qubits[0] + T.zero_qubit;
@@ -206,14 +217,14 @@ std::string execute_shot_(AER::AerState* state, const std::vector<QuantumTask>&
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             uint_t measurement = state->apply_measure({qubits[0] + T.zero_qubit});
             int measurement_as_int = static_cast<int>(measurement);
-            classical_channel->send_measure(measurement_as_int, endpoint[0]); 
+            classical_channel->send_measure(measurement_as_int, endpoint[0], shot); 
             break;
         }
         case cunqa::constants::RECV:
         {
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             auto conditional_reg = inst.at("remote_conditional_reg").get<std::vector<std::uint64_t>>();
-            int measurement = classical_channel->recv_measure(endpoint[0]);
+            int measurement = classical_channel->recv_measure(endpoint[0], shot);
             G.rcreg[conditional_reg[0]] = (measurement == 1);
             break;
         }
@@ -346,15 +357,78 @@ std::string execute_shot_(AER::AerState* state, const std::vector<QuantumTask>&
 
     } // End one shot
 
-    std::string result_bits(G.n_clbits, '0');
+    // Outcome row with the bit order the counts keys have always had
     for (const auto &[bitIndex, value] : G.cvalues)
     {
-        result_bits[G.n_clbits - bitIndex - 1] = value ? '1' : '0';
+        if (value && bitIndex < static_cast<std::size_t>(G.n_clbits))
+            set_outcome_bit(outcome, G.n_clbits - bitIndex - 1);
     }
+}
+
+
+namespace {
+
+// Circuit and run config of AER for a static task
+std::pair<JSON, JSON> aer_circuit_and_config(const QuantumTask& quantum_task)
+{
+    auto aer_quantum_task = quantum_task_to_AER(quantum_task);
+    JSON circuit_json = aer_quantum_task.circuit;
 
-    return result_bits;
+    const auto state_type = saved_state_type(quantum_task.config);
+    if (!state_type.empty())
+        circuit_json.at("instructions").push_back(aer_save_state_instruction(state_type, quantum_task.config.at("num_qubits").get<std::size_t>()));
+
+    JSON run_config_json(aer_quantum_task.config);
+    run_config_json["seed_simulator"] = quantum_task.config.at("seed");
+    if (memory_requested(quantum_task.config))
+        run_config_json["memory"] = true;
+
+    return {circuit_json, run_config_json};
 }
 
+// From the AER result of one circuit ({..., "results": [experiment]}) to the
+// result format of the QPUs
+JSON finish_aer_result(JSON result_json, const QuantumTask& quantum_task)
+{
+    int n_clbits = quantum_task.config.at("num_clbits");
+    const auto state_type = saved_state_type(quantum_task.config);
+    const auto n_qubits = quantum_task.config.at("num_qubits").get<std::size_t>();
+
+    if (memory_requested(quantum_task.config)) {
+        // One hex outcome per shot from AER, stored as packed rows
+        auto& data = result_json.at("results")[0].at("data");
+        const auto& shot_outcomes = data.at("memory");
+        PackedMemory shot_memory(shot_outcomes.size(), n_clbits);
+        for (std::size_t i = 0; i < shot_outcomes.size(); ++i)
+            parse_hex(shot_outcomes[i].get_ref<const std::string&>(), shot_memory.row(i), shot_memory.n_words());
+        data.erase("memory");
+        result_json["memory"] = shot_memory.to_json();
+    }
+
+    if (!state_type.empty()) {
+        // AER hands the state as [re, im] pairs, it leaves as a binary section
+        auto& data = result_json.at("results")[0].at("data");
+        result_json["state"] = saved_state(state_type, n_qubits, aer_saved_state_to_sections(state_type, data.at(AER_SAVED_STATE_LABEL), quantum_task.config));
+        data.erase(AER_SAVED_STATE_LABEL);
+    }
+
+    if (packed_result_requested(quantum_task.config)) {
+        // AER already reports integer (hex) outcomes, no bitstrings are built
+        auto& data = result_json.at("results")[0].at("data");
+        PackedCounts packed(n_clbits);
+        for (const auto& [key, count] : data.at("counts").items())
+            packed.add_hex(key, count.get<std::size_t>());
+        data.erase("counts");
+        result_json["packed_counts"] = packed.to_json();
+    } else {
+        convert_standard_results_Aer(result_json, n_clbits);
+    }
+    result_json["precision"] = run_precision(quantum_task.config);
+
+    return result_json;
+}
+
+} // End of anonymous namespace
 
 JSON AerSimulatorAdapter::simulate(const Backend* backend)
 {
@@ -362,20 +436,13 @@ JSON AerSimulatorAdapter::simulate(const Backend* backend)
 
         /* int result = std::system("python /mnt/netapp1/Store_CESGA/home/cesga/acarballido/repos/api-simulator/examples/aer_bench.py"); */
 
-        auto quantum_task = qc.quantum_tasks[0];
-
-        auto aer_quantum_task = quantum_task_to_AER(quantum_task);
-        int n_clbits = quantum_task.config.at("num_clbits");
-        JSON circuit_json = aer_quantum_task.circuit;
+        const auto& quantum_task = qc.quantum_tasks[0];
+        auto [circuit_json, run_config_json] = aer_circuit_and_config(quantum_task);
 
         //LOGGER_DEBUG("Circuit: {}", circuit_json.dump());
 
-        Circuit circuit(circuit_json);
         std::vector<std::shared_ptr<Circuit>> circuits;
-        circuits.push_back(std::make_shared<Circuit>(circuit));
-
-        JSON run_config_json(aer_quantum_task.config);
-        run_config_json["seed_simulator"] = quantum_task.config.at("seed");
+        circuits.push_back(std::make_shared<Circuit>(circuit_json));
         Config aer_config(run_config_json);
 
         LOGGER_DEBUG("Circiut: {}", circuit_json.dump());
@@ -388,9 +455,7 @@ JSON AerSimulatorAdapter::simulate(const Backend* backend)
 
         LOGGER_DEBUG("Result: {}", result_json.dump());
 
-        convert_standard_results_Aer(result_json, n_clbits);
-
-        return result_json;
+        return finish_aer_result(std::move(result_json), quantum_task);
 
     } catch (const std::exception& e) {
         // TODO: specify the circuit format in the docs.
@@ -400,36 +465,121 @@ JSON AerSimulatorAdapter::simulate(const Backend* backend)
     return {};
 }
 
+JSON AerSimulatorAdapter::simulate_batch(const Backend* backend)
+{
+    const auto& quantum_tasks = qc.quantum_tasks;
+    std::vector<JSON> results(quantum_tasks.size());
+
+    // One controller_execute for every set of circuits with the same run
+    // config, the per-circuit settings (shots, clbits) travel in each circuit
+    std::map<std::string, std::vector<std::size_t>> groups;
+    std::vector<JSON> circuit_jsons(quantum_tasks.size()), run_configs(quantum_tasks.size());
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++) {
+        if (quantum_tasks[i].is_dynamic)
+            continue;
+        try {
+            std::tie(circuit_jsons[i], run_configs[i]) = aer_circuit_and_config(quantum_tasks[i]);
+            JSON key = run_configs[i];
+            key.erase("shots");
+            key.erase("memory_slots");
+            groups[key.dump()].push_back(i);
+        } catch (const std::exception& e) {
+            results[i] = {{"ERROR", std::string(e.what())}};
+        }
+    }
+
+    for (const auto& [key, indices] : groups) {
+        try {
+            std::vector<std::shared_ptr<Circuit>> circuits;
+            for (auto i : indices)
+                circuits.push_back(std::make_shared<Circuit>(circuit_jsons[i]));
+            Config aer_config(run_configs[indices[0]]);
+            Noise::NoiseModel noise_model(backend->config.at("noise_model"));
+
+            JSON result_json = controller_execute<Controller>(circuits, noise_model, aer_config).to_json();
+
+            // Every circuit gets the whole result with only its experiment
+            JSON experiments = std::move(result_json.at("results"));
+            for (std::size_t k = 0; k < indices.size(); k++) {
+                JSON circuit_result = result_json;
+                circuit_result["results"] = JSON::array({std::move(experiments[k])});
+                results[indices[k]] = finish_aer_result(std::move(circuit_result), quantum_tasks[indices[k]]);
+            }
+        } catch (const std::exception& e) {
+            LOGGER_ERROR("Error executing a batch of {} circuits in the AER simulator.", indices.size());
+            for (auto i : indices)
+                results[i] = {{"ERROR", std::string(e.what())}};
+        }
+    }
+
+    // Dynamic circuits run shot by shot, one after the other
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++) {
+        if (!results[i].is_null())
+            continue;
+        AerComputationAdapter single_ca(quantum_tasks[i]);
+        AerSimulatorAdapter single_sa(single_ca);
+        results[i] = single_sa.simulate();
+    }
+
+    return {{"results", results}};
+}
+
 
 JSON AerSimulatorAdapter::simulate(comm::ClassicalChannel* classical_channel)
 {
-    std::map<std::string, std::size_t> meas_counter;
-    
     auto shots = qc.quantum_tasks[0].config.at("shots").get<std::size_t>();
     std::string method = qc.quantum_tasks[0].config.at("method").get<std::string>();
 
-    AER::AerState* state = new AER::AerState();
-    std::string sim_method = (method == "automatic") ? "statevector" : method;
-    state->configure("method", sim_method);
-    state->configure("device", "CPU");
-    state->configure("precision", "double");
-    state->configure("seed_simulator", std::to_string(qc.quantum_tasks[0].config.at("seed").get<int>()));
-
-    unsigned long n_qubits = 0;
+    unsigned long n_qubits = 0, n_clbits = 0;
     for (auto &quantum_task : qc.quantum_tasks)
     {
         n_qubits += quantum_task.config.at("num_qubits").get<unsigned long>();
+        n_clbits += quantum_task.config.at("num_clbits").get<unsigned long>();
     }
     if (size(qc.quantum_tasks) > 1)
         n_qubits += 2;
 
+    // Any AerState method is accepted; "automatic" falls back to an MPS when
+    // a dense statevector would not fit
+    std::string sim_method = method;
+    if (method == "automatic")
+        sim_method = (n_qubits > constants::MAX_DENSE_QUBITS) ? "matrix_product_state" : "statevector";
+
+    // The per-shot path can only hand the state it is simulating
+    const auto state_type = saved_state_type(qc.quantum_tasks[0].config);
+    if (!state_type.empty() && state_type != sim_method) {
+        LOGGER_ERROR("save_state \"{}\" is not available with the method \"{}\" in the per-shot AER simulation.", state_type, sim_method);
+        return {{"ERROR", "save_state \"" + state_type + "\" needs the \"" + state_type + "\" method in the per-shot AER simulation."}};
+    }
+    JSON state_json;
+
+    std::string precision;
+    try {
+        precision = run_precision(qc.quantum_tasks[0].config);
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error reading the precision of the per-shot AER simulation.");
+        return {{"ERROR", std::string(e.what())}};
+    }
+
+    AER::AerState* state = new AER::AerState();
+    state->configure("method", sim_method);
+    state->configure("device", "CPU");
+    state->configure("precision", precision);
+    state->configure("seed_simulator", std::to_string(qc.quantum_tasks[0].config.at("seed").get<int>()));
+    for (const auto* key : {"matrix_product_state_max_bond_dimension", "matrix_product_state_truncation_threshold"})
+        if (qc.quantum_tasks[0].config.contains(key))
+            state->configure(key, qc.quantum_tasks[0].config.at(key).dump());
+
+    ShotResults shot_results(qc.quantum_tasks[0].config, n_clbits, shots);
     reg_t qubit_ids;
     auto start = std::chrono::high_resolution_clock::now();
     for (std::size_t i = 0; i < shots; i++)
     {
         qubit_ids = state->allocate_qubits(n_qubits);
         state->initialize();
-        meas_counter[execute_shot_(state, qc.quantum_tasks, classical_channel)]++;
+        execute_shot_(state, qc.quantum_tasks, classical_channel, i, shot_results.row(i));
+        if (!state_type.empty() && i + 1 == shots)
+            state_json = saved_state(state_type, n_qubits, move_aer_state_to_section(state, state_type, qc.quantum_tasks[0].config));
         state->clear();
     } // End all shots
     
@@ -439,11 +589,12 @@ JSON AerSimulatorAdapter::simulate(comm::ClassicalChannel* classical_channel)
 
     delete state;
 
-    reverse_bitstring_keys_json(meas_counter);
-    JSON result_json = {
-        {"counts", meas_counter},
-        {"time_taken", time_taken}};
-    return result_json;
+    JSON result = shot_results.to_json(time_taken);
+    result["method"] = sim_method;
+    result["precision"] = precision;
+    if (!state_json.is_null())
+        result["state"] = std::move(state_json);
+    return result;
 }
 
 
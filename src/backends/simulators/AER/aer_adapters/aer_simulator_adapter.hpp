@@ -20,6 +20,9 @@ public:
 
     JSON simulate(const Backend* backend);
     JSON simulate(comm::ClassicalChannel* classical_channel = nullptr);
+    // The quantum tasks are independent circuits, the static ones go to the
+    // AER controller together
+    JSON simulate_batch(const Backend* backend);
 
     AerComputationAdapter qc;
 
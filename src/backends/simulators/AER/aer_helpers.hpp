@@ -6,7 +6,11 @@
 #include <chrono>
 #include <vector>
 
+#include "controllers/state_controller.hpp"
+
 #include "utils/helpers/reverse_bitstring.hpp"
+#include "utils/helpers/saved_state.hpp"
+#include "utils/helpers/precision.hpp"
 
 #include "logger.hpp"
 
@@ -23,6 +27,7 @@ QuantumTask quantum_task_to_AER(const QuantumTask& quantum_task)
         {"method", quantum_task.config.at("method")},
         {"shots", quantum_task.config.at("shots")},
         {"memory_slots", quantum_task.config.at("num_clbits")},
+        {"precision", run_precision(quantum_task.config)},
         // TODO: Tune in the different options of the AER simulator
     };
 
@@ -90,5 +95,72 @@ void convert_standard_results_Aer(JSON& res, const int& num_clbits)
     res.at("results")[0].at("data").at("counts") = modified_counts;
 }
 
+
+const std::string AER_SAVED_STATE_LABEL = "cunqa_saved_state";
+
+// Save instruction appended at the end of the circuit for "save_state"
+inline JSON aer_save_state_instruction(const std::string& state_type, std::size_t n_qubits)
+{
+    std::vector<std::size_t> qubits(n_qubits);
+    for (std::size_t i = 0; i < n_qubits; ++i)
+        qubits[i] = i;
+
+    std::string name, snapshot_type = "single";
+    if (state_type == "statevector") {
+        name = "save_statevector";
+    } else if (state_type == "density_matrix") {
+        // Averaged over the shots, so it is the mixed state of the run
+        name = "save_density_matrix";
+        snapshot_type = "average";
+    } else {
+        name = "save_matrix_product_state";
+    }
+
+    return {
+        {"name", name},
+        {"qubits", qubits},
+        {"label", AER_SAVED_STATE_LABEL},
+        {"snapshot_type", snapshot_type}
+    };
+}
+
+// The saved MPS is [[[G0, G1], ...], [lambda, ...]], with a pair of matrices
+// per qubit and a vector of Schmidt coefficients per bond
+inline JSON aer_saved_state_to_sections(const std::string& state_type, const JSON& saved, const JSON& config)
+{
+    if (state_type != "mps")
+        return state_section_from_json(saved, config);
+
+    JSON tensors = JSON::array();
+    for (const auto& pair : saved.at(0))
+        tensors.push_back(JSON::array({state_section_from_json(pair.at(0), config), state_section_from_json(pair.at(1), config)}));
+
+    JSON lambdas = JSON::array();
+    for (const auto& lambda : saved.at(1))
+        lambdas.push_back(state_section(lambda.get<std::vector<double>>(), {}, config));
+
+    return {{"tensors", tensors}, {"lambdas", lambdas}};
+}
+
+// State left by the last shot of the per-shot simulation. AER matrices are
+// column-major, the density matrix is written row-major as the rest.
+inline JSON move_aer_state_to_section(AER::AerState* state, const std::string& state_type, const JSON& config)
+{
+    if (state_type == "statevector") {
+        auto statevector = state->move_to_vector();
+        return state_section(statevector.data(), statevector.size(), {}, config);
+    }
+    if (state_type == "density_matrix") {
+        auto density_matrix = state->move_to_matrix();
+        const std::size_t dim = density_matrix.GetRows();
+        std::vector<std::complex<double>> row_major(dim * dim);
+        for (std::size_t row = 0; row < dim; ++row)
+            for (std::size_t col = 0; col < dim; ++col)
+                row_major[row * dim + col] = density_matrix(row, col);
+        return state_section(row_major, {dim, dim}, config);
+    }
+    throw std::runtime_error("save_state \"" + state_type + "\" is not available in the per-shot AER simulation.");
+}
+
 } // End of sim namespace
 } // End of cunqa namespace
\ No newline at end of file
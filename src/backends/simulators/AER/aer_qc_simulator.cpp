@@ -1,4 +1,6 @@
 #include "aer_qc_simulator.hpp"
+#include "utils/helpers/slurm_env.hpp"
+#include "utils/helpers/binary_result.hpp"
 
 #include <string>
 #include <cstdlib>
@@ -34,7 +36,7 @@ JSON AerQCSimulator::execute([[maybe_unused]] const QCBackend& backend, const Qu
     classical_channel.send_info(circuit, "executor");
     if (circuit != "") {
         auto results = classical_channel.recv_info("executor");
-        return JSON::parse(results);
+        return decode_result(results);
     }
     return JSON();
 }
@@ -57,8 +59,8 @@ void AerQCSimulator::write_executor_endpoint(const std::string endpoint, const s
         file_in.close();
 
         // This two SLURM variables conform the ID of the process
-        std::string local_id = std::getenv("SLURM_TASK_PID");
-        std::string job_id = std::getenv("SLURM_JOB_ID");
+        std::string local_id = get_task_pid();
+        std::string job_id = get_job_id();
         auto task_id = (group_id == "") ? job_id + "_" + local_id : job_id + "_" + local_id + "_" + group_id;
         
         j[task_id]["executor_endpoint"] = endpoint;
@@ -19,5 +19,12 @@ JSON AerSimpleSimulator::execute(const SimpleBackend& backend, const QuantumTask
         return aer_sa.simulate(&backend);
 }
 
+JSON AerSimpleSimulator::execute_batch(const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks)
+{
+    AerComputationAdapter aer_ca(quantum_tasks);
+    AerSimulatorAdapter aer_sa(aer_ca);
+    return aer_sa.simulate_batch(&backend);
+}
+
 } // End namespace sim
 } // End namespace cunqa
\ No newline at end of file
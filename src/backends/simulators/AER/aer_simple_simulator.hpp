@@ -19,6 +19,7 @@ public:
 
     inline std::string get_name() const override {return "AerSimulator";} 
     JSON execute(const SimpleBackend& backend, const QuantumTask& circuit) override;
+    JSON execute_batch(const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks) override;
 };
 
 } // End of sim namespace
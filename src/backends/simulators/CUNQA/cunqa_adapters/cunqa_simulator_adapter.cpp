@@ -4,8 +4,15 @@
 #include <chrono>
 #include <functional>
 #include <cstdlib>
+#include <type_traits>
+#include <map>
+#include <optional>
+#include <algorithm>
 
 #include "cunqa_simulator_adapter.hpp"
+#include "stabilizer_executor.hpp"
+#include "mps_executor.hpp"
+#include "statevector_executor.hpp"
 
 #include "result_cunqasim.hpp"
 #include "executor.hpp"
@@ -13,6 +20,13 @@
 
 #include "utils/constants.hpp"
 #include "utils/helpers/reverse_bitstring.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/saved_state.hpp"
+#include "utils/helpers/precision.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+#include "utils/helpers/thread_pool.hpp"
+#include "utils/helpers/statevector_sampler.hpp"
+#include "utils/helpers/shot_coroutine.hpp"
 
 #include "logger.hpp"
 
@@ -23,6 +37,7 @@ struct TaskState {
     int zero_qubit = 0;
     bool finished = false;
     bool blocked = false;
+    bool waiting = false; // For a measurement of another QPU
     bool cat_entangled = false;
     std::stack<int> telep_meas;
 };
@@ -35,12 +50,28 @@ struct GlobalState {
     bool ended = false;
     cunqa::comm::ClassicalChannel* chan = nullptr;
 };
+
+// Measurement that a shot of a lockstep batch leaves to be sent with the ones
+// of the other shots
+struct PendingSend {
+    std::string target;
+    int measurement = 0;
+    bool pending = false;
+};
 }
 
 namespace cunqa {
 namespace sim {
 
-std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel)
+// The interpreter runs on the StatevectorExecutor, the StabilizerExecutor or
+// the MPSExecutor, which share the apply_gate/apply_parametric_gate/apply_measure
+// interface of the Cunqa Executor. The shot is a coroutine that suspends while
+// a recv waits for its measurement, which the sender tags with the shot index.
+// With a batched_send, a measure_and_send leaves its measurement there and the
+// shot suspends until the batch has sent it. The quantum tasks must outlive it.
+template<typename State>
+ShotCoroutine execute_shot_(State& executor, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel,
+                            std::size_t shot, std::uint64_t* outcome, PendingSend* batched_send = nullptr)
 {
     std::unordered_map<std::string, TaskState> Ts;
     GlobalState G;
@@ -116,6 +147,8 @@ std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& qu
         case constants::Z:
         case constants::H:
         case constants::SX:
+        case constants::S:
+        case constants::SDG:
             executor.apply_gate(inst_name, {qubits[0] + T.zero_qubit});
             break;
         case constants::CX:
@@ -169,15 +202,22 @@ std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& qu
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             int measurement = executor.apply_measure({qubits[0] + T.zero_qubit});
             int measurement_as_int = static_cast<int>(measurement);
-            classical_channel->send_measure(measurement_as_int, endpoint[0]); 
+            if (batched_send)
+                *batched_send = {endpoint[0], measurement_as_int, true};
+            else
+                classical_channel->send_measure(measurement_as_int, endpoint[0], shot);
             break;
         }
         case cunqa::constants::RECV:
         {
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             auto conditional_reg = inst.at("remote_conditional_reg").get<std::vector<std::uint64_t>>();
-            int measurement = classical_channel->recv_measure(endpoint[0]);
-            G.rcreg[conditional_reg[0]] = (measurement == 1);
+            auto measurement = classical_channel->try_recv_measure(endpoint[0], shot);
+            if (!measurement) {
+                T.waiting = true;
+                return;
+            }
+            G.rcreg[conditional_reg[0]] = (*measurement == 1);
             break;
         }
         case constants::QSEND:
@@ -302,6 +342,7 @@ std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& qu
     while (!G.ended)
     {
         G.ended = true;
+        bool waiting = false;
         for (auto& [id, T]: Ts)
         {
             if (T.finished || T.blocked)
@@ -309,6 +350,14 @@ std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& qu
 
             apply_next_instr(T, {});
 
+            // The recv runs again when the shot is resumed
+            if (T.waiting) {
+                T.waiting = false;
+                waiting = true;
+                G.ended = false;
+                continue;
+            }
+
             if (!T.blocked)
                 ++T.it;
 
@@ -316,64 +365,581 @@ std::string execute_shot_(Executor& executor, const std::vector<QuantumTask>& qu
                 G.ended = false;
             else
                 T.finished = true;
+
+            if (batched_send && batched_send->pending)
+                co_await std::suspend_always{};
         }
 
+        if (waiting)
+            co_await std::suspend_always{};
     } // End one shot
 
-    std::string result_bits(G.n_clbits, '0');
+    // Outcome row with the bit order the counts keys have always had
     for (const auto &[bitIndex, value] : G.cvalues)
     {
-        result_bits[G.n_clbits - bitIndex - 1] = value ? '1' : '0';
+        if (value && bitIndex < static_cast<std::size_t>(G.n_clbits))
+            set_outcome_bit(outcome, G.n_clbits - bitIndex - 1);
+    }
+}
+
+// Engine of the per-shot simulation. "automatic" picks the stabilizer
+// engine for circuits of Clifford gates and measurements, which scale to
+// thousands of qubits, and an MPS when a dense statevector would not fit.
+// Runs that save the state stay on the statevector, the only one it is saved
+// from.
+std::string select_method_(const JSON& config, const std::vector<QuantumTask>& quantum_tasks, int n_qubits)
+{
+    const auto method = config.at("method").get<std::string>();
+    if (method == "stabilizer") {
+        if (!is_clifford(quantum_tasks))
+            throw std::runtime_error("The stabilizer method needs a circuit made only of {h, s, sdg, sx, x, y, z, cx, cy, cz, swap, measure} and communications.");
+        return "stabilizer";
+    }
+    if (method == "matrix_product_state")
+        return method;
+    if (method == "automatic") {
+        if (!saved_state_type(config).empty())
+            return "statevector";
+        if (is_clifford(quantum_tasks))
+            return "stabilizer";
+        if (static_cast<unsigned long>(n_qubits) > constants::MAX_DENSE_QUBITS)
+            return "matrix_product_state";
+    }
+    return "statevector";
+}
+
+// Runs a shot to its end, blocking while it waits for measurements
+void run_shot_(ShotCoroutine shot, comm::ClassicalChannel* classical_channel)
+{
+    shot.resume();
+    while (!shot.done()) {
+        classical_channel->wait_measure();
+        shot.resume();
+    }
+}
+
+// Shots run at the same time, each on its own executor, when they wait for
+// measurements of other QPUs: while some wait, the others proceed, so that the
+// network round trips overlap with the simulation. With "cc_shot_batch" they
+// run instead in lockstep batches of that size, which send the measurements of
+// a measure_and_send in one message. The states in flight take at most the
+// memory of one dense state of MAX_DENSE_QUBITS.
+std::size_t shots_in_flight_(const JSON& config, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel,
+                             const std::string& method, int n_qubits, int shots)
+{
+    constexpr std::size_t DEFAULT_SHOTS_IN_FLIGHT = 4;
+
+    if (!classical_channel || shots < 2 || !saved_state_type(config).empty())
+        return 1;
+    const bool lockstep = config.contains("cc_shot_batch");
+    auto communicates = [&](const QuantumTask& quantum_task) {
+        return std::any_of(quantum_task.circuit.begin(), quantum_task.circuit.end(), [&](const JSON& instruction) {
+            return instruction.at("name") == "recv" || (lockstep && instruction.at("name") == "measure_and_send");
+        });
+    };
+    if (std::none_of(quantum_tasks.begin(), quantum_tasks.end(), communicates))
+        return 1;
+
+    std::size_t in_flight = lockstep ? config.at("cc_shot_batch").get<std::size_t>()
+                          : config.contains("cc_shots_in_flight") ? config.at("cc_shots_in_flight").get<std::size_t>() : DEFAULT_SHOTS_IN_FLIGHT;
+    if (method == "statevector")
+        in_flight = std::min(in_flight, static_cast<unsigned long>(n_qubits) >= constants::MAX_DENSE_QUBITS ? std::size_t(1) : std::size_t(1) << (constants::MAX_DENSE_QUBITS - n_qubits));
+    return std::clamp<std::size_t>(in_flight, 1, shots);
+}
+
+// Seed of the executor of a shot, as shots in flight end in any order
+std::uint64_t shot_seed_(std::uint64_t seed, std::size_t shot)
+{
+    Hasher64 hasher(seed);
+    hasher.add(static_cast<std::uint64_t>(shot));
+    return hasher.digest();
+}
+
+// One executor runs the shots one after another. Restarting before each shot
+// leaves the final state of the last one available. In lockstep, the next
+// batch of shots starts when the whole batch has ended.
+template<typename State>
+void run_shots_(std::vector<std::unique_ptr<State>>& executors, const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel,
+                int shots, std::uint64_t seed, std::size_t n_clbits, ShotResults& shot_results, bool lockstep = false)
+{
+    if (executors.size() == 1) {
+        for (int i = 0; i < shots; i++) {
+            if (i > 0)
+                executors[0]->restart_statevector();
+            run_shot_(execute_shot_(*executors[0], quantum_tasks, classical_channel, i, shot_results.row(i)), classical_channel);
+        }
+        return;
     }
 
-    return result_bits;
+    struct InFlight {
+        ShotCoroutine coroutine;
+        std::size_t shot = 0;
+        std::vector<std::uint64_t> outcome;
+        PendingSend send;
+    };
+    std::vector<InFlight> in_flight(executors.size());
+    std::size_t next_shot = 0, finished = 0;
+    auto start = [&](std::size_t slot) {
+        if (next_shot == static_cast<std::size_t>(shots))
+            return;
+        auto& shot = in_flight[slot];
+        shot.shot = next_shot++;
+        shot.outcome.assign(outcome_words(n_clbits), 0);
+        executors[slot]->restart_statevector();
+        executors[slot]->reseed(shot_seed_(seed, shot.shot));
+        shot.coroutine = execute_shot_(*executors[slot], quantum_tasks, classical_channel, shot.shot, shot.outcome.data(),
+                                       lockstep ? &shot.send : nullptr);
+    };
+    for (std::size_t slot = 0; slot < in_flight.size(); slot++)
+        start(slot);
+
+    // One message per target and run of consecutive shots, the whole batch
+    // when its shots reach the same measure_and_send
+    auto send_batch = [&] {
+        std::map<std::string, std::vector<std::size_t>> slots_by_target;
+        for (std::size_t slot = 0; slot < in_flight.size(); slot++) {
+            if (in_flight[slot].send.pending)
+                slots_by_target[in_flight[slot].send.target].push_back(slot);
+        }
+        for (const auto& [target, slots] : slots_by_target) {
+            std::vector<int> measurements;
+            for (std::size_t i = 0; i < slots.size(); i++) {
+                auto& shot = in_flight[slots[i]];
+                measurements.push_back(shot.send.measurement);
+                shot.send.pending = false;
+                if (i + 1 == slots.size() || in_flight[slots[i + 1]].shot != shot.shot + 1) {
+                    classical_channel->send_measures(measurements, target, shot.shot + 1 - measurements.size());
+                    measurements.clear();
+                }
+            }
+        }
+        return !slots_by_target.empty();
+    };
+
+    while (finished < static_cast<std::size_t>(shots)) {
+        const auto received = classical_channel->measurements_received();
+        bool progressed = false;
+        for (std::size_t slot = 0; slot < in_flight.size(); slot++) {
+            auto& shot = in_flight[slot];
+            if (shot.coroutine.done())
+                continue;
+            shot.coroutine.resume();
+            if (shot.coroutine.done()) {
+                std::copy(shot.outcome.begin(), shot.outcome.end(), shot_results.row(shot.shot));
+                shot.coroutine = ShotCoroutine();
+                finished++;
+                progressed = true;
+                if (!lockstep)
+                    start(slot);
+            }
+        }
+        if (lockstep) {
+            progressed = send_batch() || progressed;
+            if (std::none_of(in_flight.begin(), in_flight.end(), [](const InFlight& shot) { return shot.coroutine.valid(); })) {
+                for (std::size_t slot = 0; slot < in_flight.size(); slot++)
+                    start(slot);
+            }
+        }
+        // Every shot waits for a measurement that is not here yet
+        if (!progressed && classical_channel->measurements_received() == received)
+            classical_channel->wait_measure();
+    }
 }
 
 JSON CunqaSimulatorAdapter::simulate([[maybe_unused]] const Backend* backend)
 {
+    const auto& config = qc.quantum_tasks[0].config;
+    std::string method, precision;
+    try {
+        method = select_method_(config, qc.quantum_tasks, config.at("num_qubits").get<int>());
+        precision = run_precision(config);
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error selecting the simulation method of the Cunqa simulator.");
+        return {{"ERROR", std::string(e.what())}};
+    }
+
+    if (method == "stabilizer") {
+        if (!is_frame_sampleable(qc.quantum_tasks[0]) || !saved_state_type(config).empty())
+            return simulate(static_cast<comm::ClassicalChannel*>(nullptr));
+
+        auto shots = config.at("shots").get<std::size_t>();
+        ShotResults shot_results(config, config.at("num_clbits").get<std::size_t>(), shots);
+        auto start = std::chrono::high_resolution_clock::now();
+        sample_clifford_shots(qc.quantum_tasks[0], shots, config.at("seed").get<std::uint64_t>(), shot_results);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<float> duration = end - start;
+
+        JSON result = shot_results.to_json(duration.count());
+        result["method"] = method;
+        return result;
+    }
+
+    // Gates followed by measurements: the statevector is simulated once and
+    // the shots are sampled from it
+    if (method == "statevector" && saved_state_type(config).empty()) {
+        if (auto prefix_end = terminal_measurements_start(qc.quantum_tasks[0]))
+            return simulate_terminal_measurements_(*prefix_end, precision);
+        if (checkpoints && prefix_checkpoints_requested(config))
+            LOGGER_DEBUG("Prefix checkpoints skipped, the circuit is not a unitary followed by measurements.");
+    }
+
+    // Executor::run is dense, the MPS goes through the per-shot interpreter
+    if (method == "matrix_product_state")
+        return simulate(static_cast<comm::ClassicalChannel*>(nullptr));
+
+    // Executor::run only samples counts in double precision, per-shot
+    // outcomes, the final statevector and complex64 amplitudes come from the
+    // per-shot interpreter
+    if (memory_requested(config) || !saved_state_type(config).empty() || precision == "single")
+        return simulate(static_cast<comm::ClassicalChannel*>(nullptr));
+
     auto n_qubits = qc.quantum_tasks[0].config.at("num_qubits").get<int>();
     auto shots = qc.quantum_tasks[0].config.at("shots").get<int>();
     Executor executor(n_qubits);
     QuantumCircuit circuit = qc.quantum_tasks[0].circuit;
     JSON result = executor.run(circuit, shots);
 
+    if (packed_result_requested(qc.quantum_tasks[0].config) && result.contains("counts")) {
+        result["packed_counts"] = PackedCounts::from_bitstrings(result.at("counts")).to_json();
+        result.erase("counts");
+    }
+    result["precision"] = precision;
+
     return result;
 
 }
 
-JSON CunqaSimulatorAdapter::simulate(comm::ClassicalChannel* classical_channel)
+// Circuits of a batch up to this size run in parallel, one per thread. The
+// kernels only spread larger statevectors over the cores.
+constexpr int MAX_POOLED_QUBITS = 14;
+
+// Walk over the trie of the unitary prefixes of the circuits of a batch (all
+// with the same number of qubits). The circuits are sorted by the ids of their
+// instructions, so the ones below a node of the trie are a contiguous range:
+// the instructions they all share are applied once, the circuits whose prefix
+// ends there are sampled, and the state is copied for every branch but the
+// last one, which goes on in place. Only the states of the branching nodes on
+// the current path are alive at once.
+template<typename T>
+void run_prefix_trie_(const std::vector<QuantumTask>& quantum_tasks, std::vector<std::size_t> indices, const std::vector<std::optional<std::size_t>>& prefix_ends, std::vector<JSON>& results, std::size_t& simulated)
 {
-    std::map<std::string, std::size_t> meas_counter;
+    const auto n_qubits = quantum_tasks[indices[0]].config.at("num_qubits").get<int>();
+    auto prefix_end = [&](std::size_t i) { return *prefix_ends[i]; };
+
+    // Every distinct instruction gets an id, found by its hash and told apart
+    // from the ones it collides with by comparing them
+    std::unordered_map<std::uint64_t, std::vector<std::pair<const JSON*, std::size_t>>> ids;
+    std::size_t n_ids = 0;
+    auto instruction_id = [&](const JSON& instruction) {
+        auto& bucket = ids[hash_instruction(instruction)];
+        for (const auto& [seen, id] : bucket)
+            if (*seen == instruction)
+                return id;
+        bucket.emplace_back(&instruction, n_ids);
+        return n_ids++;
+    };
+
+    std::map<std::size_t, std::vector<std::size_t>> keys;
+    std::size_t n_words = 1;
+    for (auto i : indices) {
+        auto& task_keys = keys[i];
+        for (std::size_t k = 0; k < prefix_end(i); k++)
+            task_keys.push_back(instruction_id(quantum_tasks[i].circuit[k]));
+        n_words = std::max(n_words, outcome_words(quantum_tasks[i].config.at("num_clbits").get<std::size_t>()));
+    }
+    std::sort(indices.begin(), indices.end(), [&](std::size_t a, std::size_t b) { return keys[a] < keys[b]; });
+
+    auto start = std::chrono::high_resolution_clock::now();
+    StatevectorExecutor<T> executor(n_qubits, 0);
+    std::vector<std::uint64_t> no_outcome(n_words, 0);
+
+    auto apply = [&](std::size_t i, std::size_t from, std::size_t to) {
+        if (from == to)
+            return;
+        const auto& circuit = quantum_tasks[i].circuit;
+        QuantumTask segment(JSON(circuit.begin() + from, circuit.begin() + to), quantum_tasks[i].config);
+        run_shot_(execute_shot_(executor, {segment}, nullptr, 0, no_outcome.data()), nullptr);
+        simulated += to - from;
+    };
+
+    // Circuits with the same seed are still sampled independently
+    auto sample = [&](std::size_t i) {
+        const auto& config = quantum_tasks[i].config;
+        auto n_clbits = config.at("num_clbits").get<std::size_t>();
+        auto shots = config.at("shots").get<std::size_t>();
+        Hasher64 seed(config.at("seed").get<std::uint64_t>());
+        seed.add(static_cast<std::uint64_t>(i));
+
+        ShotResults shot_results(config, n_clbits, shots);
+        sample_statevector(executor.data().data(), n_qubits, measured_bits(quantum_tasks[i].circuit, prefix_end(i), n_clbits), n_clbits, shots, seed.digest(), shot_results);
+        std::chrono::duration<float> duration = std::chrono::high_resolution_clock::now() - start;
+        results[i] = shot_results.to_json(duration.count());
+        results[i]["method"] = "statevector";
+        results[i]["precision"] = std::is_same_v<T, float> ? "single" : "double";
+    };
 
+    std::function<void(std::size_t, std::size_t, std::size_t)> visit = [&](std::size_t lo, std::size_t hi, std::size_t depth) {
+        // Every circuit in [lo, hi) shares the instructions before depth
+        const auto first = indices[lo];
+        std::size_t end = depth;
+        auto shared = [&](std::size_t k) {
+            for (std::size_t j = lo; j < hi; j++)
+                if (prefix_end(indices[j]) <= k || keys[indices[j]][k] != keys[first][k])
+                    return false;
+            return true;
+        };
+        while (shared(end))
+            end++;
+        apply(first, depth, end);
+
+        // The circuits that end here sort before the longer ones
+        while (lo < hi && prefix_end(indices[lo]) == end)
+            sample(indices[lo++]);
+
+        while (lo < hi) {
+            std::size_t group_end = lo + 1;
+            while (group_end < hi && keys[indices[group_end]][end] == keys[indices[lo]][end])
+                group_end++;
+            if (group_end == hi) {
+                visit(lo, hi, end);
+                break;
+            }
+            auto branch_state = executor.data();
+            visit(lo, group_end, end);
+            executor.data().swap(branch_state);
+            lo = group_end;
+        }
+    };
+    visit(0, indices.size(), 0);
+}
+
+JSON CunqaSimulatorAdapter::simulate_batch()
+{
+    const auto& quantum_tasks = qc.quantum_tasks;
+    std::vector<JSON> results(quantum_tasks.size());
+    std::vector<std::optional<std::size_t>> prefix_ends(quantum_tasks.size());
+
+    // Circuits that can share their prefixes, by number of qubits and
+    // precision, and the ones that have to run alone after the pool: large
+    // statevectors already use every core and the checkpoints are not shared
+    // among threads. The circuits that ask for checkpoints run alone, so that
+    // they resume and save theirs.
+    std::map<std::pair<int, std::string>, std::vector<std::size_t>> groups;
+    std::vector<bool> sequential(quantum_tasks.size(), false);
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++) {
+        const auto& config = quantum_tasks[i].config;
+        try {
+            auto n_qubits = config.at("num_qubits").get<int>();
+            auto method = select_method_(config, {quantum_tasks[i]}, n_qubits);
+            auto precision = run_precision(config);
+            sequential[i] = prefix_checkpoints_requested(config) || (method == "statevector" && n_qubits > MAX_POOLED_QUBITS);
+            if (quantum_tasks[i].is_dynamic || !saved_state_type(config).empty() || prefix_checkpoints_requested(config))
+                continue;
+            if (method == "statevector" && (prefix_ends[i] = terminal_measurements_start(quantum_tasks[i])))
+                groups[{n_qubits, precision}].push_back(i);
+        } catch (const std::exception& e) {
+            results[i] = {{"ERROR", std::string(e.what())}};
+        }
+    }
+
+    std::size_t instructions = 0, simulated = 0;
+    for (const auto& [key, indices] : groups) {
+        if (indices.size() < 2)
+            continue;
+        for (auto i : indices)
+            instructions += *prefix_ends[i];
+        if (key.second == "single")
+            run_prefix_trie_<float>(quantum_tasks, indices, prefix_ends, results, simulated);
+        else
+            run_prefix_trie_<double>(quantum_tasks, indices, prefix_ends, results, simulated);
+    }
+
+    auto simulate_alone = [&](std::size_t i, PrefixCheckpoints* task_checkpoints) {
+        try {
+            CunqaComputationAdapter single_ca(quantum_tasks[i]);
+            CunqaSimulatorAdapter single_sa(single_ca, task_checkpoints);
+            results[i] = quantum_tasks[i].is_dynamic ? single_sa.simulate() : single_sa.simulate(static_cast<const Backend*>(nullptr));
+        } catch (const std::exception& e) {
+            results[i] = {{"ERROR", std::string(e.what())}};
+        }
+    };
+
+    std::vector<std::size_t> pooled;
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++)
+        if (results[i].is_null() && !sequential[i])
+            pooled.push_back(i);
+    parallel_for_each_index(pooled.size(), [&](std::size_t k) { simulate_alone(pooled[k], nullptr); });
+
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++)
+        if (results[i].is_null())
+            simulate_alone(i, checkpoints);
+
+    return {
+        {"results", results},
+        {"prefix_sharing", {{"instructions", instructions}, {"simulated", simulated}}}
+    };
+}
+
+// The unitary prefix runs once on the statevector, from the last valid
+// checkpoint of the previous run of the circuit if prefix checkpoints were
+// requested, and the shots are sampled from the final state
+JSON CunqaSimulatorAdapter::simulate_terminal_measurements_(std::size_t prefix_end, const std::string& precision)
+{
+    const auto& quantum_task = qc.quantum_tasks[0];
+    const auto& config = quantum_task.config;
+    auto n_qubits = config.at("num_qubits").get<int>();
+    auto n_clbits = config.at("num_clbits").get<std::size_t>();
+    auto shots = config.at("shots").get<std::size_t>();
+    auto seed = config.at("seed").get<std::uint64_t>();
+    auto max_memory = prefix_checkpoints_max_memory(config);
+
+    ShotResults shot_results(config, n_clbits, shots);
+    JSON info;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const bool use_checkpoints = checkpoints && prefix_checkpoints_requested(config);
+    auto run_statevector = [&]<typename T>(StatevectorExecutor<T>&& executor) {
+        auto& state = executor.data();
+        PrefixCheckpoints::Plan plan;
+        if (use_checkpoints)
+            plan = checkpoints->resume(quantum_task.hash.structure, quantum_task.circuit, prefix_end, max_memory, state);
+
+        std::vector<std::uint64_t> no_outcome(outcome_words(n_clbits), 0);
+        auto apply = [&](std::size_t from, std::size_t to) {
+            if (from == to)
+                return;
+            QuantumTask segment(JSON(quantum_task.circuit.begin() + from, quantum_task.circuit.begin() + to), config);
+            run_shot_(execute_shot_(executor, {segment}, nullptr, 0, no_outcome.data()), nullptr);
+        };
+
+        std::size_t position = plan.resume_at;
+        for (auto next : plan.save_at) {
+            apply(position, next);
+            checkpoints->save(quantum_task.hash.structure, next, state, max_memory);
+            position = next;
+        }
+        apply(position, prefix_end);
+        sample_statevector(state.data(), n_qubits, measured_bits(quantum_task.circuit, prefix_end, n_clbits), n_clbits, shots, seed, shot_results);
+
+        info = {
+            {"resumed_at", plan.resume_at},
+            {"prefix_length", prefix_end},
+            {"saved", plan.save_at.size()}
+        };
+    };
+    if (precision == "single")
+        run_statevector(StatevectorExecutor<float>(n_qubits, seed));
+    else
+        run_statevector(StatevectorExecutor<double>(n_qubits, seed));
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float> duration = end - start;
+
+    JSON result = shot_results.to_json(duration.count());
+    result["method"] = "statevector";
+    result["precision"] = precision;
+    if (use_checkpoints)
+        result["prefix_checkpoints"] = info;
+    return result;
+}
+
+JSON CunqaSimulatorAdapter::simulate(comm::ClassicalChannel* classical_channel)
+{
     auto shots = qc.quantum_tasks[0].config.at("shots").get<int>();
     std::string method = qc.quantum_tasks[0].config.at("method").get<std::string>();
 
-    int n_qubits = 0;
+    int n_qubits = 0, n_clbits = 0;
     for (auto &quantum_task : qc.quantum_tasks)
     {
         n_qubits += quantum_task.config.at("num_qubits").get<int>();
+        n_clbits += quantum_task.config.at("num_clbits").get<int>();
     }
     if (size(qc.quantum_tasks) > 1)
         n_qubits += 2;
 
-    Executor executor(n_qubits);
+    std::string precision;
+    try {
+        method = select_method_(qc.quantum_tasks[0].config, qc.quantum_tasks, n_qubits);
+        precision = run_precision(qc.quantum_tasks[0].config);
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error selecting the simulation method of the Cunqa simulator.");
+        return {{"ERROR", std::string(e.what())}};
+    }
+
+    const auto& config = qc.quantum_tasks[0].config;
+    const auto state_type = saved_state_type(config);
+    if (!state_type.empty() && (state_type != "statevector" || method != "statevector")) {
+        LOGGER_ERROR("save_state {} is not supported by the {} method of the Cunqa simulator.", state_type, method);
+        return {{"ERROR", "The Cunqa simulator only saves the statevector of the statevector method, use the Aer simulator for other states."}};
+    }
+
+    ShotResults shot_results(config, n_clbits, shots);
+    JSON mps_info, state;
+    const auto seed = config.at("seed").get<std::uint64_t>();
+    const auto in_flight = shots_in_flight_(config, qc.quantum_tasks, classical_channel, method, n_qubits, shots);
+    const bool lockstep = in_flight > 1 && config.contains("cc_shot_batch");
+
+    // One executor per shot in flight
+    auto executors = [&]<typename State>(auto make_executor) {
+        std::vector<std::unique_ptr<State>> executors;
+        for (std::size_t i = 0; i < in_flight; i++)
+            executors.push_back(make_executor());
+        return executors;
+    };
+
     auto start = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < shots; i++)
-    {
-        meas_counter[execute_shot_(executor, qc.quantum_tasks, classical_channel)]++;
-        executor.restart_statevector();
-        
-    } // End all shots
+    if (method == "stabilizer") {
+        auto stabilizers = executors.template operator()<StabilizerExecutor>([&] { return std::make_unique<StabilizerExecutor>(n_qubits, seed); });
+        run_shots_(stabilizers, qc.quantum_tasks, classical_channel, shots, seed, n_clbits, shot_results, lockstep);
+    } else if (method == "matrix_product_state") {
+        auto mps = executors.template operator()<MPSExecutor>([&] {
+            return std::make_unique<MPSExecutor>(n_qubits, seed, mps_max_bond_dimension(config), mps_truncation_threshold(config));
+        });
+        run_shots_(mps, qc.quantum_tasks, classical_channel, shots, seed, n_clbits, shot_results, lockstep);
+        std::size_t bond_dimension = 0;
+        double truncation_error = 0.0;
+        for (const auto& executor : mps) {
+            bond_dimension = std::max(bond_dimension, executor->max_bond_dimension_reached());
+            truncation_error = std::max(truncation_error, executor->max_truncation_error());
+        }
+        mps_info = {
+            {"max_bond_dimension", mps_max_bond_dimension(config)},
+            {"bond_dimension", bond_dimension},
+            {"truncation_error", truncation_error}
+        };
+    } else {
+        auto run_statevector = [&]<typename T>() {
+            auto statevectors = executors.template operator()<StatevectorExecutor<T>>([&] { return std::make_unique<StatevectorExecutor<T>>(n_qubits, seed); });
+            run_shots_(statevectors, qc.quantum_tasks, classical_channel, shots, seed, n_clbits, shot_results, lockstep);
+            if (!state_type.empty())
+                state = saved_state(state_type, n_qubits, state_section(statevectors[0]->data(), {}, config));
+        };
+        if (precision == "single")
+            run_statevector.template operator()<float>();
+        else
+            run_statevector.template operator()<double>();
+    }
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> duration = end - start;
     float time_taken = duration.count();
 
-    reverse_bitstring_keys_json(meas_counter);
-    JSON result_json = {
-        {"counts", meas_counter},
-        {"time_taken", time_taken}};
-    return result_json;
+    JSON result = shot_results.to_json(time_taken);
+    result["method"] = method;
+    // The tableau is exact and the MPS always double
+    if (method == "statevector")
+        result["precision"] = precision;
+    else if (method == "matrix_product_state")
+        result["precision"] = "double";
+    if (!mps_info.is_null())
+        result["matrix_product_state"] = mps_info;
+    if (lockstep)
+        result["cc_shot_batch"] = in_flight;
+    else if (in_flight > 1)
+        result["shots_in_flight"] = in_flight;
+    if (!state.is_null())
+        result["state"] = state;
+    return result;
 }
 
 
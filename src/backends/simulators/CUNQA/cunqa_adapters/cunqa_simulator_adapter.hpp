@@ -6,6 +6,7 @@
 #include "classical_channel/classical_channel.hpp"
 #include "backends/backend.hpp"
 #include "cunqa_computation_adapter.hpp"
+#include "prefix_checkpoints.hpp"
 
 #include "utils/json.hpp"
 
@@ -16,13 +17,20 @@ class CunqaSimulatorAdapter
 {
 public:
     CunqaSimulatorAdapter() = default;
-    CunqaSimulatorAdapter(CunqaComputationAdapter& qc) : qc{qc} {}
+    CunqaSimulatorAdapter(CunqaComputationAdapter& qc, PrefixCheckpoints* checkpoints = nullptr) : qc{qc}, checkpoints{checkpoints} {}
 
     JSON simulate([[maybe_unused]] const Backend* backend);
     JSON simulate(comm::ClassicalChannel* classical_channel = nullptr);
+    // The quantum tasks are independent circuits. Those made of gates followed
+    // by measurements share the statevector of their common prefixes, the
+    // rest run in parallel on a pool of threads.
+    JSON simulate_batch();
 
     CunqaComputationAdapter qc;
+    PrefixCheckpoints* checkpoints = nullptr; // Kept by the simulator across runs
 
+private:
+    JSON simulate_terminal_measurements_(std::size_t prefix_end, const std::string& precision);
 };
 
 
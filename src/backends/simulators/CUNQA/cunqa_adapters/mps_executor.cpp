@@ -0,0 +1,367 @@
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "mps_executor.hpp"
+
+extern "C" void zgesvd_(const char* jobu, const char* jobvt, const int* m, const int* n, std::complex<double>* a, const int* lda,
+                        double* s, std::complex<double>* u, const int* ldu, std::complex<double>* vt, const int* ldvt,
+                        std::complex<double>* work, const int* lwork, double* rwork, int* info);
+
+namespace {
+
+using Complex = std::complex<double>;
+using Matrix2 = std::array<Complex, 4>;
+using Matrix4 = std::array<Complex, 16>;
+
+constexpr Complex I{0.0, 1.0};
+
+struct SVD {
+    std::vector<Complex> u;  // (rows, k), row-major
+    std::vector<double> s;   // k
+    std::vector<Complex> vt; // (k, cols), row-major
+};
+
+// Thin SVD of a row-major matrix through LAPACK, which works column-major
+SVD svd(const std::vector<Complex>& m, std::size_t rows, std::size_t cols)
+{
+    const int M = static_cast<int>(rows), N = static_cast<int>(cols), K = std::min(M, N);
+    std::vector<Complex> a(rows * cols);
+    for (std::size_t i = 0; i < rows; ++i)
+        for (std::size_t j = 0; j < cols; ++j)
+            a[j * rows + i] = m[i * cols + j];
+
+    std::vector<double> s(K), rwork(5 * K);
+    std::vector<Complex> u(rows * K), vt(K * cols);
+    int lwork = -1, info = 0;
+    Complex work_size;
+    zgesvd_("S", "S", &M, &N, a.data(), &M, s.data(), u.data(), &M, vt.data(), &K, &work_size, &lwork, rwork.data(), &info);
+    lwork = static_cast<int>(work_size.real());
+    std::vector<Complex> work(lwork);
+    zgesvd_("S", "S", &M, &N, a.data(), &M, s.data(), u.data(), &M, vt.data(), &K, work.data(), &lwork, rwork.data(), &info);
+    if (info != 0)
+        throw std::runtime_error("SVD of a matrix product state bond did not converge.");
+
+    SVD result{std::vector<Complex>(rows * K), std::move(s), std::vector<Complex>(K * cols)};
+    for (std::size_t i = 0; i < rows; ++i)
+        for (int k = 0; k < K; ++k)
+            result.u[i * K + k] = u[k * rows + i];
+    for (int k = 0; k < K; ++k)
+        for (std::size_t j = 0; j < cols; ++j)
+            result.vt[k * cols + j] = vt[j * K + k];
+    return result;
+}
+
+Matrix2 one_qubit_matrix(const std::string& name, const std::vector<double>& params)
+{
+    if (name == "id") return {1, 0, 0, 1};
+    if (name == "x") return {0, 1, 1, 0};
+    if (name == "y") return {0, -I, I, 0};
+    if (name == "z") return {1, 0, 0, -1};
+    if (name == "h") return {M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2};
+    if (name == "sx") return {Complex(0.5, 0.5), Complex(0.5, -0.5), Complex(0.5, -0.5), Complex(0.5, 0.5)};
+    if (name == "s") return {1, 0, 0, I};
+    if (name == "sdg") return {1, 0, 0, -I};
+
+    if (params.empty())
+        throw std::runtime_error("Gate " + name + " is not supported by the matrix product state simulator.");
+    const double c = std::cos(params[0] / 2), s = std::sin(params[0] / 2);
+    if (name == "rx") return {c, -I * s, -I * s, c};
+    if (name == "ry") return {c, -s, s, c};
+    if (name == "rz") return {std::exp(-I * (params[0] / 2)), 0, 0, std::exp(I * (params[0] / 2))};
+    throw std::runtime_error("Gate " + name + " is not supported by the matrix product state simulator.");
+}
+
+// Two-qubit matrices act on the index 2*s_first + s_second
+Matrix4 two_qubit_matrix(const std::string& name, const std::vector<double>& params)
+{
+    if (name == "swap")
+        return {1, 0, 0, 0,
+                0, 0, 1, 0,
+                0, 1, 0, 0,
+                0, 0, 0, 1};
+
+    if (name.empty() || name[0] != 'c')
+        throw std::runtime_error("Gate " + name + " is not supported by the matrix product state simulator.");
+    Matrix2 u = one_qubit_matrix(name.substr(1), params);
+    return {1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, u[0], u[1],
+            0, 0, u[2], u[3]};
+}
+
+// Same gate with the order of the qubits exchanged
+Matrix4 swap_qubits(const Matrix4& u)
+{
+    Matrix4 out;
+    for (std::size_t a_out = 0; a_out < 2; ++a_out)
+        for (std::size_t b_out = 0; b_out < 2; ++b_out)
+            for (std::size_t a_in = 0; a_in < 2; ++a_in)
+                for (std::size_t b_in = 0; b_in < 2; ++b_in)
+                    out[(b_out * 2 + a_out) * 4 + (b_in * 2 + a_in)] = u[(a_out * 2 + b_out) * 4 + (a_in * 2 + b_in)];
+    return out;
+}
+
+const Matrix4 SWAP = two_qubit_matrix("swap", {});
+
+} // End of anonymous namespace
+
+namespace cunqa {
+namespace sim {
+
+std::size_t mps_max_bond_dimension(const JSON& config)
+{
+    if (config.contains("matrix_product_state_max_bond_dimension"))
+        return config.at("matrix_product_state_max_bond_dimension").get<std::size_t>();
+    return 256;
+}
+
+double mps_truncation_threshold(const JSON& config)
+{
+    if (config.contains("matrix_product_state_truncation_threshold"))
+        return config.at("matrix_product_state_truncation_threshold").get<double>();
+    return 1e-16;
+}
+
+MPSExecutor::MPSExecutor(int n_qubits, std::uint64_t seed, std::size_t max_bond_dimension, double truncation_threshold) :
+    n_qubits_{static_cast<std::size_t>(n_qubits)},
+    max_bond_dimension_{std::max<std::size_t>(1, max_bond_dimension)},
+    truncation_threshold_{truncation_threshold},
+    sites_(n_qubits_),
+    rng_{seed}
+{
+    restart_statevector();
+}
+
+void MPSExecutor::restart_statevector()
+{
+    for (auto& site : sites_) {
+        site.left = site.right = 1;
+        site.data = {1.0, 0.0};
+    }
+    center_ = 0;
+    max_truncation_error_ = std::max(max_truncation_error_, truncation_error_);
+    truncation_error_ = 0.0;
+}
+
+void MPSExecutor::apply_gate(const std::string& gate_name, const std::vector<int>& qubits)
+{
+    apply_parametric_gate(gate_name, qubits, {});
+}
+
+void MPSExecutor::apply_parametric_gate(const std::string& gate_name, const std::vector<int>& qubits, const std::vector<double>& params)
+{
+    if (qubits.size() == 1)
+        apply_one_site_(qubits[0], one_qubit_matrix(gate_name, params));
+    else if (qubits.size() == 2)
+        apply_two_sites_(qubits[0], qubits[1], two_qubit_matrix(gate_name, params));
+    else
+        throw std::runtime_error("Gate " + gate_name + " is not supported by the matrix product state simulator.");
+}
+
+int MPSExecutor::apply_measure(const std::vector<int>& qubits)
+{
+    const std::size_t q = qubits[0];
+    move_center_to_(q);
+    Site& site = sites_[q];
+
+    double p[2] = {0.0, 0.0};
+    for (std::size_t l = 0; l < site.left; ++l)
+        for (std::size_t s = 0; s < 2; ++s)
+            for (std::size_t r = 0; r < site.right; ++r)
+                p[s] += std::norm(site.data[(l * 2 + s) * site.right + r]);
+
+    const double total = p[0] + p[1];
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    const int outcome = uniform(rng_) < p[0] ? 0 : 1;
+
+    // Projection, the center stays normalized
+    const double scale = 1.0 / std::sqrt(p[outcome]);
+    for (std::size_t l = 0; l < site.left; ++l)
+        for (std::size_t s = 0; s < 2; ++s)
+            for (std::size_t r = 0; r < site.right; ++r) {
+                auto& value = site.data[(l * 2 + s) * site.right + r];
+                value = (static_cast<int>(s) == outcome) ? value * scale : Complex(0.0);
+            }
+    return outcome;
+}
+
+void MPSExecutor::apply_one_site_(std::size_t q, const Matrix2& u)
+{
+    Site& site = sites_[q];
+    for (std::size_t l = 0; l < site.left; ++l)
+        for (std::size_t r = 0; r < site.right; ++r) {
+            auto& a0 = site.data[(l * 2) * site.right + r];
+            auto& a1 = site.data[(l * 2 + 1) * site.right + r];
+            const Complex b0 = u[0] * a0 + u[1] * a1;
+            const Complex b1 = u[2] * a0 + u[3] * a1;
+            a0 = b0;
+            a1 = b1;
+        }
+}
+
+void MPSExecutor::apply_two_sites_(std::size_t a, std::size_t b, const Matrix4& u)
+{
+    if (a == b || a >= n_qubits_ || b >= n_qubits_)
+        throw std::runtime_error("Invalid qubits for a two-qubit gate in the matrix product state simulator.");
+
+    if (b > a) {
+        // Bring b next to a, apply and take it back
+        for (std::size_t j = b; j > a + 1; --j)
+            apply_adjacent_(j - 1, SWAP);
+        apply_adjacent_(a, u);
+        for (std::size_t j = a + 1; j < b; ++j)
+            apply_adjacent_(j, SWAP);
+    } else {
+        for (std::size_t j = b; j + 1 < a; ++j)
+            apply_adjacent_(j, SWAP);
+        apply_adjacent_(a - 1, swap_qubits(u));
+        for (std::size_t j = a - 1; j > b; --j)
+            apply_adjacent_(j - 1, SWAP);
+    }
+}
+
+// Contracts sites i and i+1, applies the gate and splits them again with an SVD
+void MPSExecutor::apply_adjacent_(std::size_t i, const Matrix4& u)
+{
+    move_center_to_(i);
+    Site& A = sites_[i];
+    Site& B = sites_[i + 1];
+    const std::size_t l = A.left, m = A.right, r = B.right;
+
+    std::vector<Complex> theta(l * 4 * r, 0.0);
+    for (std::size_t x = 0; x < l; ++x)
+        for (std::size_t s1 = 0; s1 < 2; ++s1)
+            for (std::size_t k = 0; k < m; ++k) {
+                const Complex a = A.data[(x * 2 + s1) * m + k];
+                if (a == Complex(0.0)) continue;
+                for (std::size_t s2 = 0; s2 < 2; ++s2)
+                    for (std::size_t y = 0; y < r; ++y)
+                        theta[((x * 2 + s1) * 2 + s2) * r + y] += a * B.data[(k * 2 + s2) * r + y];
+            }
+
+    std::vector<Complex> gated(l * 4 * r, 0.0);
+    for (std::size_t x = 0; x < l; ++x)
+        for (std::size_t out = 0; out < 4; ++out)
+            for (std::size_t in = 0; in < 4; ++in) {
+                const Complex g = u[out * 4 + in];
+                if (g == Complex(0.0)) continue;
+                for (std::size_t y = 0; y < r; ++y)
+                    gated[(x * 4 + out) * r + y] += g * theta[(x * 4 + in) * r + y];
+            }
+
+    // (l*2) x (2*r) matrix, rows (x, s1) and columns (s2, y)
+    SVD d = svd(gated, 2 * l, 2 * r);
+    const std::size_t K = d.s.size();
+    const std::size_t keep = truncate_(d.s);
+
+    A.right = keep;
+    A.data.assign(2 * l * keep, 0.0);
+    for (std::size_t row = 0; row < 2 * l; ++row)
+        for (std::size_t k = 0; k < keep; ++k)
+            A.data[row * keep + k] = d.u[row * K + k];
+
+    B.left = keep;
+    B.data.assign(keep * 2 * r, 0.0);
+    for (std::size_t k = 0; k < keep; ++k)
+        for (std::size_t col = 0; col < 2 * r; ++col)
+            B.data[k * 2 * r + col] = d.s[k] * d.vt[k * 2 * r + col];
+
+    center_ = i + 1;
+    max_bond_reached_ = std::max(max_bond_reached_, keep);
+}
+
+void MPSExecutor::move_center_to_(std::size_t i)
+{
+    while (center_ < i)
+        shift_center_right_();
+    while (center_ > i)
+        shift_center_left_();
+}
+
+void MPSExecutor::shift_center_right_()
+{
+    Site& A = sites_[center_];
+    Site& N = sites_[center_ + 1];
+    const std::size_t l = A.left, r = A.right, r2 = N.right;
+
+    SVD d = svd(A.data, 2 * l, r);
+    const std::size_t K = d.s.size();
+    const std::size_t keep = truncate_(d.s);
+
+    A.right = keep;
+    A.data.assign(2 * l * keep, 0.0);
+    for (std::size_t row = 0; row < 2 * l; ++row)
+        for (std::size_t k = 0; k < keep; ++k)
+            A.data[row * keep + k] = d.u[row * K + k];
+
+    // S V^dagger is absorbed by the next site
+    std::vector<Complex> next(keep * 2 * r2, 0.0);
+    for (std::size_t k = 0; k < keep; ++k)
+        for (std::size_t j = 0; j < r; ++j) {
+            const Complex sv = d.s[k] * d.vt[k * r + j];
+            for (std::size_t col = 0; col < 2 * r2; ++col)
+                next[k * 2 * r2 + col] += sv * N.data[j * 2 * r2 + col];
+        }
+    N.left = keep;
+    N.data = std::move(next);
+    ++center_;
+}
+
+void MPSExecutor::shift_center_left_()
+{
+    Site& A = sites_[center_];
+    Site& P = sites_[center_ - 1];
+    const std::size_t l = A.left, r = A.right, l0 = P.left;
+
+    SVD d = svd(A.data, l, 2 * r);
+    const std::size_t K = d.s.size();
+    const std::size_t keep = truncate_(d.s);
+
+    A.left = keep;
+    A.data.assign(keep * 2 * r, 0.0);
+    for (std::size_t k = 0; k < keep; ++k)
+        for (std::size_t col = 0; col < 2 * r; ++col)
+            A.data[k * 2 * r + col] = d.vt[k * 2 * r + col];
+
+    // U S is absorbed by the previous site
+    std::vector<Complex> prev(2 * l0 * keep, 0.0);
+    for (std::size_t row = 0; row < 2 * l0; ++row)
+        for (std::size_t j = 0; j < l; ++j) {
+            const Complex p = P.data[row * l + j];
+            if (p == Complex(0.0)) continue;
+            for (std::size_t k = 0; k < keep; ++k)
+                prev[row * keep + k] += p * d.u[j * K + k] * d.s[k];
+        }
+    P.right = keep;
+    P.data = std::move(prev);
+    --center_;
+}
+
+// Number of singular values kept. They are renormalized so that the state
+// keeps norm one; the discarded weight is added to the truncation error.
+std::size_t MPSExecutor::truncate_(std::vector<double>& s)
+{
+    const double total = std::accumulate(s.begin(), s.end(), 0.0, [](double acc, double v) { return acc + v * v; });
+    std::size_t keep = std::min(s.size(), max_bond_dimension_);
+    double discarded = 0.0;
+    for (std::size_t k = keep; k < s.size(); ++k)
+        discarded += s[k] * s[k];
+    while (keep > 1 && (discarded + s[keep - 1] * s[keep - 1]) <= truncation_threshold_ * total) {
+        --keep;
+        discarded += s[keep] * s[keep];
+    }
+
+    if (total > 0.0)
+        truncation_error_ += discarded / total;
+
+    const double scale = (total - discarded) > 0.0 ? 1.0 / std::sqrt(total - discarded) : 1.0;
+    s.resize(keep);
+    for (auto& v : s)
+        v *= scale;
+    return keep;
+}
+
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <random>
+#include <complex>
+#include <cstdint>
+
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace sim {
+
+// Matrix product state with the interface of the Cunqa Executor that the
+// per-shot interpreter uses. Qubit i is site i, a tensor of shape
+// (left bond, 2, right bond). The state is kept in mixed canonical form around
+// an orthogonality center, so measuring a qubit only needs the center moved
+// there. Two-qubit gates on distant qubits are applied after bringing them
+// together with SWAPs, which is cheap for the nearly linear circuits that the
+// quantum communications produce.
+//
+// Each two-site update keeps at most max_bond_dimension singular values and
+// drops the smallest ones while their weight stays under the truncation
+// threshold. The discarded weight is accumulated as the truncation error of
+// the shot.
+class MPSExecutor
+{
+public:
+    MPSExecutor(int n_qubits, std::uint64_t seed, std::size_t max_bond_dimension, double truncation_threshold);
+
+    void apply_gate(const std::string& gate_name, const std::vector<int>& qubits);
+    void apply_parametric_gate(const std::string& gate_name, const std::vector<int>& qubits, const std::vector<double>& params);
+    int apply_measure(const std::vector<int>& qubits);
+    // Back to |0...0>, named as in the Executor
+    void restart_statevector();
+    // Measurements from here on draw from a generator with this seed
+    void reseed(std::uint64_t seed) { rng_.seed(seed); }
+
+    // Discarded weight since the last restart
+    double truncation_error() const { return truncation_error_; }
+    // Largest discarded weight of a shot since the construction
+    double max_truncation_error() const { return std::max(max_truncation_error_, truncation_error_); }
+    // Largest bond dimension since the construction
+    std::size_t max_bond_dimension_reached() const { return max_bond_reached_; }
+
+private:
+    using Complex = std::complex<double>;
+    using Matrix2 = std::array<Complex, 4>;
+    using Matrix4 = std::array<Complex, 16>;
+
+    struct Site {
+        std::size_t left = 1, right = 1;
+        std::vector<Complex> data; // (left, 2, right), row-major
+    };
+
+    std::size_t n_qubits_;
+    std::size_t max_bond_dimension_;
+    double truncation_threshold_;
+    std::vector<Site> sites_;
+    std::size_t center_ = 0;
+    double truncation_error_ = 0.0;
+    double max_truncation_error_ = 0.0;
+    std::size_t max_bond_reached_ = 1;
+    std::mt19937_64 rng_;
+
+    void apply_one_site_(std::size_t q, const Matrix2& u);
+    void apply_two_sites_(std::size_t a, std::size_t b, const Matrix4& u);
+    void apply_adjacent_(std::size_t i, const Matrix4& u);
+    void move_center_to_(std::size_t i);
+    void shift_center_right_();
+    void shift_center_left_();
+    std::size_t truncate_(std::vector<double>& s);
+};
+
+// Bond dimension cap and truncation threshold from the run config, with the
+// option names of the AER matrix_product_state method
+std::size_t mps_max_bond_dimension(const JSON& config);
+double mps_truncation_threshold(const JSON& config);
+
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,160 @@
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
+
+#include "prefix_checkpoints.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+#include "utils/helpers/statevector_sampler.hpp"
+
+#include "logger.hpp"
+
+namespace {
+
+// Last circuits whose prefix is remembered, with or without checkpoints
+constexpr std::size_t MAX_ENTRIES = 64;
+
+const std::unordered_set<std::string> UNITARY_GATES = {
+    "id", "x", "y", "z", "h", "sx", "s", "sdg", "cx", "cy", "cz", "rx", "ry", "rz", "crx", "cry", "crz", "swap"
+};
+
+bool is_parametric(const cunqa::JSON& instruction)
+{
+    return instruction.contains("params") && !instruction.at("params").empty();
+}
+
+template<typename T>
+std::uint64_t checkpoint_key(std::uint64_t structure)
+{
+    cunqa::Hasher64 hasher(structure);
+    hasher.add(static_cast<std::uint64_t>(sizeof(T)));
+    return hasher.digest();
+}
+
+// Starts of the runs of parametric gates and the end of the prefix, thinned
+// out evenly (keeping the end) to at most max_checkpoints
+std::vector<std::size_t> checkpoint_positions(const cunqa::JSON& circuit, std::size_t prefix_end, std::size_t max_checkpoints)
+{
+    std::vector<std::size_t> boundaries;
+    for (std::size_t i = 1; i < prefix_end; i++)
+        if (is_parametric(circuit[i]) && !is_parametric(circuit[i - 1]))
+            boundaries.push_back(i);
+    if (prefix_end > 0)
+        boundaries.push_back(prefix_end);
+
+    if (boundaries.size() <= max_checkpoints)
+        return boundaries;
+
+    std::vector<std::size_t> positions;
+    for (std::size_t j = 1; j <= max_checkpoints; j++)
+        positions.push_back(boundaries[(j * boundaries.size()) / max_checkpoints - 1]);
+    return positions;
+}
+
+} // End of anonymous namespace
+
+namespace cunqa {
+namespace sim {
+
+std::optional<std::size_t> terminal_measurements_start(const QuantumTask& quantum_task)
+{
+    if (quantum_task.is_dynamic || quantum_task.has_cc)
+        return std::nullopt;
+
+    auto prefix_end = final_measurements_start(quantum_task.circuit);
+    if (!prefix_end)
+        return std::nullopt;
+    for (std::size_t i = 0; i < *prefix_end; i++)
+        if (!UNITARY_GATES.contains(quantum_task.circuit[i].at("name").get<std::string>()))
+            return std::nullopt;
+    return prefix_end;
+}
+
+template<typename T>
+PrefixCheckpoints::Plan PrefixCheckpoints::resume(std::uint64_t structure, const JSON& circuit, std::size_t prefix_end, std::size_t max_memory, std::vector<std::complex<T>>& state)
+{
+    const auto key = checkpoint_key<T>(structure);
+    const std::size_t bytes = state.size() * sizeof(std::complex<T>);
+    const auto positions = checkpoint_positions(circuit, prefix_end, max_memory / bytes);
+    JSON prefix(circuit.begin(), circuit.begin() + prefix_end);
+
+    Plan plan;
+    auto it = find_(key);
+    if (it == entries_.end()) {
+        entries_.push_front(Entry{key, std::move(prefix), {}});
+        if (entries_.size() > MAX_ENTRIES) {
+            for (const auto& checkpoint : entries_.back().checkpoints)
+                memory_ -= checkpoint.state.size();
+            entries_.pop_back();
+        }
+    } else {
+        entries_.splice(entries_.begin(), entries_, it);
+        auto& entry = entries_.front();
+
+        std::size_t first_changed = 0;
+        if (entry.prefix.size() == prefix_end)
+            while (first_changed < prefix_end && entry.prefix[first_changed] == prefix[first_changed])
+                first_changed++;
+
+        // A checkpoint is still valid if every instruction before it is the
+        // same, and is kept if it is still one of the planned positions
+        std::erase_if(entry.checkpoints, [&](const Checkpoint& checkpoint) {
+            bool keep = checkpoint.position <= first_changed && checkpoint.state.size() == bytes && std::binary_search(positions.begin(), positions.end(), checkpoint.position);
+            if (!keep)
+                memory_ -= checkpoint.state.size();
+            return !keep;
+        });
+        entry.prefix = std::move(prefix);
+
+        if (!entry.checkpoints.empty()) {
+            const auto& checkpoint = entry.checkpoints.back();
+            std::memcpy(static_cast<void*>(state.data()), checkpoint.state.data(), bytes);
+            plan.resume_at = checkpoint.position;
+        }
+    }
+
+    for (auto position : positions)
+        if (position > plan.resume_at)
+            plan.save_at.push_back(position);
+    return plan;
+}
+
+template<typename T>
+void PrefixCheckpoints::save(std::uint64_t structure, std::size_t position, const std::vector<std::complex<T>>& state, std::size_t max_memory)
+{
+    auto it = find_(checkpoint_key<T>(structure));
+    if (it == entries_.end())
+        return;
+    const std::size_t bytes = state.size() * sizeof(std::complex<T>);
+
+    // Room is made dropping the checkpoints of the least recently run circuits
+    for (auto other = std::prev(entries_.end()); memory_ + bytes > max_memory && other != it; --other) {
+        for (const auto& checkpoint : other->checkpoints)
+            memory_ -= checkpoint.state.size();
+        other->checkpoints.clear();
+    }
+    if (memory_ + bytes > max_memory) {
+        LOGGER_DEBUG("Checkpoint after instruction {} skipped, it does not fit in the memory budget.", position);
+        return;
+    }
+
+    Checkpoint checkpoint{position, std::vector<char>(bytes)};
+    std::memcpy(checkpoint.state.data(), static_cast<const void*>(state.data()), bytes);
+    it->checkpoints.push_back(std::move(checkpoint));
+    memory_ += bytes;
+}
+
+std::list<PrefixCheckpoints::Entry>::iterator PrefixCheckpoints::find_(std::uint64_t key)
+{
+    return std::find_if(entries_.begin(), entries_.end(), [key](const Entry& entry) { return entry.key == key; });
+}
+
+#define INSTANTIATE_PREFIX_CHECKPOINTS(T) \
+    template PrefixCheckpoints::Plan PrefixCheckpoints::resume<T>(std::uint64_t, const JSON&, std::size_t, std::size_t, std::vector<std::complex<T>>&); \
+    template void PrefixCheckpoints::save<T>(std::uint64_t, std::size_t, const std::vector<std::complex<T>>&, std::size_t);
+
+INSTANTIATE_PREFIX_CHECKPOINTS(double)
+INSTANTIATE_PREFIX_CHECKPOINTS(float)
+
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace sim {
+
+// Checkpoints of the statevector requested in the run config
+// ("prefix_checkpoints": true), bounded by "prefix_checkpoints_max_memory_mb"
+inline bool prefix_checkpoints_requested(const JSON& config)
+{
+    return config.contains("prefix_checkpoints") && config.at("prefix_checkpoints").is_boolean() && config.at("prefix_checkpoints").get<bool>();
+}
+
+inline std::size_t prefix_checkpoints_max_memory(const JSON& config)
+{
+    std::size_t mb = config.contains("prefix_checkpoints_max_memory_mb") ? config.at("prefix_checkpoints_max_memory_mb").get<std::size_t>() : 1024;
+    return mb << 20;
+}
+
+// Start of the measurements when the circuit is a unitary prefix of gates of
+// the in-tree statevector followed only by measurements, nullopt otherwise
+// (mid-circuit measurements, conditionals or communications)
+std::optional<std::size_t> terminal_measurements_start(const QuantumTask& quantum_task);
+
+// Statevectors at the layer boundaries of the unitary prefix of the last
+// runs of each circuit (keyed by its structure hash), so that a run that
+// only changes the parameters from some layer on resumes from the last
+// checkpoint before the first changed instruction instead of |0...0>.
+// A layer boundary is the start of a run of parametric gates, as the
+// rotation layers of an ansatz, and the end of the prefix is also kept.
+//
+// Every checkpoint is a full copy of the state, so the checkpoints kept fit
+// in the memory budget of the run: evenly spread boundaries for the current
+// circuit, and the checkpoints of the least recently run circuits are dropped
+// to make room for them.
+class PrefixCheckpoints
+{
+public:
+    struct Plan {
+        std::size_t resume_at = 0;       // The state was loaded up to this instruction
+        std::vector<std::size_t> save_at; // Positions after resume_at to checkpoint
+    };
+
+    // Loads into state the latest valid checkpoint of the prefix
+    // circuit[0, prefix_end) and plans the ones to save in this run
+    template<typename T>
+    Plan resume(std::uint64_t structure, const JSON& circuit, std::size_t prefix_end, std::size_t max_memory, std::vector<std::complex<T>>& state);
+
+    // The state after circuit[0, position)
+    template<typename T>
+    void save(std::uint64_t structure, std::size_t position, const std::vector<std::complex<T>>& state, std::size_t max_memory);
+
+    std::size_t memory() const { return memory_; }
+
+private:
+    struct Checkpoint {
+        std::size_t position;
+        std::vector<char> state;
+    };
+    struct Entry {
+        std::uint64_t key;
+        JSON prefix; // Instructions of the prefix in the last run
+        std::vector<Checkpoint> checkpoints; // Sorted by position
+    };
+
+    std::list<Entry> entries_; // Most recently run first
+    std::size_t memory_ = 0;
+
+    std::list<Entry>::iterator find_(std::uint64_t key);
+};
+
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,417 @@
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "stabilizer_executor.hpp"
+
+namespace {
+
+const std::unordered_set<std::string> CLIFFORD_INSTRUCTIONS = {
+    "id", "h", "s", "sdg", "sx", "x", "y", "z", "cx", "cy", "cz", "swap", "measure"
+};
+
+// Communication instructions, interpreted with Clifford gates and measurements
+const std::unordered_set<std::string> CLIFFORD_COMM_INSTRUCTIONS = {
+    "measure_and_send", "recv", "qsend", "qrecv", "expose"
+};
+
+bool is_clifford_instruction(const cunqa::JSON& inst)
+{
+    const auto& name = inst.at("name").get_ref<const std::string&>();
+    if (CLIFFORD_INSTRUCTIONS.contains(name) || CLIFFORD_COMM_INSTRUCTIONS.contains(name))
+        return true;
+    if (name.rfind("c_if_", 0) == 0)
+        return true; // Placeholders, the interpreter skips them
+    if (name == "rcontrol")
+        return std::all_of(inst.at("instructions").begin(), inst.at("instructions").end(), is_clifford_instruction);
+    return false;
+}
+
+enum class FrameOp { NONE, H, S, SX, CX, CY, CZ, SWAP, MEASURE };
+
+struct FrameInstruction {
+    FrameOp op;
+    std::size_t a = 0, b = 0;
+    std::size_t clbit = 0;
+};
+
+} // End of anonymous namespace
+
+namespace cunqa {
+namespace sim {
+
+StabilizerExecutor::StabilizerExecutor(int n_qubits, std::uint64_t seed) :
+    n_qubits_{static_cast<std::size_t>(n_qubits)},
+    n_words_{std::max<std::size_t>(1, (n_qubits_ + 63) / 64)},
+    x_((2 * n_qubits_ + 1) * n_words_),
+    z_((2 * n_qubits_ + 1) * n_words_),
+    r_(2 * n_qubits_ + 1),
+    rng_{seed}
+{
+    restart_statevector();
+}
+
+void StabilizerExecutor::restart_statevector()
+{
+    std::fill(x_.begin(), x_.end(), 0);
+    std::fill(z_.begin(), z_.end(), 0);
+    std::fill(r_.begin(), r_.end(), 0);
+    for (std::size_t q = 0; q < n_qubits_; ++q) {
+        x_row_(q)[q / 64] |= std::uint64_t(1) << (q % 64);
+        z_row_(q + n_qubits_)[q / 64] |= std::uint64_t(1) << (q % 64);
+    }
+}
+
+void StabilizerExecutor::apply_gate(const std::string& gate_name, const std::vector<int>& qubits)
+{
+    if (gate_name == "h") h(qubits[0]);
+    else if (gate_name == "s") s(qubits[0]);
+    else if (gate_name == "sdg") sdg(qubits[0]);
+    else if (gate_name == "sx") sx(qubits[0]);
+    else if (gate_name == "x") x(qubits[0]);
+    else if (gate_name == "y") y(qubits[0]);
+    else if (gate_name == "z") z(qubits[0]);
+    else if (gate_name == "id") return;
+    else if (gate_name == "cx") cx(qubits[0], qubits[1]);
+    else if (gate_name == "cy") cy(qubits[0], qubits[1]);
+    else if (gate_name == "cz") cz(qubits[0], qubits[1]);
+    else if (gate_name == "swap") swap(qubits[0], qubits[1]);
+    else throw std::runtime_error("Gate " + gate_name + " is not a Clifford gate supported by the stabilizer simulator.");
+}
+
+void StabilizerExecutor::apply_parametric_gate(const std::string& gate_name, [[maybe_unused]] const std::vector<int>& qubits, [[maybe_unused]] const std::vector<double>& params)
+{
+    throw std::runtime_error("Parametric gate " + gate_name + " can not be simulated by the stabilizer simulator.");
+}
+
+int StabilizerExecutor::apply_measure(const std::vector<int>& qubits)
+{
+    return measure(qubits[0]);
+}
+
+// Gates update a single column of every row, with the phase rules of the
+// CHP paper (Aaronson and Gottesman, 2004)
+void StabilizerExecutor::h(std::size_t q)
+{
+    const std::size_t w = q / 64;
+    const std::uint64_t m = std::uint64_t(1) << (q % 64);
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i) {
+        std::uint64_t& xw = x_[i * n_words_ + w];
+        std::uint64_t& zw = z_[i * n_words_ + w];
+        const bool xa = xw & m, za = zw & m;
+        r_[i] ^= xa & za;
+        if (xa != za) {
+            xw ^= m;
+            zw ^= m;
+        }
+    }
+}
+
+void StabilizerExecutor::s(std::size_t q)
+{
+    const std::size_t w = q / 64;
+    const std::uint64_t m = std::uint64_t(1) << (q % 64);
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i) {
+        const std::uint64_t xm = x_[i * n_words_ + w] & m;
+        r_[i] ^= (xm & z_[i * n_words_ + w]) != 0;
+        z_[i * n_words_ + w] ^= xm;
+    }
+}
+
+void StabilizerExecutor::sdg(std::size_t q)
+{
+    const std::size_t w = q / 64;
+    const std::uint64_t m = std::uint64_t(1) << (q % 64);
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i) {
+        const std::uint64_t xm = x_[i * n_words_ + w] & m;
+        r_[i] ^= (xm & ~z_[i * n_words_ + w]) != 0;
+        z_[i * n_words_ + w] ^= xm;
+    }
+}
+
+void StabilizerExecutor::sx(std::size_t q)
+{
+    h(q);
+    s(q);
+    h(q);
+}
+
+void StabilizerExecutor::x(std::size_t q)
+{
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i)
+        r_[i] ^= z_bit_(i, q);
+}
+
+void StabilizerExecutor::y(std::size_t q)
+{
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i)
+        r_[i] ^= x_bit_(i, q) ^ z_bit_(i, q);
+}
+
+void StabilizerExecutor::z(std::size_t q)
+{
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i)
+        r_[i] ^= x_bit_(i, q);
+}
+
+void StabilizerExecutor::cx(std::size_t control, std::size_t target)
+{
+    const std::size_t wc = control / 64, wt = target / 64;
+    const std::uint64_t mc = std::uint64_t(1) << (control % 64), mt = std::uint64_t(1) << (target % 64);
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i) {
+        std::uint64_t* xr = x_row_(i);
+        std::uint64_t* zr = z_row_(i);
+        const bool xc = xr[wc] & mc, zc = zr[wc] & mc;
+        const bool xt = xr[wt] & mt, zt = zr[wt] & mt;
+        r_[i] ^= xc & zt & (xt ^ zc ^ true);
+        if (xc) xr[wt] ^= mt;
+        if (zt) zr[wc] ^= mc;
+    }
+}
+
+void StabilizerExecutor::cy(std::size_t control, std::size_t target)
+{
+    sdg(target);
+    cx(control, target);
+    s(target);
+}
+
+void StabilizerExecutor::cz(std::size_t a, std::size_t b)
+{
+    h(b);
+    cx(a, b);
+    h(b);
+}
+
+void StabilizerExecutor::swap(std::size_t a, std::size_t b)
+{
+    const std::size_t wa = a / 64, wb = b / 64;
+    const std::uint64_t ma = std::uint64_t(1) << (a % 64), mb = std::uint64_t(1) << (b % 64);
+    for (std::size_t i = 0; i < 2 * n_qubits_; ++i) {
+        for (auto* row : {x_row_(i), z_row_(i)}) {
+            const bool va = row[wa] & ma, vb = row[wb] & mb;
+            if (va != vb) {
+                row[wa] ^= ma;
+                row[wb] ^= mb;
+            }
+        }
+    }
+}
+
+// Row h becomes the product of the Paulis of rows i and h. The phase
+// exponent of the product is accumulated for 64 qubits at a time: each
+// qubit contributes +1, -1 or 0 (the g function of CHP), computed with masks.
+void StabilizerExecutor::rowsum_(std::size_t h, std::size_t i)
+{
+    std::uint64_t* xh = x_row_(h);
+    std::uint64_t* zh = z_row_(h);
+    const std::uint64_t* xi = x_row_(i);
+    const std::uint64_t* zi = z_row_(i);
+
+    long plus = 0, minus = 0;
+    #pragma omp simd reduction(+:plus, minus)
+    for (std::size_t w = 0; w < n_words_; ++w) {
+        const std::uint64_t x1 = xi[w], z1 = zi[w], x2 = xh[w], z2 = zh[w];
+        const std::uint64_t y1 = x1 & z1, only_x1 = x1 & ~z1, only_z1 = ~x1 & z1;
+        const std::uint64_t p = (y1 & z2 & ~x2) | (only_x1 & z2 & x2) | (only_z1 & x2 & ~z2);
+        const std::uint64_t n = (y1 & x2 & ~z2) | (only_x1 & z2 & ~x2) | (only_z1 & x2 & z2);
+        plus += std::popcount(p);
+        minus += std::popcount(n);
+        xh[w] = x2 ^ x1;
+        zh[w] = z2 ^ z1;
+    }
+
+    const long phase = ((2 * r_[h] + 2 * r_[i] + plus - minus) % 4 + 4) % 4;
+    r_[h] = (phase == 2);
+}
+
+void StabilizerExecutor::copy_row_(std::size_t to, std::size_t from)
+{
+    std::copy_n(x_row_(from), n_words_, x_row_(to));
+    std::copy_n(z_row_(from), n_words_, z_row_(to));
+    r_[to] = r_[from];
+}
+
+void StabilizerExecutor::clear_row_(std::size_t row)
+{
+    std::fill_n(x_row_(row), n_words_, 0);
+    std::fill_n(z_row_(row), n_words_, 0);
+    r_[row] = 0;
+}
+
+int StabilizerExecutor::measure(std::size_t q)
+{
+    const std::size_t n = n_qubits_;
+
+    // Random outcome if some stabilizer anticommutes with Z_q
+    std::size_t p = n;
+    while (p < 2 * n && !x_bit_(p, q))
+        ++p;
+
+    if (p < 2 * n) {
+        for (std::size_t i = 0; i < 2 * n; ++i)
+            if (i != p && x_bit_(i, q))
+                rowsum_(i, p);
+        copy_row_(p - n, p);
+        clear_row_(p);
+        z_row_(p)[q / 64] |= std::uint64_t(1) << (q % 64);
+        r_[p] = rng_() & 1;
+        return r_[p];
+    }
+
+    // Deterministic outcome, gathered in the scratch row
+    clear_row_(2 * n);
+    for (std::size_t i = 0; i < n; ++i)
+        if (x_bit_(i, q))
+            rowsum_(2 * n, i + n);
+    return r_[2 * n];
+}
+
+
+bool is_clifford(const std::vector<QuantumTask>& quantum_tasks)
+{
+    for (const auto& quantum_task : quantum_tasks)
+        for (const auto& inst : quantum_task.circuit)
+            if (!is_clifford_instruction(inst))
+                return false;
+    return true;
+}
+
+bool is_frame_sampleable(const QuantumTask& quantum_task)
+{
+    for (const auto& inst : quantum_task.circuit) {
+        if (inst.contains("conditional_reg") || inst.contains("remote_conditional_reg"))
+            return false;
+        const auto& name = inst.at("name").get_ref<const std::string&>();
+        if (!CLIFFORD_INSTRUCTIONS.contains(name))
+            return false;
+    }
+    return true;
+}
+
+// Pauli frames: bit k of fx[q] (fz[q]) tells whether shot k differs from the
+// reference shot by an X (Z) on qubit q. Cliffords conjugate the frames
+// without signs, a measurement flips the reference outcome where the frame
+// has an X, and randomizing the Z part of the frames at the start and after
+// every measurement gives the random outcomes their right distribution.
+void sample_clifford_shots(const QuantumTask& quantum_task, std::size_t shots, std::uint64_t seed, ShotResults& shot_results)
+{
+    const auto n_qubits = quantum_task.config.at("num_qubits").get<std::size_t>();
+    const auto n_clbits = quantum_task.config.at("num_clbits").get<std::size_t>();
+
+    std::vector<FrameInstruction> program;
+    for (const auto& inst : quantum_task.circuit) {
+        const auto& name = inst.at("name").get_ref<const std::string&>();
+        auto qubits = inst.at("qubits").get<std::vector<std::size_t>>();
+        FrameInstruction fi{FrameOp::NONE};
+        if (name == "h") fi = {FrameOp::H, qubits[0]};
+        else if (name == "s" || name == "sdg") fi = {FrameOp::S, qubits[0]};
+        else if (name == "sx") fi = {FrameOp::SX, qubits[0]};
+        else if (name == "cx") fi = {FrameOp::CX, qubits[0], qubits[1]};
+        else if (name == "cy") fi = {FrameOp::CY, qubits[0], qubits[1]};
+        else if (name == "cz") fi = {FrameOp::CZ, qubits[0], qubits[1]};
+        else if (name == "swap") fi = {FrameOp::SWAP, qubits[0], qubits[1]};
+        else if (name == "measure") fi = {FrameOp::MEASURE, qubits[0], 0, inst.at("clbits")[0].get<std::size_t>()};
+        // Paulis and identities do not change the frames, only the reference
+
+        program.push_back(fi);
+    }
+
+    // Reference shot, also to know which measurement ends up in each clbit
+    StabilizerExecutor reference(static_cast<int>(n_qubits), seed);
+    std::vector<std::uint8_t> reference_outcomes;
+    std::vector<long> last_measure(n_clbits, -1);
+    std::size_t k = 0;
+    for (std::size_t j = 0; j < program.size(); ++j) {
+        const auto& inst = quantum_task.circuit[j];
+        if (program[j].op == FrameOp::MEASURE) {
+            reference_outcomes.push_back(reference.measure(program[j].a));
+            if (program[j].clbit < n_clbits)
+                last_measure[program[j].clbit] = static_cast<long>(k);
+            ++k;
+        } else {
+            reference.apply_gate(inst.at("name").get<std::string>(), inst.at("qubits").get<std::vector<int>>());
+        }
+    }
+    const std::size_t n_measures = k;
+
+    constexpr std::size_t BATCH_WORDS = 16;
+    std::mt19937_64 rng(seed ^ 0x9e3779b97f4a7c15ULL);
+    std::vector<std::uint64_t> fx(n_qubits * BATCH_WORDS), fz(n_qubits * BATCH_WORDS), records(n_measures * BATCH_WORDS);
+
+    auto randomize = [&](std::uint64_t* words) {
+        for (std::size_t w = 0; w < BATCH_WORDS; ++w)
+            words[w] = rng();
+    };
+    auto xor_into = [](std::uint64_t* to, const std::uint64_t* from) {
+        #pragma omp simd
+        for (std::size_t w = 0; w < BATCH_WORDS; ++w)
+            to[w] ^= from[w];
+    };
+    auto X = [&](std::size_t q) { return fx.data() + q * BATCH_WORDS; };
+    auto Z = [&](std::size_t q) { return fz.data() + q * BATCH_WORDS; };
+
+    for (std::size_t first = 0; first < shots; first += 64 * BATCH_WORDS) {
+        std::fill(fx.begin(), fx.end(), 0);
+        for (std::size_t q = 0; q < n_qubits; ++q)
+            randomize(Z(q));
+
+        k = 0;
+        for (const auto& fi : program) {
+            switch (fi.op) {
+                case FrameOp::NONE:
+                    break;
+                case FrameOp::H:
+                    std::swap_ranges(X(fi.a), X(fi.a) + BATCH_WORDS, Z(fi.a));
+                    break;
+                case FrameOp::S:
+                    xor_into(Z(fi.a), X(fi.a));
+                    break;
+                case FrameOp::SX:
+                    xor_into(X(fi.a), Z(fi.a));
+                    break;
+                case FrameOp::CX:
+                    xor_into(X(fi.b), X(fi.a));
+                    xor_into(Z(fi.a), Z(fi.b));
+                    break;
+                case FrameOp::CY:
+                    xor_into(Z(fi.b), X(fi.b));
+                    xor_into(X(fi.b), X(fi.a));
+                    xor_into(Z(fi.a), Z(fi.b));
+                    xor_into(Z(fi.b), X(fi.b));
+                    break;
+                case FrameOp::CZ:
+                    xor_into(Z(fi.a), X(fi.b));
+                    xor_into(Z(fi.b), X(fi.a));
+                    break;
+                case FrameOp::SWAP:
+                    std::swap_ranges(X(fi.a), X(fi.a) + BATCH_WORDS, X(fi.b));
+                    std::swap_ranges(Z(fi.a), Z(fi.a) + BATCH_WORDS, Z(fi.b));
+                    break;
+                case FrameOp::MEASURE:
+                {
+                    std::uint64_t* record = records.data() + k * BATCH_WORDS;
+                    const std::uint64_t flip = reference_outcomes[k] ? ~std::uint64_t(0) : 0;
+                    for (std::size_t w = 0; w < BATCH_WORDS; ++w)
+                        record[w] = X(fi.a)[w] ^ flip;
+                    randomize(Z(fi.a));
+                    ++k;
+                    break;
+                }
+            }
+        }
+
+        const std::size_t last = std::min(shots, first + 64 * BATCH_WORDS);
+        for (std::size_t shot = first; shot < last; ++shot) {
+            std::uint64_t* outcome = shot_results.row(shot);
+            const std::size_t word = (shot - first) / 64, bit = (shot - first) % 64;
+            for (std::size_t c = 0; c < n_clbits; ++c)
+                if (last_measure[c] >= 0 && ((records[last_measure[c] * BATCH_WORDS + word] >> bit) & 1))
+                    set_outcome_bit(outcome, n_clbits - c - 1);
+        }
+    }
+}
+
+} // End of sim namespace
+} // End of cunqa namespace
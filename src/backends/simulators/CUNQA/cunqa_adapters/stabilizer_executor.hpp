@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include "quantum_task.hpp"
+#include "utils/helpers/packed_counts.hpp"
+
+namespace cunqa {
+namespace sim {
+
+// Stabilizer tableau (Aaronson-Gottesman) with the interface of the Cunqa
+// Executor that the per-shot interpreter uses, for circuits made only of
+// Clifford gates and measurements. Rows 0..n-1 are the destabilizers, rows
+// n..2n-1 the stabilizers and row 2n is scratch space for the deterministic
+// measurements. Each row keeps its X and Z parts bit-packed in 64-bit words,
+// so the row products of the measurements run word-wise.
+class StabilizerExecutor
+{
+public:
+    StabilizerExecutor(int n_qubits, std::uint64_t seed);
+
+    void apply_gate(const std::string& gate_name, const std::vector<int>& qubits);
+    void apply_parametric_gate(const std::string& gate_name, const std::vector<int>& qubits, const std::vector<double>& params);
+    int apply_measure(const std::vector<int>& qubits);
+    // Back to |0...0>, named as in the Executor
+    void restart_statevector();
+    // Measurements from here on draw from a generator with this seed
+    void reseed(std::uint64_t seed) { rng_.seed(seed); }
+
+    void h(std::size_t q);
+    void s(std::size_t q);
+    void sdg(std::size_t q);
+    void sx(std::size_t q);
+    void x(std::size_t q);
+    void y(std::size_t q);
+    void z(std::size_t q);
+    void cx(std::size_t control, std::size_t target);
+    void cy(std::size_t control, std::size_t target);
+    void cz(std::size_t a, std::size_t b);
+    void swap(std::size_t a, std::size_t b);
+    int measure(std::size_t q);
+
+private:
+    std::size_t n_qubits_;
+    std::size_t n_words_;
+    std::vector<std::uint64_t> x_, z_;
+    std::vector<std::uint8_t> r_;
+    std::mt19937_64 rng_;
+
+    std::uint64_t* x_row_(std::size_t row) { return x_.data() + row * n_words_; }
+    std::uint64_t* z_row_(std::size_t row) { return z_.data() + row * n_words_; }
+    bool x_bit_(std::size_t row, std::size_t q) const { return (x_[row * n_words_ + q / 64] >> (q % 64)) & 1; }
+    bool z_bit_(std::size_t row, std::size_t q) const { return (z_[row * n_words_ + q / 64] >> (q % 64)) & 1; }
+    void rowsum_(std::size_t h, std::size_t i);
+    void copy_row_(std::size_t to, std::size_t from);
+    void clear_row_(std::size_t row);
+};
+
+// Whether every instruction of the tasks can be simulated by the stabilizer
+// engine: {id, h, s, sdg, sx, x, y, z, cx, cy, cz, swap, measure} plus the
+// communication instructions, which only use Clifford gates themselves.
+bool is_clifford(const std::vector<QuantumTask>& quantum_tasks);
+
+// Whether the Clifford task can be sampled with Pauli frames: no classical
+// control and no communications.
+bool is_frame_sampleable(const QuantumTask& quantum_task);
+
+// Samples all the shots of a Clifford circuit without classical control. A
+// single reference shot is simulated with the tableau, then the rest of the
+// shots are Pauli frames on top of it, 64 shots per word, so each gate costs a
+// few word operations per batch of shots instead of a tableau update per shot.
+void sample_clifford_shots(const QuantumTask& quantum_task, std::size_t shots, std::uint64_t seed, ShotResults& shot_results);
+
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,131 @@
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "statevector_executor.hpp"
+#include "statevector_kernels.hpp"
+
+namespace {
+
+using Complex = std::complex<double>;
+using Matrix2 = cunqa::sim::kernels::Matrix2<double>;
+
+constexpr Complex I{0.0, 1.0};
+
+[[noreturn]] void unsupported(const std::string& name)
+{
+    throw std::runtime_error("Gate " + name + " is not supported by the statevector simulator.");
+}
+
+Matrix2 dense_matrix(const std::string& name, const std::vector<double>& params)
+{
+    if (name == "h") return {M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2};
+    if (name == "y") return {0, -I, I, 0};
+    if (name == "sx") return {Complex(0.5, 0.5), Complex(0.5, -0.5), Complex(0.5, -0.5), Complex(0.5, 0.5)};
+
+    if (params.empty())
+        unsupported(name);
+    const double c = std::cos(params[0] / 2), s = std::sin(params[0] / 2);
+    if (name == "rx") return {c, -I * s, -I * s, c};
+    if (name == "ry") return {c, -s, s, c};
+    unsupported(name);
+}
+
+template<typename T>
+cunqa::sim::kernels::Matrix2<T> cast(const Matrix2& m)
+{
+    return {std::complex<T>(m[0]), std::complex<T>(m[1]), std::complex<T>(m[2]), std::complex<T>(m[3])};
+}
+
+// Diagonal gates as (d0, d1), false if the gate is not diagonal
+bool diagonal(const std::string& name, const std::vector<double>& params, Complex& d0, Complex& d1)
+{
+    d0 = 1.0;
+    if (name == "z")   { d1 = -1.0; return true; }
+    if (name == "s")   { d1 = I;    return true; }
+    if (name == "sdg") { d1 = -I;   return true; }
+    if (name == "rz" && !params.empty()) {
+        d0 = std::exp(-I * (params[0] / 2));
+        d1 = std::exp(I * (params[0] / 2));
+        return true;
+    }
+    return false;
+}
+
+} // End of anonymous namespace
+
+namespace cunqa {
+namespace sim {
+
+template<typename T>
+StatevectorExecutor<T>::StatevectorExecutor(int n_qubits, std::uint64_t seed) :
+    n_qubits_{static_cast<std::size_t>(n_qubits)},
+    state_(std::size_t(1) << n_qubits_),
+    rng_{seed}
+{
+    restart_statevector();
+}
+
+template<typename T>
+void StatevectorExecutor<T>::restart_statevector()
+{
+    std::fill(state_.begin(), state_.end(), std::complex<T>(0));
+    state_[0] = 1.0;
+}
+
+template<typename T>
+void StatevectorExecutor<T>::apply_gate(const std::string& gate_name, const std::vector<int>& qubits)
+{
+    apply_parametric_gate(gate_name, qubits, {});
+}
+
+template<typename T>
+void StatevectorExecutor<T>::apply_parametric_gate(const std::string& gate_name, const std::vector<int>& qubits, const std::vector<double>& params)
+{
+    std::complex<T>* state = state_.data();
+    Complex d0, d1;
+
+    if (qubits.size() == 1) {
+        const std::size_t q = qubits[0];
+        if (gate_name == "id")
+            return;
+        if (gate_name == "x")
+            return kernels::apply_x(state, n_qubits_, q);
+        if (diagonal(gate_name, params, d0, d1))
+            return kernels::apply_diagonal(state, n_qubits_, q, std::complex<T>(d0), std::complex<T>(d1));
+        return kernels::apply_matrix(state, n_qubits_, q, cast<T>(dense_matrix(gate_name, params)));
+    }
+
+    if (qubits.size() != 2)
+        unsupported(gate_name);
+    const std::size_t a = qubits[0], b = qubits[1];
+    if (gate_name == "swap")
+        return kernels::apply_swap(state, n_qubits_, a, b);
+    if (gate_name.empty() || gate_name[0] != 'c')
+        unsupported(gate_name);
+
+    const std::string target_gate = gate_name.substr(1);
+    if (target_gate == "x")
+        return kernels::apply_cx(state, n_qubits_, a, b);
+    if (diagonal(target_gate, params, d0, d1))
+        return kernels::apply_controlled_diagonal(state, n_qubits_, a, b, std::complex<T>(d0), std::complex<T>(d1));
+    kernels::apply_controlled_matrix(state, n_qubits_, a, b, cast<T>(dense_matrix(target_gate, params)));
+}
+
+template<typename T>
+int StatevectorExecutor<T>::apply_measure(const std::vector<int>& qubits)
+{
+    const std::size_t q = qubits[0];
+    const double p1 = kernels::probability_of_one(state_.data(), n_qubits_, q);
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const int outcome = uniform(rng_) < p1 ? 1 : 0;
+    kernels::collapse(state_.data(), n_qubits_, q, outcome, outcome ? p1 : 1.0 - p1);
+    return outcome;
+}
+
+template class StatevectorExecutor<double>;
+template class StatevectorExecutor<float>;
+
+} // End of sim namespace
+} // End of cunqa namespace
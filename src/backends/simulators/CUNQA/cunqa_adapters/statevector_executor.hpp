@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <complex>
+#include <cstdint>
+
+namespace cunqa {
+namespace sim {
+
+// Dense statevector with the interface of the Cunqa Executor that the
+// per-shot interpreter uses, running on the SIMD kernels of
+// statevector_kernels.hpp. Diagonal gates and permutations (x, cx, swap) have
+// their own kernels, every other gate goes through the dense 2x2 kernels.
+// T is the precision of the amplitudes, double or float.
+template<typename T>
+class StatevectorExecutor
+{
+public:
+    StatevectorExecutor(int n_qubits, std::uint64_t seed);
+
+    void apply_gate(const std::string& gate_name, const std::vector<int>& qubits);
+    void apply_parametric_gate(const std::string& gate_name, const std::vector<int>& qubits, const std::vector<double>& params);
+    int apply_measure(const std::vector<int>& qubits);
+    // Back to |0...0>, named as in the Executor
+    void restart_statevector();
+    // Measurements from here on draw from a generator with this seed
+    void reseed(std::uint64_t seed) { rng_.seed(seed); }
+
+    const std::vector<std::complex<T>>& data() const { return state_; }
+    std::vector<std::complex<T>>& data() { return state_; }
+
+private:
+    std::size_t n_qubits_;
+    std::vector<std::complex<T>> state_;
+    std::mt19937_64 rng_;
+};
+
+extern template class StatevectorExecutor<double>;
+extern template class StatevectorExecutor<float>;
+
+} // End of sim namespace
+} // End of cunqa namespace
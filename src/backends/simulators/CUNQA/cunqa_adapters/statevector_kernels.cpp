@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "statevector_kernels.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+#if defined(__x86_64__)
+#define CUNQA_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cunqa {
+namespace sim {
+namespace kernels {
+
+namespace {
+
+// Below this number of amplitude pairs a kernel is not worth a thread team
+constexpr std::size_t PARALLEL_PAIRS = std::size_t(1) << 14;
+
+// Nor is it inside a task of a thread pool (the circuits of a batch), which
+// already keeps every CPU busy
+inline bool parallel_kernel(std::size_t n_pairs)
+{
+    return n_pairs >= PARALLEL_PAIRS && !inside_thread_pool();
+}
+
+inline std::size_t insert_zero(std::size_t k, std::size_t bit)
+{
+    return ((k >> bit) << (bit + 1)) | (k & ((std::size_t(1) << bit) - 1));
+}
+
+// Manual product, std::complex operator* takes a slow path for NaN handling
+template<typename T>
+inline std::complex<T> cmul(std::complex<T> a, std::complex<T> b)
+{
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+// Pairs (i, i + stride) a gate acts on. The index of pair k is k with a zero
+// inserted at the bit of each involved qubit, plus the control bit if any.
+// 2^lo consecutive pairs have consecutive indices.
+struct PairSpace {
+    std::size_t lo, hi;
+    bool two;
+    std::size_t set_mask;
+    std::size_t stride;
+    std::size_t n_pairs;
+
+    std::size_t base(std::size_t k) const
+    {
+        std::size_t i = insert_zero(k, lo);
+        if (two)
+            i = insert_zero(i, hi);
+        return i | set_mask;
+    }
+};
+
+PairSpace single_pairs(std::size_t n_qubits, std::size_t q)
+{
+    return {q, 0, false, 0, std::size_t(1) << q, (std::size_t(1) << n_qubits) / 2};
+}
+
+PairSpace controlled_pairs(std::size_t n_qubits, std::size_t control, std::size_t target)
+{
+    return {std::min(control, target), std::max(control, target), true,
+            std::size_t(1) << control, std::size_t(1) << target, (std::size_t(1) << n_qubits) / 4};
+}
+
+template<typename T>
+void dense_scalar(std::complex<T>* state, const PairSpace& ps, const Matrix2<T>& m)
+{
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k), i1 = i0 + ps.stride;
+        const std::complex<T> x0 = state[i0], x1 = state[i1];
+        state[i0] = cmul(m[0], x0) + cmul(m[1], x1);
+        state[i1] = cmul(m[2], x0) + cmul(m[3], x1);
+    }
+}
+
+#ifdef CUNQA_KERNELS_X86
+
+// Complex times scalar for interleaved complex numbers: with fmaddsub the
+// even (real) lanes subtract and the odd (imaginary) lanes add
+__attribute__((target("avx2,fma")))
+inline __m256d cmul_avx2(__m256d x, __m256d x_swapped, __m256d re, __m256d im)
+{
+    return _mm256_fmaddsub_pd(x, re, _mm256_mul_pd(x_swapped, im));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256 cmul_avx2(__m256 x, __m256 x_swapped, __m256 re, __m256 im)
+{
+    return _mm256_fmaddsub_ps(x, re, _mm256_mul_ps(x_swapped, im));
+}
+
+// High qubits, double: two consecutive pairs per iteration, one vector per half
+__attribute__((target("avx2,fma")))
+void dense_avx2(std::complex<double>* state, const PairSpace& ps, const Matrix2<double>& m)
+{
+    double* amplitudes = reinterpret_cast<double*>(state);
+    const __m256d r00 = _mm256_set1_pd(m[0].real()), i00 = _mm256_set1_pd(m[0].imag());
+    const __m256d r01 = _mm256_set1_pd(m[1].real()), i01 = _mm256_set1_pd(m[1].imag());
+    const __m256d r10 = _mm256_set1_pd(m[2].real()), i10 = _mm256_set1_pd(m[2].imag());
+    const __m256d r11 = _mm256_set1_pd(m[3].real()), i11 = _mm256_set1_pd(m[3].imag());
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; k += 2) {
+        const std::size_t i0 = ps.base(k);
+        double* p0 = amplitudes + 2 * i0;
+        double* p1 = amplitudes + 2 * (i0 + ps.stride);
+        const __m256d x0 = _mm256_loadu_pd(p0), x1 = _mm256_loadu_pd(p1);
+        const __m256d s0 = _mm256_permute_pd(x0, 0b0101), s1 = _mm256_permute_pd(x1, 0b0101);
+        _mm256_storeu_pd(p0, _mm256_add_pd(cmul_avx2(x0, s0, r00, i00), cmul_avx2(x1, s1, r01, i01)));
+        _mm256_storeu_pd(p1, _mm256_add_pd(cmul_avx2(x0, s0, r10, i10), cmul_avx2(x1, s1, r11, i11)));
+    }
+}
+
+// High qubits, float: four consecutive pairs per iteration
+__attribute__((target("avx2,fma")))
+void dense_avx2(std::complex<float>* state, const PairSpace& ps, const Matrix2<float>& m)
+{
+    float* amplitudes = reinterpret_cast<float*>(state);
+    const __m256 r00 = _mm256_set1_ps(m[0].real()), i00 = _mm256_set1_ps(m[0].imag());
+    const __m256 r01 = _mm256_set1_ps(m[1].real()), i01 = _mm256_set1_ps(m[1].imag());
+    const __m256 r10 = _mm256_set1_ps(m[2].real()), i10 = _mm256_set1_ps(m[2].imag());
+    const __m256 r11 = _mm256_set1_ps(m[3].real()), i11 = _mm256_set1_ps(m[3].imag());
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; k += 4) {
+        const std::size_t i0 = ps.base(k);
+        float* p0 = amplitudes + 2 * i0;
+        float* p1 = amplitudes + 2 * (i0 + ps.stride);
+        const __m256 x0 = _mm256_loadu_ps(p0), x1 = _mm256_loadu_ps(p1);
+        const __m256 s0 = _mm256_permute_ps(x0, 0xB1), s1 = _mm256_permute_ps(x1, 0xB1);
+        _mm256_storeu_ps(p0, _mm256_add_ps(cmul_avx2(x0, s0, r00, i00), cmul_avx2(x1, s1, r01, i01)));
+        _mm256_storeu_ps(p1, _mm256_add_ps(cmul_avx2(x0, s0, r10, i10), cmul_avx2(x1, s1, r11, i11)));
+    }
+}
+
+// Qubit 0, double: each vector holds a whole pair [x0, x1], the halves are
+// broadcast across the lanes and multiplied by the columns of the matrix
+__attribute__((target("avx2,fma")))
+void dense_avx2_q0(std::complex<double>* state, std::size_t n_states, const Matrix2<double>& m)
+{
+    double* amplitudes = reinterpret_cast<double*>(state);
+    const __m256d re0 = _mm256_set_pd(m[2].real(), m[2].real(), m[0].real(), m[0].real());
+    const __m256d im0 = _mm256_set_pd(m[2].imag(), m[2].imag(), m[0].imag(), m[0].imag());
+    const __m256d re1 = _mm256_set_pd(m[3].real(), m[3].real(), m[1].real(), m[1].real());
+    const __m256d im1 = _mm256_set_pd(m[3].imag(), m[3].imag(), m[1].imag(), m[1].imag());
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(n_states / 2))
+    for (std::size_t i = 0; i < n_states; i += 2) {
+        double* p = amplitudes + 2 * i;
+        const __m256d v = _mm256_loadu_pd(p);
+        const __m256d a = _mm256_permute2f128_pd(v, v, 0x00);
+        const __m256d b = _mm256_permute2f128_pd(v, v, 0x11);
+        const __m256d y = _mm256_add_pd(cmul_avx2(a, _mm256_permute_pd(a, 0b0101), re0, im0),
+                                        cmul_avx2(b, _mm256_permute_pd(b, 0b0101), re1, im1));
+        _mm256_storeu_pd(p, y);
+    }
+}
+
+__attribute__((target("avx512f")))
+inline __m512d cmul_avx512(__m512d x, __m512d x_swapped, __m512d re, __m512d im)
+{
+    return _mm512_fmaddsub_pd(x, re, _mm512_mul_pd(x_swapped, im));
+}
+
+__attribute__((target("avx512f")))
+inline __m512 cmul_avx512(__m512 x, __m512 x_swapped, __m512 re, __m512 im)
+{
+    return _mm512_fmaddsub_ps(x, re, _mm512_mul_ps(x_swapped, im));
+}
+
+// High qubits, double: four consecutive pairs per iteration
+__attribute__((target("avx512f")))
+void dense_avx512(std::complex<double>* state, const PairSpace& ps, const Matrix2<double>& m)
+{
+    double* amplitudes = reinterpret_cast<double*>(state);
+    const __m512d r00 = _mm512_set1_pd(m[0].real()), i00 = _mm512_set1_pd(m[0].imag());
+    const __m512d r01 = _mm512_set1_pd(m[1].real()), i01 = _mm512_set1_pd(m[1].imag());
+    const __m512d r10 = _mm512_set1_pd(m[2].real()), i10 = _mm512_set1_pd(m[2].imag());
+    const __m512d r11 = _mm512_set1_pd(m[3].real()), i11 = _mm512_set1_pd(m[3].imag());
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; k += 4) {
+        const std::size_t i0 = ps.base(k);
+        double* p0 = amplitudes + 2 * i0;
+        double* p1 = amplitudes + 2 * (i0 + ps.stride);
+        const __m512d x0 = _mm512_loadu_pd(p0), x1 = _mm512_loadu_pd(p1);
+        const __m512d s0 = _mm512_permute_pd(x0, 0x55), s1 = _mm512_permute_pd(x1, 0x55);
+        _mm512_storeu_pd(p0, _mm512_add_pd(cmul_avx512(x0, s0, r00, i00), cmul_avx512(x1, s1, r01, i01)));
+        _mm512_storeu_pd(p1, _mm512_add_pd(cmul_avx512(x0, s0, r10, i10), cmul_avx512(x1, s1, r11, i11)));
+    }
+}
+
+// High qubits, float: eight consecutive pairs per iteration
+__attribute__((target("avx512f")))
+void dense_avx512(std::complex<float>* state, const PairSpace& ps, const Matrix2<float>& m)
+{
+    float* amplitudes = reinterpret_cast<float*>(state);
+    const __m512 r00 = _mm512_set1_ps(m[0].real()), i00 = _mm512_set1_ps(m[0].imag());
+    const __m512 r01 = _mm512_set1_ps(m[1].real()), i01 = _mm512_set1_ps(m[1].imag());
+    const __m512 r10 = _mm512_set1_ps(m[2].real()), i10 = _mm512_set1_ps(m[2].imag());
+    const __m512 r11 = _mm512_set1_ps(m[3].real()), i11 = _mm512_set1_ps(m[3].imag());
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; k += 8) {
+        const std::size_t i0 = ps.base(k);
+        float* p0 = amplitudes + 2 * i0;
+        float* p1 = amplitudes + 2 * (i0 + ps.stride);
+        const __m512 x0 = _mm512_loadu_ps(p0), x1 = _mm512_loadu_ps(p1);
+        const __m512 s0 = _mm512_permute_ps(x0, 0xB1), s1 = _mm512_permute_ps(x1, 0xB1);
+        _mm512_storeu_ps(p0, _mm512_add_ps(cmul_avx512(x0, s0, r00, i00), cmul_avx512(x1, s1, r01, i01)));
+        _mm512_storeu_ps(p1, _mm512_add_ps(cmul_avx512(x0, s0, r10, i10), cmul_avx512(x1, s1, r11, i11)));
+    }
+}
+
+#endif // CUNQA_KERNELS_X86
+
+template<typename T>
+void dense(std::complex<T>* state, std::size_t n_qubits, const PairSpace& ps, const Matrix2<T>& m)
+{
+#ifdef CUNQA_KERNELS_X86
+    // log2 of the complex numbers per AVX2 vector
+    constexpr std::size_t avx2_lo = std::is_same_v<T, double> ? 1 : 2;
+    const ISA level = isa();
+    if (level == ISA::AVX512 && ps.lo >= avx2_lo + 1)
+        return dense_avx512(state, ps, m);
+    if (level != ISA::SCALAR && ps.lo >= avx2_lo)
+        return dense_avx2(state, ps, m);
+    if constexpr (std::is_same_v<T, double>)
+        if (level != ISA::SCALAR && !ps.two && n_qubits >= 1)
+            return dense_avx2_q0(state, std::size_t(1) << n_qubits, m);
+#endif
+    (void)n_qubits;
+    dense_scalar(state, ps, m);
+}
+
+ISA detect_isa()
+{
+    ISA detected = ISA::SCALAR;
+#ifdef CUNQA_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        detected = ISA::AVX512;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        detected = ISA::AVX2;
+#endif
+
+    // The environment can only lower the level, never enable what the CPU lacks
+    if (const char* requested = std::getenv("CUNQA_KERNELS_ISA")) {
+        const std::string level(requested);
+        if (level == "scalar")
+            detected = ISA::SCALAR;
+        else if (level == "avx2" && detected == ISA::AVX512)
+            detected = ISA::AVX2;
+    }
+    return detected;
+}
+
+} // End of anonymous namespace
+
+ISA isa()
+{
+    static const ISA detected = detect_isa();
+    return detected;
+}
+
+std::string_view isa_name(ISA level)
+{
+    switch (level) {
+        case ISA::SCALAR: return "scalar";
+        case ISA::AVX2:   return "avx2";
+        case ISA::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+template<typename T>
+void apply_matrix(std::complex<T>* state, std::size_t n_qubits, std::size_t q, const Matrix2<T>& m)
+{
+    dense(state, n_qubits, single_pairs(n_qubits, q), m);
+}
+
+template<typename T>
+void apply_controlled_matrix(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target, const Matrix2<T>& m)
+{
+    dense(state, n_qubits, controlled_pairs(n_qubits, control, target), m);
+}
+
+template<typename T>
+void apply_diagonal(std::complex<T>* state, std::size_t n_qubits, std::size_t q, std::complex<T> d0, std::complex<T> d1)
+{
+    const PairSpace ps = single_pairs(n_qubits, q);
+    const bool scale0 = d0 != std::complex<T>(1);
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k);
+        if (scale0)
+            state[i0] = cmul(state[i0], d0);
+        state[i0 + ps.stride] = cmul(state[i0 + ps.stride], d1);
+    }
+}
+
+template<typename T>
+void apply_controlled_diagonal(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target, std::complex<T> d0, std::complex<T> d1)
+{
+    const PairSpace ps = controlled_pairs(n_qubits, control, target);
+    const bool scale0 = d0 != std::complex<T>(1);
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k);
+        if (scale0)
+            state[i0] = cmul(state[i0], d0);
+        state[i0 + ps.stride] = cmul(state[i0 + ps.stride], d1);
+    }
+}
+
+template<typename T>
+void apply_x(std::complex<T>* state, std::size_t n_qubits, std::size_t q)
+{
+    const PairSpace ps = single_pairs(n_qubits, q);
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k);
+        std::swap(state[i0], state[i0 + ps.stride]);
+    }
+}
+
+template<typename T>
+void apply_cx(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target)
+{
+    const PairSpace ps = controlled_pairs(n_qubits, control, target);
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k);
+        std::swap(state[i0], state[i0 + ps.stride]);
+    }
+}
+
+template<typename T>
+void apply_swap(std::complex<T>* state, std::size_t n_qubits, std::size_t a, std::size_t b)
+{
+    // Pairs with a = 1, b = 0 exchanged with a = 0, b = 1
+    const PairSpace ps = controlled_pairs(n_qubits, a, b);
+    const std::size_t mask_a = std::size_t(1) << a;
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i = ps.base(k);
+        std::swap(state[i], state[(i ^ mask_a) + ps.stride]);
+    }
+}
+
+template<typename T>
+double probability_of_one(const std::complex<T>* state, std::size_t n_qubits, std::size_t q)
+{
+    const PairSpace ps = single_pairs(n_qubits, q);
+    double p = 0.0;
+
+    // Accumulated in double also for float amplitudes
+    #pragma omp parallel for schedule(static) reduction(+:p) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::complex<T> x = state[ps.base(k) + ps.stride];
+        p += static_cast<double>(x.real()) * x.real() + static_cast<double>(x.imag()) * x.imag();
+    }
+    return p;
+}
+
+template<typename T>
+void collapse(std::complex<T>* state, std::size_t n_qubits, std::size_t q, int outcome, double p)
+{
+    const PairSpace ps = single_pairs(n_qubits, q);
+    const T scale = static_cast<T>(1.0 / std::sqrt(p));
+
+    #pragma omp parallel for schedule(static) if (parallel_kernel(ps.n_pairs))
+    for (std::size_t k = 0; k < ps.n_pairs; ++k) {
+        const std::size_t i0 = ps.base(k), i1 = i0 + ps.stride;
+        const std::size_t kept = outcome ? i1 : i0, dropped = outcome ? i0 : i1;
+        state[kept] *= scale;
+        state[dropped] = 0;
+    }
+}
+
+#define CUNQA_KERNELS_INSTANTIATE(T) \
+    template void apply_matrix<T>(std::complex<T>*, std::size_t, std::size_t, const Matrix2<T>&); \
+    template void apply_controlled_matrix<T>(std::complex<T>*, std::size_t, std::size_t, std::size_t, const Matrix2<T>&); \
+    template void apply_diagonal<T>(std::complex<T>*, std::size_t, std::size_t, std::complex<T>, std::complex<T>); \
+    template void apply_controlled_diagonal<T>(std::complex<T>*, std::size_t, std::size_t, std::size_t, std::complex<T>, std::complex<T>); \
+    template void apply_x<T>(std::complex<T>*, std::size_t, std::size_t); \
+    template void apply_cx<T>(std::complex<T>*, std::size_t, std::size_t, std::size_t); \
+    template void apply_swap<T>(std::complex<T>*, std::size_t, std::size_t, std::size_t); \
+    template double probability_of_one<T>(const std::complex<T>*, std::size_t, std::size_t); \
+    template void collapse<T>(std::complex<T>*, std::size_t, std::size_t, int, double);
+
+CUNQA_KERNELS_INSTANTIATE(double)
+CUNQA_KERNELS_INSTANTIATE(float)
+
+#undef CUNQA_KERNELS_INSTANTIATE
+
+} // End of kernels namespace
+} // End of sim namespace
+} // End of cunqa namespace
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <string_view>
+
+// Gate kernels of the in-tree statevector. Amplitude i holds the basis state
+// whose bit q is the value of qubit q. Every kernel has a portable version and,
+// where it pays off, AVX2 and AVX-512 versions compiled with per-function
+// target attributes, so the library does not need -mavx2. The instruction set
+// is detected once at runtime (it can be lowered with CUNQA_KERNELS_ISA=
+// scalar|avx2|avx512) and the kernels run multithreaded with OpenMP for large
+// states.
+//
+// A dense 2x2 gate on qubit q pairs amplitude i with i + 2^q. For high qubits
+// (2^q at least the vector width) consecutive pairs are contiguous, so whole
+// vectors are streamed from the two strided halves. For qubit 0 both members
+// of a pair share a vector and the kernel shuffles inside it. Diagonal gates
+// (rz, z, s, cz, crz, ...) only scale amplitudes and skip the ones they leave
+// unchanged.
+
+namespace cunqa {
+namespace sim {
+namespace kernels {
+
+template<typename T>
+using Matrix2 = std::array<std::complex<T>, 4>; // Row-major, [m00, m01, m10, m11]
+
+enum class ISA { SCALAR, AVX2, AVX512 };
+
+ISA isa();
+std::string_view isa_name(ISA isa);
+
+// Every kernel is instantiated for double and float (complex128 and complex64
+// amplitudes). Single precision fits twice as many amplitudes in a vector.
+template<typename T>
+void apply_matrix(std::complex<T>* state, std::size_t n_qubits, std::size_t q, const Matrix2<T>& m);
+template<typename T>
+void apply_controlled_matrix(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target, const Matrix2<T>& m);
+
+// diag(d0, d1) on qubit q
+template<typename T>
+void apply_diagonal(std::complex<T>* state, std::size_t n_qubits, std::size_t q, std::complex<T> d0, std::complex<T> d1);
+// diag(d0, d1) on the target where the control is 1
+template<typename T>
+void apply_controlled_diagonal(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target, std::complex<T> d0, std::complex<T> d1);
+
+template<typename T>
+void apply_x(std::complex<T>* state, std::size_t n_qubits, std::size_t q);
+template<typename T>
+void apply_cx(std::complex<T>* state, std::size_t n_qubits, std::size_t control, std::size_t target);
+template<typename T>
+void apply_swap(std::complex<T>* state, std::size_t n_qubits, std::size_t a, std::size_t b);
+
+template<typename T>
+double probability_of_one(const std::complex<T>* state, std::size_t n_qubits, std::size_t q);
+// Projects qubit q on the outcome, whose probability was p
+template<typename T>
+void collapse(std::complex<T>* state, std::size_t n_qubits, std::size_t q, int outcome, double p);
+
+} // End of kernels namespace
+} // End of sim namespace
+} // End of cunqa namespace
@@ -9,7 +9,7 @@ namespace sim {
 JSON CunqaSimpleSimulator::execute([[maybe_unused]] const SimpleBackend& backend, const QuantumTask& quantum_task)
 {
     CunqaComputationAdapter cunqa_ca(quantum_task);
-    CunqaSimulatorAdapter cunqa_sa(cunqa_ca);
+    CunqaSimulatorAdapter cunqa_sa(cunqa_ca, &checkpoints_);
     
     if (quantum_task.is_dynamic) 
         return cunqa_sa.simulate();
@@ -17,5 +17,12 @@ JSON CunqaSimpleSimulator::execute([[maybe_unused]] const SimpleBackend& backend
         return cunqa_sa.simulate(&backend);
 }
 
+JSON CunqaSimpleSimulator::execute_batch([[maybe_unused]] const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks)
+{
+    CunqaComputationAdapter cunqa_ca(quantum_tasks);
+    CunqaSimulatorAdapter cunqa_sa(cunqa_ca, &checkpoints_);
+    return cunqa_sa.simulate_batch();
+}
+
 } // End namespace sim
 } // End namespace cunqa
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "backends/simple_backend.hpp"
 #include "backends/simulators/simulator_strategy.hpp"
 #include "utils/json.hpp"
+#include "cunqa_adapters/prefix_checkpoints.hpp"
 
 #include "logger.hpp"
 
@@ -21,7 +22,11 @@ public:
 
     // TODO: The [[maybe_unused]] annotation is a temporary approach while CunqaSimulator does not take into account the backend info
     JSON execute([[maybe_unused]] const SimpleBackend& backend, const QuantumTask& quantum_task) override;
+    // Circuits sharing their state preparation run it once, see CunqaSimulatorAdapter::simulate_batch
+    JSON execute_batch([[maybe_unused]] const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks) override;
 
+private:
+    PrefixCheckpoints checkpoints_;
 };
 
 } // End namespace sim
@@ -2,6 +2,7 @@
 #include "munich_simulator_adapter.hpp"
 #include "munich_helpers.hpp"
 
+#include <bit>
 #include <unordered_map>
 #include <stack>
 #include <chrono>
@@ -11,6 +12,10 @@
 #include "quantum_task.hpp"
 #include "backends/simulators/simulator_strategy.hpp"
 #include "utils/helpers/reverse_bitstring.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/saved_state.hpp"
+#include "utils/helpers/precision.hpp"
+#include "utils/helpers/statevector_sampler.hpp"
 
 #include "logger.hpp"
 
@@ -29,6 +34,8 @@ const std::unordered_map<int, OpType> MUNICH_INSTRUCTIONS_MAP = {
     {constants::Z, OpType::Z},
     {constants::H, OpType::H},
     {constants::SX, OpType::SX},
+    {constants::S, OpType::S},
+    {constants::SDG, OpType::Sdg},
 
     // ONE GATE PARAM
     {constants::RX, OpType::RX},
@@ -48,6 +55,18 @@ const std::unordered_map<int, OpType> MUNICH_INSTRUCTIONS_MAP = {
     {constants::CRZ, OpType::RZ}
 };
 
+// Circuits of gates followed by measurements are sampled from the dense
+// statevector of the decision diagram when it fits in memory and the shots
+// are many per amplitude, instead of by the sampler of DDSIM
+constexpr int MAX_DENSE_SAMPLING_QUBITS = 26;
+constexpr std::size_t MIN_SHOTS_PER_AMPLITUDE = 16;
+
+bool dense_sampling_pays(const QuantumTask& quantum_task, int n_qubits, std::size_t shots)
+{
+    return !quantum_task.is_dynamic && !quantum_task.has_cc && n_qubits <= MAX_DENSE_SAMPLING_QUBITS
+        && (std::size_t(1) << n_qubits) <= MIN_SHOTS_PER_AMPLITUDE * shots && final_measurements_start(quantum_task.circuit);
+}
+
 struct TaskState {
     std::string id;
     JSON::const_iterator it, end;
@@ -72,7 +91,7 @@ struct GlobalState {
 namespace cunqa {
 namespace sim {
 
-std::string CircuitSimulatorAdapter::execute_shot_(const std::vector<QuantumTask> &quantum_tasks, comm::ClassicalChannel *classical_channel)
+void CircuitSimulatorAdapter::execute_shot_(const std::vector<QuantumTask> &quantum_tasks, comm::ClassicalChannel *classical_channel, std::size_t shot, std::uint64_t* outcome)
 {
     std::unordered_map<std::string, TaskState> Ts;
     GlobalState G;
@@ -148,6 +167,8 @@ std::string CircuitSimulatorAdapter::execute_shot_(const std::vector<QuantumTask
         case constants::Z:
         case constants::H:
         case constants::SX:
+        case constants::S:
+        case constants::SDG:
         case constants::RX:
         case constants::RY:
         case constants::RZ:
@@ -208,14 +229,14 @@ std::string CircuitSimulatorAdapter::execute_shot_(const std::vector<QuantumTask
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             char char_measurement = measureAdapter(qubits[0] + T.zero_qubit);
             int measurement = char_measurement - '0';
-            classical_channel->send_measure(measurement, endpoint[0]);
+            classical_channel->send_measure(measurement, endpoint[0], shot);
             break;
         }
         case constants::RECV:
         {
             auto endpoint = inst.at("qpus").get<std::vector<std::string>>();
             auto conditional_reg = inst.at("remote_conditional_reg").get<std::vector<size_t>>();
-            int measurement = classical_channel->recv_measure(endpoint[0]);
+            int measurement = classical_channel->recv_measure(endpoint[0], shot);
             G.rcreg[conditional_reg[0]] = (measurement == 1);
             LOGGER_DEBUG("El índice {} tiene valor {}", conditional_reg[0], G.rcreg[conditional_reg[0]]);
             break;
@@ -369,13 +390,12 @@ std::string CircuitSimulatorAdapter::execute_shot_(const std::vector<QuantumTask
     } // End one shot
 
     // result is a map from the cbit index to the Boolean value
-    std::string result_bits(G.n_clbits, '0');
+    // Outcome row with the bit order the counts keys have always had
     for (const auto &[bitIndex, value] : G.cvalues)
     {
-        result_bits[G.n_clbits - bitIndex - 1] = value ? '1' : '0';
+        if (value && bitIndex < static_cast<std::size_t>(G.n_clbits))
+            set_outcome_bit(outcome, G.n_clbits - bitIndex - 1);
     }
-
-    return result_bits;
 }
 
 
@@ -393,7 +413,53 @@ JSON CircuitSimulatorAdapter::simulate(const Backend* backend)
         float time_taken;
         int n_qubits = quantum_task.config.at("num_qubits");
 
+        // Decision diagram weights are always double
+        if (run_precision(quantum_task.config) == "single")
+            LOGGER_WARN("The Munich simulator only runs in double precision, the single precision request is ignored.");
+
+        auto counts_result = [&](const std::map<std::string, std::size_t>& counts, float time_taken) -> JSON {
+            if (packed_result_requested(quantum_task.config))
+                return {{"packed_counts", PackedCounts::from_bitstrings(counts).to_json()}, {"time_taken", time_taken}, {"precision", "double"}};
+            return {{"counts", counts}, {"time_taken", time_taken}, {"precision", "double"}};
+        };
+
         JSON noise_model_json = backend->config.at("noise_model");
+
+        // Decision diagrams only give the statevector, and not through the stochastic noise simulator
+        const auto state_type = saved_state_type(quantum_task.config);
+        if (!state_type.empty() && state_type != "statevector")
+            throw std::runtime_error("save_state \"" + state_type + "\" is not supported by the Munich simulator");
+        if (!state_type.empty() && !noise_model_json.empty())
+            throw std::runtime_error("save_state is not supported with noise models in the Munich simulator");
+
+        const auto shots = quantum_task.config.at("shots").get<std::size_t>();
+        if (noise_model_json.empty() && dense_sampling_pays(quantum_task, n_qubits, shots)) {
+            CircuitSimulator sim(std::move(mqt_circuit));
+            const auto n_clbits = quantum_task.config.at("num_clbits").get<std::size_t>();
+            ShotResults shot_results(quantum_task.config, n_clbits, shots);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            // Final measurements are sampled, so the decision diagram keeps the state before them
+            sim.simulate(1);
+            auto statevector = sim.getVector<std::complex<double>>();
+            sample_statevector(statevector.data(), n_qubits, measured_bits(quantum_task.circuit, *final_measurements_start(quantum_task.circuit), n_clbits),
+                               n_clbits, shots, quantum_task.config.at("seed").get<std::uint64_t>(), shot_results);
+            std::chrono::duration<float> duration = std::chrono::high_resolution_clock::now() - start;
+
+            JSON result_json = shot_results.to_json(duration.count());
+            result_json["precision"] = "double";
+            if (!state_type.empty())
+                result_json["state"] = saved_state(state_type, n_qubits, state_section(statevector, {}, quantum_task.config));
+            return result_json;
+        }
+
+        // DDSIM only samples counts, per-shot outcomes come from the per-shot interpreter
+        if (memory_requested(quantum_task.config)) {
+            if (!noise_model_json.empty())
+                throw std::runtime_error("memory is not supported with noise models in the Munich simulator");
+            return simulate(static_cast<comm::ClassicalChannel*>(nullptr));
+        }
+
         if (!noise_model_json.empty()) {
             LOGGER_DEBUG("Noise model execution");
             const ApproximationInfo approx_info{noise_model_json["step_fidelity"], noise_model_json["approx_steps"], ApproximationInfo::FidelityDriven};
@@ -409,7 +475,7 @@ JSON CircuitSimulatorAdapter::simulate(const Backend* backend)
             if (!result.empty()) {
                 LOGGER_DEBUG("Result non empty");
                 reverse_bitstring_keys_json(result);
-                return {{"counts", result}, {"time_taken", time_taken}};
+                return counts_result(result, time_taken);
             }
             throw std::runtime_error("QASM format is not correct.");
         } else {
@@ -425,7 +491,13 @@ JSON CircuitSimulatorAdapter::simulate(const Backend* backend)
             if (!result.empty()) {
                 LOGGER_DEBUG("Result non empty");
                 reverse_bitstring_keys_json(result);
-                return {{"counts", result}, {"time_taken", time_taken}};
+                JSON result_json = counts_result(result, time_taken);
+                if (!state_type.empty()) {
+                    // Final measurements are sampled, so the decision diagram still holds the state before them
+                    auto statevector = sim.getVector<std::complex<double>>();
+                    result_json["state"] = saved_state(state_type, n_qubits, state_section(statevector, {}, quantum_task.config));
+                }
+                return result_json;
             }
             throw std::runtime_error("QASM format is not correct.");
         }
@@ -443,7 +515,6 @@ JSON CircuitSimulatorAdapter::simulate(comm::ClassicalChannel *classical_channel
 {
     // TODO: Avoid the static casting?
     auto p_qca = static_cast<QuantumComputationAdapter *>(qc.get());
-    std::map<std::string, std::size_t> meas_counter;
 
     // This is for distinguising classical and quantum communications
     // TODO: Make it more clear
@@ -454,21 +525,44 @@ JSON CircuitSimulatorAdapter::simulate(comm::ClassicalChannel *classical_channel
     } */
 
     auto shots = p_qca->quantum_tasks[0].config.at("shots").get<std::size_t>();
+    std::size_t n_clbits = 0;
+    for (auto &quantum_task : p_qca->quantum_tasks)
+        n_clbits += quantum_task.config.at("num_clbits").get<std::size_t>();
+
+    const auto& config = p_qca->quantum_tasks[0].config;
+    const auto state_type = saved_state_type(config);
+    if (!state_type.empty() && state_type != "statevector") {
+        LOGGER_ERROR("save_state \"{}\" is not supported by the Munich simulator.", state_type);
+        return {{"ERROR", "save_state \"" + state_type + "\" is not supported by the Munich simulator."}};
+    }
+
+    try {
+        if (run_precision(config) == "single")
+            LOGGER_WARN("The Munich simulator only runs in double precision, the single precision request is ignored.");
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error reading the precision of the Munich simulation.");
+        return {{"ERROR", std::string(e.what())}};
+    }
+
+    ShotResults shot_results(config, n_clbits, shots);
     auto start = std::chrono::high_resolution_clock::now();
     for (std::size_t i = 0; i < shots; i++)
     {
-        meas_counter[execute_shot_(p_qca->quantum_tasks, classical_channel)]++;
+        execute_shot_(p_qca->quantum_tasks, classical_channel, i, shot_results.row(i));
     } // End all shots
 
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> duration = end - start;
     float time_taken = duration.count();
 
-    reverse_bitstring_keys_json(meas_counter);
-    JSON result_json = {
-        {"counts", meas_counter},
-        {"time_taken", time_taken}};
-    return result_json;
+    JSON result = shot_results.to_json(time_taken);
+    result["precision"] = "double";
+    if (!state_type.empty() && shots > 0) {
+        // State left by the last shot
+        auto statevector = getVector<std::complex<double>>();
+        result["state"] = saved_state(state_type, std::bit_width(statevector.size()) - 1, state_section(statevector, {}, config));
+    }
+    return result;
 }
 
 
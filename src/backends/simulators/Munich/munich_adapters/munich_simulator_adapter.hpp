@@ -5,6 +5,8 @@
 #include "classical_channel/classical_channel.hpp"
 #include "backends/backend.hpp"
 
+#include <cstdint>
+
 #include "utils/json.hpp"
 
 namespace cunqa {
@@ -28,7 +30,7 @@ public:
     JSON simulate(comm::ClassicalChannel* classical_channel = nullptr);
 private:
 
-    std::string execute_shot_(const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel);
+    void execute_shot_(const std::vector<QuantumTask>& quantum_tasks, comm::ClassicalChannel* classical_channel, std::size_t shot, std::uint64_t* outcome);
     
 };
 
@@ -10,6 +10,8 @@
 
 #include "utils/constants.hpp"
 #include "utils/json.hpp"
+#include "utils/helpers/slurm_env.hpp"
+#include "utils/helpers/binary_result.hpp"
 #include "logger.hpp"
 
 namespace cunqa {
@@ -28,7 +30,7 @@ MunichExecutor::MunichExecutor() : classical_channel{"executor"}
         in >> j;
     in.close();
 
-    std::string job_id = std::getenv("SLURM_JOB_ID");
+    std::string job_id = get_job_id();
 
     for (const auto& [key, value]: j.items()) {
         if (key.rfind(job_id, 0) == 0) {
@@ -88,7 +90,7 @@ void MunichExecutor::run()
         auto result = simulator.simulate(&classical_channel);
         
         // TODO: transform results to give each qpu its results
-        std::string result_str = result.dump();
+        std::string result_str = encode_result(result);
 
         for(const auto& qpu: qpus_working) {
             classical_channel.send_info(result_str, qpu);
@@ -63,8 +63,8 @@ inline std::string quantum_task_to_Munich(const QuantumTask& quantum_task)
                 case constants::Z:
                 case constants::H:
                 case constants::SX:
-                //case constants::S:
-                //case constants::SDG:
+                case constants::S:
+                case constants::SDG:
                 //case constants::SXDG:
                 //case constants::T:
                 //case constants::TDG:
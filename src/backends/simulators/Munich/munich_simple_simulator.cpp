@@ -3,6 +3,7 @@
 #include "munich_adapters/quantum_computation_adapter.hpp"
 
 #include "munich_helpers.hpp"
+#include "utils/helpers/thread_pool.hpp"
 
 #include <chrono>
 
@@ -24,6 +25,19 @@ JSON MunichSimpleSimulator::execute(const SimpleBackend& backend, const QuantumT
         return csa.simulate(&backend);
 } 
 
+JSON MunichSimpleSimulator::execute_batch(const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks)
+{
+    std::vector<JSON> results(quantum_tasks.size());
+    parallel_for_each_index(quantum_tasks.size(), [&](std::size_t i) {
+        try {
+            results[i] = execute(backend, quantum_tasks[i]);
+        } catch (const std::exception& e) {
+            results[i] = {{"ERROR", std::string(e.what())}};
+        }
+    });
+    return {{"results", results}};
+}
+
 } // End of sim namespace
 } // End of cunqa namespace
 
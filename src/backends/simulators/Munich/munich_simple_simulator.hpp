@@ -20,6 +20,8 @@ public:
     inline std::string get_name() const override {return "MunichSimulator";}
     
     JSON execute(const SimpleBackend& backend, const QuantumTask& circuit) override;
+    // Every circuit has its own decision diagram package, so they run on a pool of threads
+    JSON execute_batch(const SimpleBackend& backend, const std::vector<QuantumTask>& quantum_tasks) override;
 };
 
 } // End of sim namespace
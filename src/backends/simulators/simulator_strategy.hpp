@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <string>
+
 #include "quantum_task.hpp"
 #include "utils/json.hpp"
 
@@ -14,6 +17,18 @@ public:
 
     virtual inline std::string get_name() const = 0;
     virtual JSON execute(const T& backend, const QuantumTask& circuit) = 0;
+    virtual JSON execute_batch(const T& backend, const std::vector<QuantumTask>& quantum_tasks)
+    {
+        JSON results = JSON::array();
+        for (const auto& quantum_task : quantum_tasks) {
+            try {
+                results.push_back(execute(backend, quantum_task));
+            } catch (const std::exception& e) {
+                results.push_back({{"ERROR", std::string(e.what())}});
+            }
+        }
+        return {{"results", results}};
+    }
 };
 
 } // End of sim namespace
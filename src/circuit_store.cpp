@@ -0,0 +1,89 @@
+#include <string>
+#include <stdexcept>
+
+#include "circuit_store.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+
+#include "logger.hpp"
+
+namespace cunqa {
+
+CircuitStore::CircuitStore(std::size_t capacity, std::size_t client_quota) :
+    capacity_{capacity},
+    client_quota_{client_quota}
+{
+    if (capacity_ == 0 || client_quota_ == 0)
+        throw std::invalid_argument("The circuit store needs room for at least one circuit.");
+}
+
+std::string CircuitStore::add(const std::string& client, QuantumTask&& quantum_task)
+{
+    // The run config is part of the handle: the same circuit registered with
+    // another method or noise is another entry. The variational params are
+    // not, as runs by handle change them, but the fixed ones (the matrices of
+    // unitary instructions) are, as they tell circuits apart.
+    Hasher64 hasher(quantum_task.hash.structure);
+    hasher.add(quantum_task.fixed_params_hash());
+    hasher.add(std::string_view(client));
+    hasher.add(std::string_view(quantum_task.config.dump()));
+    std::string handle = hash_to_hex(hasher.digest());
+
+    if (auto found = index_.find(handle); found != index_.end()) {
+        auto& stored = found->second->quantum_task;
+        if (stored.hash.structure != quantum_task.hash.structure || stored.config != quantum_task.config)
+            throw std::runtime_error("Handle " + handle + " already holds another circuit.");
+        stored = std::move(quantum_task);
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return handle;
+    }
+
+    if (client_count_[client] >= client_quota_) {
+        for (auto it = std::prev(entries_.end()); ; --it) {
+            if (it->client == client) {
+                LOGGER_DEBUG("Circuit {} evicted, the client reached its quota of {} circuits.", it->handle, client_quota_);
+                erase_(it);
+                break;
+            }
+        }
+    }
+    if (index_.size() >= capacity_) {
+        LOGGER_DEBUG("Circuit {} evicted, the store reached its capacity of {} circuits.", entries_.back().handle, capacity_);
+        erase_(std::prev(entries_.end()));
+    }
+
+    entries_.push_front(Entry{handle, client, std::move(quantum_task)});
+    index_[handle] = entries_.begin();
+    client_count_[client]++;
+
+    return handle;
+}
+
+QuantumTask* CircuitStore::find(const std::string& handle, const std::string& client)
+{
+    auto found = index_.find(handle);
+    if (found == index_.end() || found->second->client != client)
+        return nullptr;
+
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return &found->second->quantum_task;
+}
+
+bool CircuitStore::release(const std::string& handle, const std::string& client)
+{
+    auto found = index_.find(handle);
+    if (found == index_.end() || found->second->client != client)
+        return false;
+
+    erase_(found->second);
+    return true;
+}
+
+void CircuitStore::erase_(std::list<Entry>::iterator it)
+{
+    if (--client_count_[it->client] == 0)
+        client_count_.erase(it->client);
+    index_.erase(it->handle);
+    entries_.erase(it);
+}
+
+} // End of cunqa namespace
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <cstddef>
+#include <unordered_map>
+
+#include "quantum_task.hpp"
+#include "utils/constants.hpp"
+
+namespace cunqa {
+
+// Circuits registered once at a QPU and then run by handle, so the client
+// only sends the handle and what changes between runs (parameters, shots,
+// seed) instead of uploading and parsing the whole circuit again. The tasks
+// are kept already decoded.
+//
+// The store is bounded: every client can keep up to client_quota circuits and
+// the QPU up to capacity, and beyond them the least recently used circuit (of
+// the client, or of anyone) is evicted. Running an evicted handle returns an
+// error, and the client has to register the circuit again. A circuit is only
+// run, updated or released by the client that registered it. It is only used
+// by the compute thread of the QPU, so it does not lock.
+class CircuitStore
+{
+public:
+    CircuitStore(std::size_t capacity = constants::CIRCUIT_STORE_CAPACITY, std::size_t client_quota = constants::CIRCUIT_STORE_CLIENT_QUOTA);
+
+    // Registering the same circuit and config twice from the same client gives
+    // back the same handle, whose task takes the params registered last. It
+    // throws if the handle already holds a circuit with another structure or
+    // config, which takes a collision of the 64-bit hashes.
+    std::string add(const std::string& client, QuantumTask&& quantum_task);
+    // nullptr if the handle was never registered, released or evicted, or if
+    // it belongs to another client
+    QuantumTask* find(const std::string& handle, const std::string& client);
+    bool release(const std::string& handle, const std::string& client);
+
+    std::size_t size() const { return index_.size(); }
+
+private:
+    struct Entry {
+        std::string handle;
+        std::string client;
+        QuantumTask quantum_task;
+    };
+
+    std::size_t capacity_;
+    std::size_t client_quota_;
+    std::list<Entry> entries_; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::unordered_map<std::string, std::size_t> client_count_;
+
+    void erase_(std::list<Entry>::iterator it);
+};
+
+} // End of cunqa namespace
@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstddef>
+#include <optional>
 
 namespace cunqa {
 namespace comm {
@@ -24,8 +26,20 @@ public:
     void send_info(const std::string& data, const std::string& target);
     std::string recv_info(const std::string& origin);
 
-    void send_measure(const int& measurement, const std::string& target);
-    int recv_measure(const std::string& origin);
+    // Measurements are tagged with the shot they belong to, so that shots
+    // run out of order on either side still get theirs. The ones of the same
+    // origin and shot arrive in the order they were sent.
+    void send_measure(const int& measurement, const std::string& target, std::size_t shot);
+    int recv_measure(const std::string& origin, std::size_t shot);
+    // Measurement i belongs to shot first_shot + i. They travel together as a
+    // packed bit vector and are received one by one, as if sent separately.
+    void send_measures(const std::vector<int>& measurements, const std::string& target, std::size_t first_shot);
+    // Without blocking, nullopt if the measurement has not arrived yet
+    std::optional<int> try_recv_measure(const std::string& origin, std::size_t shot);
+    // Blocks until a new measurement from any origin arrives
+    void wait_measure();
+    // Measurements that have arrived so far
+    std::size_t measurements_received() const;
     
 private:
     struct Impl;
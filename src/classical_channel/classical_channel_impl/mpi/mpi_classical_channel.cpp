@@ -1,5 +1,10 @@
 
+#include <map>
+#include <queue>
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
 #include <mpi.h>
 
 #include "classical_channel.hpp"
@@ -12,6 +17,10 @@ struct ClassicalChannel::Impl
 {
     int mpi_size;
     int mpi_rank;
+    // Measurements by origin rank and shot, sent as
+    // {first shot, count, packed bits...}
+    std::map<std::pair<int, std::size_t>, std::queue<int>> measurements;
+    std::size_t n_measurements = 0;
 
     Impl()
     {
@@ -23,18 +32,51 @@ struct ClassicalChannel::Impl
     }
     ~Impl() = default;
 
-    void send(int& measurement, std::string& target)
+    void send(const std::vector<int>& batch, const std::string& target, std::size_t first_shot)
     {
         int target_int = std::atoi(target.c_str());
-        MPI_Send(&measurement, 1, MPI_INT, target_int, 1, MPI_COMM_WORLD);
-        
+        std::vector<std::uint64_t> message(2 + (batch.size() + 63) / 64, 0);
+        message[0] = first_shot;
+        message[1] = batch.size();
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            if (batch[i])
+                message[2 + i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+        MPI_Send(message.data(), static_cast<int>(message.size()), MPI_UINT64_T, target_int, 1, MPI_COMM_WORLD);
     }
 
-    int recv(std::string& origin)
+    // Stores the next measurement from any rank. Without wait, returns false
+    // if there was none.
+    bool recv_next(bool wait)
     {
-        int measurement;
-        int origin_int = std::atoi(origin.c_str());
-        MPI_Recv(&measurement, 1, MPI_INT, origin_int, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        int flag = 1;
+        MPI_Status status;
+        if (wait)
+            MPI_Probe(MPI_ANY_SOURCE, 1, MPI_COMM_WORLD, &status);
+        else
+            MPI_Iprobe(MPI_ANY_SOURCE, 1, MPI_COMM_WORLD, &flag, &status);
+        if (!flag)
+            return false;
+
+        int size;
+        MPI_Get_count(&status, MPI_UINT64_T, &size);
+        std::vector<std::uint64_t> message(size);
+        MPI_Recv(message.data(), size, MPI_UINT64_T, status.MPI_SOURCE, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for (std::size_t i = 0; i < message[1]; i++)
+            measurements[{status.MPI_SOURCE, message[0] + i}].push(static_cast<int>((message[2 + i / 64] >> (i % 64)) & 1));
+        n_measurements += message[1];
+        return true;
+    }
+
+    std::optional<int> take(const std::string& origin, std::size_t shot)
+    {
+        auto stored = measurements.find({std::atoi(origin.c_str()), shot});
+        if (stored == measurements.end())
+            return std::nullopt;
+        int measurement = stored->second.front();
+        stored->second.pop();
+        if (stored->second.empty())
+            measurements.erase(stored);
         return measurement;
     }
 };
@@ -44,14 +86,41 @@ ClassicalChannel::ClassicalChannel() : pimpl_{std::make_unique<Impl>()}, endpoin
 
 ClassicalChannel::~ClassicalChannel() = default;
 
-void ClassicalChannel::send_measure(int& measurement, std::string& target)
+void ClassicalChannel::send_measure(const int& measurement, const std::string& target, std::size_t shot)
+{
+    pimpl_->send({measurement}, target, shot);
+}
+
+void ClassicalChannel::send_measures(const std::vector<int>& measurements, const std::string& target, std::size_t first_shot)
+{
+    pimpl_->send(measurements, target, first_shot);
+}
+
+int ClassicalChannel::recv_measure(const std::string& origin, std::size_t shot)
+{
+    while (true) {
+        if (auto measurement = pimpl_->take(origin, shot))
+            return *measurement;
+        pimpl_->recv_next(true);
+    }
+}
+
+std::optional<int> ClassicalChannel::try_recv_measure(const std::string& origin, std::size_t shot)
+{
+    while (pimpl_->recv_next(false)) { }
+    return pimpl_->take(origin, shot);
+}
+
+void ClassicalChannel::wait_measure()
 {
-    pimpl_->send(measurement, target);
+    const std::size_t received = pimpl_->n_measurements;
+    while (pimpl_->n_measurements == received)
+        pimpl_->recv_next(true);
 }
 
-int ClassicalChannel::recv_measure(std::string& origin)
+std::size_t ClassicalChannel::measurements_received() const
 {
-    return pimpl_->recv(origin);
+    return pimpl_->n_measurements;
 }
 
 void ClassicalChannel::connect(std::vector<std::string>& endpoints)
@@ -1,7 +1,10 @@
 
 #include <string>
+#include <map>
 #include <queue>
 #include <memory>
+#include <utility>
+#include <string_view>
 #include <algorithm>
 #include <unordered_map>
 #include "zmq.hpp"
@@ -24,6 +27,12 @@ struct ClassicalChannel::Impl
     std::unordered_map<std::string, zmq::socket_t> zmq_sockets;
     zmq::socket_t zmq_comm_server;
     std::unordered_map<std::string, std::queue<std::string>> message_queue;
+    // Measurements by origin and shot, sent as
+    // "measure:<first shot>:<count>:<packed bits>"
+    std::map<std::pair<std::string, std::size_t>, std::queue<int>> measurements;
+    std::size_t n_measurements = 0;
+
+    static constexpr std::string_view MEASURE_PREFIX = "measure:";
 
     Impl(const std::string& id)
     {
@@ -82,30 +91,87 @@ struct ClassicalChannel::Impl
         
     }
     
-    std::string recv(const std::string& origin)
+    // Stores the next message that reaches the server, in the measurements if
+    // it is one and otherwise in the queue of its origin. Without wait,
+    // returns false if there was none.
+    bool recv_next(bool wait)
     {
-        if (!message_queue[origin].empty()) {
-            std::string stored_data = message_queue[origin].front();
-            message_queue[origin].pop();
-            return stored_data;
+        zmq::message_t id;
+        zmq::message_t message;
+        if (!zmq_comm_server.recv(id, wait ? zmq::recv_flags::none : zmq::recv_flags::dontwait))
+            return false;
+        [[maybe_unused]] auto ret = zmq_comm_server.recv(message, zmq::recv_flags::none);
+        std::string id_str(static_cast<char*>(id.data()), id.size());
+        std::string data(static_cast<char*>(message.data()), message.size());
+
+        if (data.starts_with(MEASURE_PREFIX)) {
+            auto separator = data.find(':', MEASURE_PREFIX.size());
+            auto bits = data.find(':', separator + 1) + 1;
+            auto first_shot = std::stoull(data.substr(MEASURE_PREFIX.size(), separator - MEASURE_PREFIX.size()));
+            auto count = std::stoull(data.substr(separator + 1, bits - separator - 2));
+            for (std::size_t i = 0; i < count; i++)
+                measurements[{id_str, first_shot + i}].push((static_cast<unsigned char>(data[bits + i / 8]) >> (i % 8)) & 1);
+            n_measurements += count;
         } else {
-            while (true) {
-                zmq::message_t id;
-                zmq::message_t message;
-                
-                LOGGER_DEBUG("{} vamos a recibir el circuito de {}", zmq_id, origin);
-                [[maybe_unused]] auto ret1 = zmq_comm_server.recv(id, zmq::recv_flags::none);
-                [[maybe_unused]] auto ret2 = zmq_comm_server.recv(message, zmq::recv_flags::none);
-                std::string id_str(static_cast<char*>(id.data()), id.size());
-                std::string data(static_cast<char*>(message.data()), message.size());
-
-                if (id_str == origin) {
-                    return data;
-                } else {
-                    message_queue[id_str].push(data);
-                }
-            }
+            message_queue[id_str].push(data);
+        }
+        return true;
+    }
+
+    std::string recv(const std::string& origin)
+    {
+        LOGGER_DEBUG("{} vamos a recibir el circuito de {}", zmq_id, origin);
+        auto& queue = message_queue[origin];
+        while (queue.empty())
+            recv_next(true);
+        std::string stored_data = std::move(queue.front());
+        queue.pop();
+        return stored_data;
+    }
+
+    void send_measures(const std::vector<int>& batch, const std::string& target, std::size_t first_shot)
+    {
+        std::string data = std::string(MEASURE_PREFIX) + std::to_string(first_shot) + ":" + std::to_string(batch.size()) + ":";
+        std::string bits((batch.size() + 7) / 8, '\0');
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            if (batch[i])
+                bits[i / 8] |= static_cast<char>(1 << (i % 8));
         }
+        send(data + bits, target);
+    }
+
+    std::optional<int> take_measure(const std::string& origin, std::size_t shot)
+    {
+        auto stored = measurements.find({origin, shot});
+        if (stored == measurements.end())
+            return std::nullopt;
+        int measurement = stored->second.front();
+        stored->second.pop();
+        if (stored->second.empty())
+            measurements.erase(stored);
+        return measurement;
+    }
+
+    std::optional<int> try_recv_measure(const std::string& origin, std::size_t shot)
+    {
+        while (recv_next(false)) { }
+        return take_measure(origin, shot);
+    }
+
+    int recv_measure(const std::string& origin, std::size_t shot)
+    {
+        while (true) {
+            if (auto measurement = take_measure(origin, shot))
+                return *measurement;
+            recv_next(true);
+        }
+    }
+
+    void wait_measure()
+    {
+        const std::size_t received = n_measurements;
+        while (n_measurements == received)
+            recv_next(true);
     }
 };
 
@@ -166,8 +232,12 @@ std::string ClassicalChannel::recv_info(const std::string& origin) { return pimp
 //-----------------------------------------
 // Send and recv functions for measurements
 //-----------------------------------------
-void ClassicalChannel::send_measure(const int& measurement, const std::string& target) { pimpl_->send(std::to_string(measurement), target); }
-int ClassicalChannel::recv_measure(const std::string& origin) { return std::stoi(pimpl_->recv(origin)); }
+void ClassicalChannel::send_measure(const int& measurement, const std::string& target, std::size_t shot) { pimpl_->send_measures({measurement}, target, shot); }
+void ClassicalChannel::send_measures(const std::vector<int>& measurements, const std::string& target, std::size_t first_shot) { pimpl_->send_measures(measurements, target, first_shot); }
+int ClassicalChannel::recv_measure(const std::string& origin, std::size_t shot) { return pimpl_->recv_measure(origin, shot); }
+std::optional<int> ClassicalChannel::try_recv_measure(const std::string& origin, std::size_t shot) { return pimpl_->try_recv_measure(origin, shot); }
+void ClassicalChannel::wait_measure() { pimpl_->wait_measure(); }
+std::size_t ClassicalChannel::measurements_received() const { return pimpl_->n_measurements; }
 
 
 } // End of comm namespace
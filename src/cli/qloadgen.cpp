@@ -0,0 +1,339 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <numeric>
+#include <algorithm>
+#include <cstdlib>
+
+#include "argparse/argparse.hpp"
+
+#include "comm/client.hpp"
+#include "utils/constants.hpp"
+#include "utils/json.hpp"
+#include "logger.hpp"
+
+using namespace std::literals;
+using namespace cunqa;
+
+// qloadgen drives the QPUs of a family (raised with qraise or qlocal) with a
+// mix of circuits and reports throughput and latency percentiles. Every
+// worker owns a client connected to one QPU (round robin) and keeps at most
+// one request in flight, so --concurrency bounds the requests in the system.
+// Without --rate the workers send back to back (closed loop); with it, the
+// requests arrive following a Poisson process (open loop) and their latency
+// is measured from the scheduled arrival, so the queueing caused by a
+// saturated deployment is accounted for.
+
+struct CunqaArgs : public argparse::Args
+{
+    std::string& family_name                        = kwarg("fam,family_name", "Family of the QPUs to be driven.");
+    std::optional<std::vector<std::string>>& circuits = kwarg("circuits", "JSON files with the circuits of the mix, either a full task (instructions and config) or a list of instructions.").multi_argument();
+    std::optional<std::vector<int>>& weights        = kwarg("weights", "Relative frequency of each circuit in the mix. By default, uniform.").multi_argument();
+    int& n_qubits                                   = kwarg("n_qubits", "Number of qubits of the synthetic circuit, used if no circuits are provided.").set_default(5);
+    int& depth                                      = kwarg("depth", "Number of layers of the synthetic circuit, used if no circuits are provided.").set_default(10);
+    int& shots                                      = kwarg("s,shots", "Shots of the circuits that do not specify them.").set_default(1024);
+    int& concurrency                                = kwarg("c,concurrency", "Maximum number of requests in flight.").set_default(1);
+    int& requests                                   = kwarg("r,requests", "Number of measured requests.").set_default(100);
+    int& warmup                                     = kwarg("warmup", "Number of requests sent before measuring.").set_default(0);
+    std::optional<double>& rate                     = kwarg("rate", "Mean arrival rate in requests per second (open loop). By default, closed loop.");
+    int& seed                                       = kwarg("seed", "Seed of the circuit selection and the arrival times.").set_default(123123);
+    std::optional<std::string>& output              = kwarg("o,output", "Path where the report is written as JSON.");
+
+    void welcome() {
+        std::cout << "Welcome to qloadgen command, a load generator to measure the throughput and latency of a family of QPUs.\n" << std::endl;
+    }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Sample {
+    std::size_t circuit;
+    double latency_ms;
+    bool error;
+};
+
+JSON default_config(int n_qubits, int shots)
+{
+    // Same defaults as QJob._configure
+    return {
+        {"shots", shots},
+        {"method", "automatic"},
+        {"avoid_parallelization", false},
+        {"num_clbits", n_qubits},
+        {"num_qubits", n_qubits},
+        {"seed", 123123}
+    };
+}
+
+JSON synthetic_task(int n_qubits, int depth, int shots)
+{
+    std::mt19937_64 rng(n_qubits * 1000 + depth);
+    std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+
+    JSON instructions = JSON::array();
+    for (int layer = 0; layer < depth; ++layer) {
+        for (int q = 0; q < n_qubits; ++q)
+            instructions.push_back({{"name", "ry"}, {"qubits", JSON::array({q})}, {"params", JSON::array({angle(rng)})}});
+        for (int q = layer % 2; q + 1 < n_qubits; q += 2)
+            instructions.push_back({{"name", "cx"}, {"qubits", JSON::array({q, q + 1})}});
+    }
+    for (int q = 0; q < n_qubits; ++q)
+        instructions.push_back({{"name", "measure"}, {"qubits", JSON::array({q})}, {"clbits", JSON::array({q})}});
+
+    return {
+        {"id", "qloadgen"},
+        {"config", default_config(n_qubits, shots)},
+        {"instructions", instructions},
+        {"sending_to", JSON::array()},
+        {"is_dynamic", false},
+        {"has_cc", false}
+    };
+}
+
+JSON read_task(const std::string& path, int shots)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+        throw std::runtime_error("Unable to open the circuit file " + path);
+    JSON circuit = JSON::parse(in);
+
+    if (circuit.is_array()) {
+        int n_qubits = 0;
+        for (const auto& instruction : circuit)
+            for (int q : instruction.at("qubits"))
+                n_qubits = std::max(n_qubits, q + 1);
+        circuit = {
+            {"id", path},
+            {"config", default_config(n_qubits, shots)},
+            {"instructions", circuit},
+            {"sending_to", JSON::array()},
+            {"is_dynamic", false},
+            {"has_cc", false}
+        };
+    }
+    return circuit;
+}
+
+std::vector<std::string> get_family_endpoints(const std::string& family)
+{
+    std::ifstream in(constants::QPUS_FILEPATH);
+    if (!in.is_open())
+        throw std::runtime_error("Unable to open the QPUs file.");
+    JSON qpus;
+    in >> qpus;
+
+    std::vector<std::string> endpoints;
+    for (const auto& [key, qpu] : qpus.items())
+        if (qpu.value("family", "") == family)
+            endpoints.push_back(qpu.at("net").at("endpoint").get<std::string>());
+    return endpoints;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    std::size_t rank = static_cast<std::size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+JSON latency_summary(std::vector<double> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    double mean = latencies.empty() ? 0.0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    return {
+        {"mean", mean},
+        {"p50", percentile(latencies, 50)},
+        {"p90", percentile(latencies, 90)},
+        {"p99", percentile(latencies, 99)},
+        {"p99.9", percentile(latencies, 99.9)},
+        {"max", latencies.empty() ? 0.0 : latencies.back()}
+    };
+}
+
+} // End of anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    auto args = argparse::parse<CunqaArgs>(argc, argv, true);
+
+    try {
+        // Circuit mix
+        std::vector<std::string> messages;
+        std::vector<int> mix_shots;
+        if (args.circuits.has_value()) {
+            for (const auto& path : args.circuits.value()) {
+                auto task = read_task(path, args.shots);
+                mix_shots.push_back(task.at("config").value("shots", args.shots));
+                messages.push_back(task.dump());
+            }
+        } else {
+            messages.push_back(synthetic_task(args.n_qubits, args.depth, args.shots).dump());
+            mix_shots.push_back(args.shots);
+        }
+
+        std::vector<int> weights(messages.size(), 1);
+        if (args.weights.has_value()) {
+            if (args.weights.value().size() != messages.size()) {
+                LOGGER_ERROR("Different number of weights ({}) than circuits ({}).", args.weights.value().size(), messages.size());
+                return EXIT_FAILURE;
+            }
+            weights = args.weights.value();
+        }
+
+        auto endpoints = get_family_endpoints(args.family_name);
+        if (endpoints.empty()) {
+            LOGGER_ERROR("No QPUs found with family name {}.", args.family_name);
+            return EXIT_FAILURE;
+        }
+        if (args.concurrency < 1 || args.requests < 1) {
+            LOGGER_ERROR("concurrency and requests have to be positive.");
+            return EXIT_FAILURE;
+        }
+
+        // The whole schedule (circuit of each request and, in open loop, its
+        // arrival offset) is drawn beforehand so that it does not depend on
+        // the timing of the workers
+        const std::size_t total = args.warmup + args.requests;
+        std::mt19937_64 rng(args.seed);
+        std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+        std::vector<std::size_t> schedule(total);
+        std::vector<Clock::duration> arrivals(total, Clock::duration::zero());
+        for (auto& circuit : schedule)
+            circuit = pick(rng);
+        if (args.rate.has_value()) {
+            std::exponential_distribution<double> gap(args.rate.value());
+            double t = 0.0;
+            for (std::size_t i = args.warmup; i < total; ++i) {
+                t += gap(rng);
+                arrivals[i] = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t));
+            }
+        }
+
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> warmed{0};
+        std::vector<Sample> samples(total);
+        Clock::time_point start;
+        std::mutex start_mutex;
+        std::condition_variable start_condition;
+        bool started = false;
+
+        auto worker = [&](int w) {
+            comm::Client client;
+            client.connect(endpoints[w % endpoints.size()]);
+
+            std::size_t i;
+            while ((i = next.fetch_add(1)) < total) {
+                Clock::time_point scheduled;
+                if (i >= static_cast<std::size_t>(args.warmup)) {
+                    // Measured requests start once every warmup request has finished
+                    std::unique_lock<std::mutex> lock(start_mutex);
+                    start_condition.wait(lock, [&] { return started; });
+                    lock.unlock();
+                    scheduled = start + arrivals[i];
+                    std::this_thread::sleep_until(scheduled);
+                    if (!args.rate.has_value())
+                        scheduled = Clock::now();
+                } else {
+                    scheduled = Clock::now();
+                }
+
+                auto future = client.send_circuit(messages[schedule[i]]);
+                auto result = future.get();
+                auto end = Clock::now();
+
+                bool error = result.find("\"ERROR\"") != std::string::npos;
+                samples[i] = {schedule[i], std::chrono::duration<double, std::milli>(end - scheduled).count(), error};
+
+                if (i < static_cast<std::size_t>(args.warmup) && ++warmed == static_cast<std::size_t>(args.warmup)) {
+                    std::lock_guard<std::mutex> lock(start_mutex);
+                    start = Clock::now();
+                    started = true;
+                    start_condition.notify_all();
+                }
+            }
+        };
+
+        if (args.warmup == 0) {
+            start = Clock::now();
+            started = true;
+        }
+
+        std::vector<std::thread> workers;
+        for (int w = 0; w < args.concurrency; ++w)
+            workers.emplace_back(worker, w);
+        for (auto& t : workers)
+            t.join();
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        // Report
+        std::vector<double> latencies;
+        std::vector<std::vector<double>> per_circuit(messages.size());
+        std::size_t errors = 0;
+        double shots = 0;
+        for (std::size_t i = args.warmup; i < total; ++i) {
+            const auto& sample = samples[i];
+            if (sample.error) {
+                ++errors;
+                continue;
+            }
+            latencies.push_back(sample.latency_ms);
+            per_circuit[sample.circuit].push_back(sample.latency_ms);
+            shots += mix_shots[sample.circuit];
+        }
+
+        JSON report = {
+            {"family", args.family_name},
+            {"n_qpus", endpoints.size()},
+            {"concurrency", args.concurrency},
+            {"mode", args.rate.has_value() ? "open_loop" : "closed_loop"},
+            {"offered_rate", args.rate.has_value() ? JSON(args.rate.value()) : JSON()},
+            {"requests", args.requests},
+            {"errors", errors},
+            {"elapsed_s", elapsed},
+            {"throughput_rps", (args.requests - errors) / elapsed},
+            {"throughput_shots", shots / elapsed},
+            {"latency_ms", latency_summary(latencies)},
+            {"circuits", JSON::array()}
+        };
+        for (std::size_t c = 0; c < messages.size(); ++c)
+            report["circuits"].push_back({
+                {"circuit", args.circuits.has_value() ? args.circuits.value()[c] : "synthetic"s},
+                {"requests", per_circuit[c].size()},
+                {"latency_ms", latency_summary(per_circuit[c])}
+            });
+
+        const auto& latency = report["latency_ms"];
+        std::cout << std::fixed << std::setprecision(3)
+                  << "QPUs: " << endpoints.size() << "  concurrency: " << args.concurrency
+                  << "  mode: " << report["mode"].get<std::string>() << "\n"
+                  << "Requests: " << args.requests << " (" << errors << " errors) in " << elapsed << " s\n"
+                  << "Throughput: " << report["throughput_rps"].get<double>() << " req/s, "
+                  << report["throughput_shots"].get<double>() << " shots/s\n"
+                  << "Latency (ms): mean " << latency["mean"].get<double>()
+                  << "  p50 " << latency["p50"].get<double>()
+                  << "  p90 " << latency["p90"].get<double>()
+                  << "  p99 " << latency["p99"].get<double>()
+                  << "  p99.9 " << latency["p99.9"].get<double>()
+                  << "  max " << latency["max"].get<double>() << std::endl;
+
+        if (args.output.has_value()) {
+            std::ofstream out(args.output.value());
+            out << report.dump(4);
+        }
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("qloadgen failed: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
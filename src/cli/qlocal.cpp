@@ -0,0 +1,184 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "argparse/argparse.hpp"
+
+#include "utils/constants.hpp"
+#include "utils/json.hpp"
+#include "logger.hpp"
+
+using namespace std::literals;
+using namespace cunqa;
+
+// qlocal raises QPUs on the current machine, without SLURM. Each QPU is a
+// setup_qpus process with the environment srun would have given it
+// (SLURM_JOB_ID, SLURM_PROCID, SLURM_TASK_PID, ...), so the rest of the stack
+// (qpus file, python client, qdrop epilog cleanup) sees them as a regular job.
+// The QPUs live while qlocal does; Ctrl-C turns them off and cleans their
+// entries from the info files.
+
+struct CunqaArgs : public argparse::Args
+{
+    int& n_qpus                         = kwarg("n,num_qpus", "Number of QPUs to be raised.").set_default(1);
+    std::string& simulator              = kwarg("sim,simulator", "Simulator reponsible of running the simulations.").set_default("Aer");
+    std::string& family_name            = kwarg("fam,family_name", "Name that identifies which QPUs were raised together.").set_default("default");
+    std::optional<std::string>& backend = kwarg("b,backend", "Path to the backend config file.");
+    std::optional<std::string>& job_id  = kwarg("job_id", "Synthetic SLURM_JOB_ID given to the QPUs. By default, \"local<pid>\".");
+    bool& co_located                    = flag("co-located", "co-located mode. The user can connect with any deployed QPU.");
+    bool& cc                            = flag("classical_comm", "Enable classical communications.");
+    bool& qc                            = flag("quantum_comm", "Enable quantum communications.");
+
+    void welcome() {
+        std::cout << "Welcome to qlocal command, a command responsible for turning on QPUs in the local machine, without SLURM.\n" << std::endl;
+    }
+};
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void handle_stop(int) { stop_requested = 1; }
+
+pid_t spawn(const std::vector<std::string>& command, const std::string& job_id, int proc_id, int n_tasks)
+{
+    pid_t pid = fork();
+    if (pid == -1) {
+        LOGGER_ERROR("Unable to fork {}.", command[0]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        setenv("SLURM_JOB_ID", job_id.c_str(), 1);
+        setenv("SLURM_PROCID", std::to_string(proc_id).c_str(), 1);
+        setenv("SLURM_LOCALID", std::to_string(proc_id).c_str(), 1);
+        setenv("SLURM_TASK_PID", std::to_string(getpid()).c_str(), 1);
+        setenv("SLURM_NTASKS", std::to_string(n_tasks).c_str(), 1);
+
+        std::vector<char*> argv;
+        for (const auto& arg : command)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        execvp(argv[0], argv.data());
+        std::cerr << "qlocal: unable to execute " << command[0] << " (is it in the PATH?)\n";
+        _exit(127);
+    }
+
+    return pid;
+}
+
+std::size_t count_qpus(const std::string& job_id)
+{
+    try {
+        std::ifstream in(constants::QPUS_FILEPATH);
+        if (!in.is_open() || in.peek() == std::ifstream::traits_type::eof())
+            return 0;
+        JSON qpus;
+        in >> qpus;
+
+        std::size_t n = 0;
+        for (const auto& [key, _] : qpus.items())
+            if (key.rfind(job_id + "_", 0) == 0) ++n;
+        return n;
+    } catch (const std::exception&) {
+        // The file may be being rewritten by a QPU, try again later
+        return 0;
+    }
+}
+
+} // End of anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    auto args = argparse::parse<CunqaArgs>(argc, argv, true);
+
+    if (args.n_qpus < 1) {
+        LOGGER_ERROR("At least one QPU has to be raised.");
+        return EXIT_FAILURE;
+    }
+    if (args.cc && args.qc) {
+        LOGGER_ERROR("Classical and quantum communications can not be enabled at the same time.");
+        return EXIT_FAILURE;
+    }
+
+    const std::string job_id = args.job_id.has_value() ? args.job_id.value() : "local"s + std::to_string(getpid());
+    if (job_id.find('_') != std::string::npos) {
+        LOGGER_ERROR("The job_id can not contain \"_\", as it is used as separator of the QPU ids.");
+        return EXIT_FAILURE;
+    }
+    const std::string family = args.family_name == "default" ? job_id : args.family_name;
+    const std::string mode = args.co_located ? "co_located" : "hpc";
+    const std::string communications = args.cc ? "cc" : (args.qc ? "qc" : "no_comm");
+
+    std::vector<std::string> command = {"setup_qpus", mode, communications, family, args.simulator};
+    if (args.backend.has_value())
+        command.push_back(JSON({{"backend_path", args.backend.value()}}).dump());
+
+    struct sigaction action{};
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < args.n_qpus; ++i) {
+        pid_t pid = spawn(command, job_id, i, args.n_qpus);
+        if (pid == -1) {
+            stop_requested = 1;
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    if (args.qc && !stop_requested) {
+        // Same as qraise: give the QPUs time to publish their endpoints before the executor reads them
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        pid_t pid = spawn({"setup_executor", args.simulator, family}, job_id, args.n_qpus, args.n_qpus + 1);
+        if (pid == -1)
+            stop_requested = 1;
+        else
+            children.push_back(pid);
+    }
+
+    bool ready = false;
+    while (!stop_requested) {
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            LOGGER_ERROR("Process {} finished unexpectedly (status {}), turning off the rest.", pid, status);
+            std::erase(children, pid);
+            break;
+        }
+
+        if (!ready && count_qpus(job_id) == static_cast<std::size_t>(args.n_qpus)) {
+            ready = true;
+            std::cout << args.n_qpus << " QPUs ready. Job id: " << job_id << ", family: " << family
+                      << ". Press Ctrl-C to turn them off." << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    for (auto pid : children)
+        kill(pid, SIGTERM);
+    for (auto pid : children)
+        waitpid(pid, nullptr, 0);
+
+    // Same cleanup the SLURM epilog performs with erase_key
+    try {
+        remove_from_file(constants::QPUS_FILEPATH, job_id);
+        remove_from_file(constants::COMM_FILEPATH, job_id);
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error removing the QPUs from the info files: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
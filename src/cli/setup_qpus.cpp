@@ -23,6 +23,7 @@
 
 #include "utils/json.hpp"
 #include "utils/helpers/murmur_hash.hpp"
+#include "utils/helpers/slurm_env.hpp"
 #include "logger.hpp"
 
 using namespace std::string_literals;
@@ -41,8 +42,7 @@ JSON convert_to_backend(const JSON& backend_paths)
         std::ifstream f(path); // try-catch?
         qpu_properties = JSON::parse(f);
     } else if (backend_paths.size() > 1) {
-        std::string str_local_id = std::getenv("SLURM_PROCID");
-        int local_id = std::stoi(str_local_id);
+        int local_id = std::stoi(get_proc_id());
         auto qpu = backend_paths.begin();
         std::advance(qpu, local_id);
         std::string path = qpu.value().get<std::string>();
@@ -78,8 +78,7 @@ std::string get_qpu_name(const JSON& backend_paths)
     if (backend_paths.size() == 1) {
         qpu_name = backend_paths.begin().key();
     } else {
-        std::string str_local_id = std::getenv("SLURM_PROCID");
-        int local_id = std::stoi(str_local_id);
+        int local_id = std::stoi(get_proc_id());
         auto qpu = backend_paths.begin();
         std::advance(qpu, local_id);
         qpu_name = qpu.key();
@@ -136,17 +135,17 @@ int main(int argc, char *argv[])
     std::string sim_arg(argv[4]);
 
     if (family == "default")
-        family = std::getenv("SLURM_JOB_ID");
+        family = get_job_id();
 
     auto back_path_json = (argc == 6 ? JSON::parse(std::string(argv[5]))
                                      : JSON());
 
     JSON backend_json;
-    std::string name = family + "_" + std::getenv("SLURM_PROCID");
+    std::string name = family + "_" + get_proc_id();
     if (back_path_json.contains("noise_properties_path")) {
-        std::string fpath = std::string(constants::CUNQA_PATH) + "/tmp_noisy_backend_" + std::getenv("SLURM_JOB_ID") + ".json";
+        std::string fpath = std::string(constants::CUNQA_PATH) + "/tmp_noisy_backend_" + get_job_id() + ".json";
 
-        if (std::getenv("SLURM_PROCID") && std::string(std::getenv("SLURM_PROCID")) == "0") {
+        if (get_proc_id() == "0") {
             generate_noise_instructions(back_path_json, family);
             LOGGER_DEBUG("Correctly created tmp noise intructions file.");
         } else {
@@ -0,0 +1,92 @@
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+#include "dispatcher.hpp"
+#include "utils/json.hpp"
+#include "utils/helpers/binary_result.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+#include "logger.hpp"
+
+namespace cunqa {
+namespace comm {
+
+Dispatcher::Dispatcher(const std::vector<Client*>& clients, const std::vector<std::string>& templates, std::size_t max_batch) :
+    clients_{clients},
+    templates_{templates},
+    max_batch_{std::max<std::size_t>(1, max_batch)}
+{
+    if (clients_.empty() || clients_.size() != templates_.size())
+        throw std::invalid_argument("The dispatcher needs one message template per QPU.");
+}
+
+std::vector<std::string> Dispatcher::map(const std::vector<std::string>& items)
+{
+    const std::size_t n_items = items.size();
+    const std::size_t n_qpus = clients_.size();
+    std::vector<std::string> results(n_items);
+    assignment_.assign(n_items, 0);
+
+    std::mutex queue_mutex;
+    std::size_t next = 0;
+
+    // One thread per QPU, as each client is only used by its own thread
+    parallel_for_each_index(n_qpus, [&](std::size_t qpu) {
+        const JSON message_template = JSON::parse(templates_[qpu]);
+        while (true) {
+            std::size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (next >= n_items)
+                    return;
+                const std::size_t chunk = std::clamp<std::size_t>((n_items - next) / (2 * n_qpus), 1, max_batch_);
+                begin = next;
+                end = next + chunk;
+                next = end;
+            }
+
+            try {
+                JSON messages = JSON::array();
+                for (std::size_t i = begin; i < end; i++) {
+                    messages.push_back(JSON::parse(items[i]));
+                    messages.back().update(message_template);
+                    assignment_[i] = qpu;
+                }
+
+                // Registered circuits always go in a batch, whose params only
+                // apply to it, so no run leaves its params in the store
+                if (messages.size() == 1 && !messages[0].contains("handle")) {
+                    results[begin] = clients_[qpu]->send_circuit(messages[0].dump()).get();
+                    continue;
+                }
+
+                JSON reply = decode_result(clients_[qpu]->send_circuit(JSON({{"batch", messages}}).dump()).get());
+                if (!reply.contains("results"))
+                    throw std::runtime_error(reply.contains("ERROR") ? reply.at("ERROR").get<std::string>() : "Batch without results.");
+                for (std::size_t i = begin; i < end; i++)
+                    results[i] = encode_result(reply.at("results")[i - begin]);
+
+            } catch (const std::exception& e) {
+                // This QPU leaves the queue to the others
+                LOGGER_ERROR("Error evaluating items {} to {} on QPU {}: {}", begin, end - 1, qpu, e.what());
+                for (std::size_t i = begin; i < end; i++)
+                    results[i] = JSON({{"ERROR", std::string(e.what())}}).dump();
+                return;
+            }
+        }
+    }, n_qpus);
+
+    // Items left in the queue if every QPU failed
+    for (auto& result : results)
+        if (result.empty())
+            result = JSON({{"ERROR", "No QPU was left to run the item."}}).dump();
+
+    return results;
+}
+
+} // End of comm namespace
+} // End of cunqa namespace
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "comm/client.hpp"
+
+namespace cunqa {
+namespace comm {
+
+// Evaluation of many independent items (e.g. the parameter vectors of a
+// population) over several QPUs with a shared work queue: each QPU pulls the
+// next items as soon as its previous reply arrives, so a slow QPU takes less
+// work instead of holding back the rest.
+//
+// An item is a JSON message completed with the template of the QPU it lands
+// on, e.g. {"params": [...]} with {"handle": "<circuit registered there>"}.
+// Several items are sent together as a batch message to save round trips:
+// chunks of the remaining work divided among twice the number of QPUs, at
+// most max_batch items, so they shrink towards the end of the queue. Items
+// with a handle are sent as a batch even when alone, so the params of the
+// registered circuit stay the same whatever the grouping of the items.
+class Dispatcher {
+public:
+    Dispatcher(const std::vector<Client*>& clients, const std::vector<std::string>& templates, std::size_t max_batch = 8);
+
+    // Result of every item, in the order of the items. A failed batch gives
+    // its error to each of its items.
+    std::vector<std::string> map(const std::vector<std::string>& items);
+
+    // Index of the QPU that ran each item in the last map()
+    const std::vector<std::size_t>& assignment() const { return assignment_; }
+
+private:
+    std::vector<Client*> clients_;
+    std::vector<std::string> templates_;
+    std::size_t max_batch_;
+    std::vector<std::size_t> assignment_;
+};
+
+} // End of comm namespace
+} // End of cunqa namespace
@@ -0,0 +1,199 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <exception>
+
+#include "sharded_run.hpp"
+#include "utils/json.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/binary_result.hpp"
+
+#include "logger.hpp"
+
+namespace {
+
+using cunqa::JSON;
+
+double time_taken_of(const JSON& result)
+{
+    if (result.contains("time_taken"))
+        return result.at("time_taken").get<double>();
+    if (result.contains("results") && result.at("results")[0].contains("time_taken"))
+        return result.at("results")[0].at("time_taken").get<double>();
+    return 0.0;
+}
+
+// Statistics of a sampled cost over the shots of all the shards: the mean
+// weighted by shots, the pooled variance and the best outcome of any shard.
+// An exact cost is the same in every shard.
+void merge_costs(JSON& merged, const std::vector<JSON>& results)
+{
+    auto& cost = merged.at("cost");
+    if (cost.contains("exact"))
+        return;
+
+    double shots = 0.0, sum = 0.0, sum_squares = 0.0;
+    for (const auto& result : results) {
+        const auto& shard_cost = result.at("cost");
+        const double n = shard_cost.at("shots").get<double>();
+        const double mean = shard_cost.at("value").get<double>();
+        shots += n;
+        sum += n * mean;
+        sum_squares += n * (shard_cost.at("variance").get<double>() + mean * mean);
+        if (shard_cost.at("best_value").get<double>() < cost.at("best_value").get<double>()) {
+            cost["best_value"] = shard_cost.at("best_value");
+            cost["best"] = shard_cost.at("best");
+        }
+    }
+    const double mean = sum / shots;
+    cost["value"] = mean;
+    cost["variance"] = std::max(0.0, sum_squares / shots - mean * mean);
+    cost["shots"] = static_cast<std::uint64_t>(shots);
+}
+
+// Shard results of the same circuit on the same simulator, so all have the
+// same shape; the first one is the template of the merged result. A saved
+// state, being the same for every shard, is the one of the first shard.
+JSON merge_shard_results(std::vector<JSON>& results, const std::vector<cunqa::comm::Shard>& shards)
+{
+    JSON merged = results[0];
+
+    if (merged.contains("cost"))
+        merge_costs(merged, results);
+
+    if (merged.contains("packed_counts")) {
+        cunqa::PackedCounts packed(merged.at("packed_counts").at("n_clbits").get<std::size_t>());
+        for (const auto& result : results) {
+            const auto outcomes = cunqa::section_words(result.at("packed_counts").at("outcomes"));
+            const auto counts = cunqa::section_words(result.at("packed_counts").at("counts"));
+            for (std::size_t i = 0; i < counts.size(); i++)
+                packed.add(outcomes.data() + i * packed.n_words(), counts[i]);
+        }
+        merged["packed_counts"] = packed.to_json();
+    } else if (auto* counts = cunqa::counts_of(merged)) {
+        std::map<std::string, std::size_t> total;
+        for (auto& result : results)
+            for (const auto& [key, count] : cunqa::counts_of(result)->items())
+                total[key] += count.get<std::size_t>();
+        *counts = total;
+    }
+
+    if (merged.contains("memory")) {
+        // Rows of the shards one after the other
+        auto& rows = merged.at("memory").at("rows");
+        std::vector<std::size_t> shape = rows.at("shape");
+        const auto dtype = static_cast<cunqa::binary::DType>(rows.at("__binary__").get_binary().subtype());
+        std::vector<std::uint8_t> bytes;
+        shape[0] = 0;
+        for (const auto& result : results) {
+            const auto& shard_rows = result.at("memory").at("rows");
+            const auto& shard_bytes = shard_rows.at("__binary__").get_binary();
+            bytes.insert(bytes.end(), shard_bytes.begin(), shard_bytes.end());
+            shape[0] += shard_rows.at("shape")[0].get<std::size_t>();
+        }
+        rows = cunqa::binary::section(std::move(bytes), dtype, shape);
+    }
+
+    // The shards run concurrently, the run takes as long as the slowest one
+    JSON shard_info = JSON::array();
+    double time_taken = 0.0;
+    std::size_t shots = 0;
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const double shard_time = time_taken_of(results[i]);
+        time_taken = std::max(time_taken, shard_time);
+        shots += shards[i].shots;
+        shard_info.push_back({{"shots", shards[i].shots}, {"seed", shards[i].seed}, {"time_taken", shard_time}});
+    }
+    if (merged.contains("time_taken"))
+        merged["time_taken"] = time_taken;
+    if (merged.contains("results")) {
+        merged.at("results")[0]["time_taken"] = time_taken;
+        merged.at("results")[0]["shots"] = shots;
+    }
+    merged["shards"] = shard_info;
+
+    return merged;
+}
+
+} // End of anonymous namespace
+
+namespace cunqa {
+namespace comm {
+
+std::vector<Shard> shard_shots(std::size_t shots, std::uint64_t seed, std::size_t n_qpus)
+{
+    const std::size_t n_shards = std::max<std::size_t>(1, std::min(shots, n_qpus));
+    std::vector<Shard> shards;
+    for (std::size_t i = 0; i < n_shards; i++) {
+        // 31-bit seeds, as the AER simulator reads them as int
+        Hasher64 hasher(seed);
+        hasher.add(static_cast<std::uint64_t>(i));
+        shards.push_back({shots / n_shards + (i < shots % n_shards), hasher.digest() & 0x7fffffff});
+    }
+    return shards;
+}
+
+ShardedRun::ShardedRun(const std::vector<Client*>& clients, const std::string& circuit)
+{
+    try {
+        if (clients.empty())
+            throw std::invalid_argument("No QPUs to run the shards on.");
+
+        JSON message = JSON::parse(circuit);
+        if (!message.contains("config") || !message.at("config").contains("shots"))
+            throw std::invalid_argument("Only circuits with a run config can be sharded.");
+        auto& config = message.at("config");
+        // The CVaR needs the whole distribution of the cost, which the shards
+        // do not send back
+        if (config.contains("cost") && config.at("cost").contains("cvar") && config.at("cost").at("cvar").get<double>() < 1.0
+            && !(config.at("cost").contains("exact") && config.at("cost").at("exact").get<bool>()))
+            throw std::invalid_argument("The CVaR of a sampled cost cannot be combined from the shards, run the circuit without sharding.");
+        const std::uint64_t seed = config.contains("seed") ? config.at("seed").get<std::uint64_t>() : 0;
+        shards_ = shard_shots(config.at("shots").get<std::size_t>(), seed, clients.size());
+
+        for (std::size_t i = 0; i < shards_.size(); i++) {
+            config["shots"] = shards_[i].shots;
+            config["seed"] = shards_[i].seed;
+            clients[i]->send_circuit(message.dump());
+            clients_.push_back(clients[i]);
+        }
+        LOGGER_DEBUG("Circuit sharded over {} QPUs.", shards_.size());
+    } catch (const std::exception& e) {
+        LOGGER_ERROR("Error sharding the circuit: {}", e.what());
+        error_ = e.what();
+    }
+}
+
+std::string ShardedRun::get()
+{
+    if (received_)
+        return result_;
+    received_ = true;
+
+    // Every shard sent is received, even after an error, so that the next
+    // reply of each client belongs to its next request
+    std::vector<JSON> results;
+    for (std::size_t i = 0; i < clients_.size(); i++) {
+        results.push_back(decode_result(clients_[i]->recv_results()));
+        if (error_.empty() && results.back().contains("ERROR"))
+            error_ = "Shard " + std::to_string(i) + ": " + results.back().at("ERROR").get<std::string>();
+    }
+
+    if (error_.empty()) {
+        try {
+            result_ = encode_result(merge_shard_results(results, shards_));
+        } catch (const std::exception& e) {
+            LOGGER_ERROR("Error merging the results of the shards: {}", e.what());
+            error_ = e.what();
+        }
+    }
+    if (!error_.empty())
+        result_ = JSON({{"ERROR", error_}}).dump();
+
+    return result_;
+}
+
+} // End of comm namespace
+} // End of cunqa namespace
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "comm/client.hpp"
+
+namespace cunqa {
+namespace comm {
+
+struct Shard {
+    std::size_t shots;
+    std::uint64_t seed;
+};
+
+// Splits shots as evenly as possible over at most n_qpus shards, each with
+// its own seed derived from the seed of the run
+std::vector<Shard> shard_shots(std::size_t shots, std::uint64_t seed, std::size_t n_qpus);
+
+// One circuit sampled by several QPUs (e.g. all the QPUs of a family), each
+// one running a shard of the shots. The constructor sends every shard, so
+// the QPUs simulate concurrently, and get() waits for all of them and merges
+// their results into the result of a single run of the whole circuit: the
+// counts (or packed counts) and the per-shot memory are added up, and
+// "time_taken" is the one of the slowest shard. The statistics of a sampled
+// cost are pooled over the shards, except the CVaR, which cannot be, so a run
+// that asks for it is refused. The shots, seed and time_taken of each shard
+// are reported under "shards".
+class ShardedRun {
+public:
+    ShardedRun(const std::vector<Client*>& clients, const std::string& circuit);
+
+    std::string get();
+    const std::vector<Shard>& shards() const { return shards_; }
+
+private:
+    std::vector<Client*> clients_;
+    std::vector<Shard> shards_;
+    std::string error_;
+    std::string result_;
+    bool received_ = false;
+};
+
+} // End of comm namespace
+} // End of cunqa namespace
@@ -0,0 +1,250 @@
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <stdexcept>
+
+#include "adjoint_gradient.hpp"
+#include "observable.hpp"
+#include "backends/simulators/CUNQA/cunqa_adapters/statevector_kernels.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+namespace {
+
+using Complex = std::complex<double>;
+using Matrix2 = sim::kernels::Matrix2<double>;
+using State = std::vector<Complex>;
+
+constexpr Complex I{0.0, 1.0};
+constexpr std::size_t CHUNK = 1 << 16;
+
+// Gate of the circuit with its parameter slots, [first_slot, first_slot + n_slots)
+struct Gate {
+    std::string name;
+    std::vector<std::size_t> qubits;
+    std::vector<double> params;
+    std::size_t first_slot;
+    std::size_t n_slots;
+};
+
+// Slots of update_params_
+std::size_t parameter_slots(const std::string& name)
+{
+    if (name == "rx" || name == "ry" || name == "rz")
+        return 1;
+    if (name == "r")
+        return 2;
+    if (name == "u" || name == "cu")
+        return 3;
+    return 0;
+}
+
+// Matrix of a one-qubit gate, or of the target of a controlled one
+Matrix2 matrix(const std::string& name, const std::vector<double>& params)
+{
+    if (name == "id") return {1, 0, 0, 1};
+    if (name == "x")  return {0, 1, 1, 0};
+    if (name == "y")  return {0, -I, I, 0};
+    if (name == "z")  return {1, 0, 0, -1};
+    if (name == "h")  return {M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2};
+    if (name == "s")  return {1, 0, 0, I};
+    if (name == "sdg") return {1, 0, 0, -I};
+    if (name == "sx") return {Complex(0.5, 0.5), Complex(0.5, -0.5), Complex(0.5, -0.5), Complex(0.5, 0.5)};
+
+    if (params.empty())
+        throw std::runtime_error("Gate " + name + " is not supported by the adjoint gradient.");
+    const double c = std::cos(params[0] / 2), s = std::sin(params[0] / 2);
+    if (name == "rx") return {c, -I * s, -I * s, c};
+    if (name == "ry") return {c, -s, s, c};
+    if (name == "rz") return {std::exp(-I * (params[0] / 2)), 0, 0, std::exp(I * (params[0] / 2))};
+    if (name == "r" && params.size() >= 2)
+        return {c, -I * std::exp(-I * params[1]) * s, -I * std::exp(I * params[1]) * s, c};
+    if (name == "u" && params.size() >= 3)
+        return {c, -std::exp(I * params[2]) * s, std::exp(I * params[1]) * s, std::exp(I * (params[1] + params[2])) * c};
+    throw std::runtime_error("Gate " + name + " is not supported by the adjoint gradient.");
+}
+
+// Derivative of the matrix with respect to its k-th parameter. The angle of
+// the rotations enters through cos(θ/2) and sin(θ/2), so its derivative is
+// half the matrix at θ + π; the phases of r and u multiply their entries by i.
+Matrix2 derivative(const std::string& name, std::vector<double> params, std::size_t k)
+{
+    if (k == 0) {
+        params[0] += M_PI;
+        auto m = matrix(name, params);
+        for (auto& entry : m)
+            entry *= 0.5;
+        return m;
+    }
+    const auto m = matrix(name, params);
+    if (name == "r")
+        return {0, -I * m[1], I * m[2], 0};
+    if (k == 1) // φ of u
+        return {0, 0, I * m[2], I * m[3]};
+    return {0, I * m[1], 0, I * m[3]}; // λ of u
+}
+
+Matrix2 adjoint(const Matrix2& m)
+{
+    return {std::conj(m[0]), std::conj(m[2]), std::conj(m[1]), std::conj(m[3])};
+}
+
+bool controlled(const Gate& gate)
+{
+    return gate.qubits.size() == 2 && gate.name != "swap";
+}
+
+// Target gate of a controlled one
+std::string target_name(const Gate& gate)
+{
+    return controlled(gate) ? gate.name.substr(1) : gate.name;
+}
+
+// Phase e^{iγ} of a cu on the control-1 subspace, from its 4th parameter,
+// which is not one of its slots
+Complex control_phase(const Gate& gate)
+{
+    return gate.name == "cu" && gate.params.size() > 3 ? std::exp(I * gate.params[3]) : Complex(1.0);
+}
+
+Matrix2 gate_matrix(const Gate& gate)
+{
+    if (gate.name == "swap")
+        return Matrix2{};
+    auto m = matrix(target_name(gate), gate.params);
+    for (auto& entry : m)
+        entry *= control_phase(gate);
+    return m;
+}
+
+Matrix2 gate_derivative(const Gate& gate, std::size_t k)
+{
+    auto m = derivative(target_name(gate), gate.params, k);
+    for (auto& entry : m)
+        entry *= control_phase(gate);
+    return m;
+}
+
+void apply(State& state, std::size_t n_qubits, const Gate& gate, const Matrix2& m)
+{
+    if (gate.name == "swap")
+        sim::kernels::apply_swap(state.data(), n_qubits, gate.qubits[0], gate.qubits[1]);
+    else if (controlled(gate))
+        sim::kernels::apply_controlled_matrix(state.data(), n_qubits, gate.qubits[0], gate.qubits[1], m);
+    else
+        sim::kernels::apply_matrix(state.data(), n_qubits, gate.qubits[0], m);
+}
+
+std::vector<Gate> gates_of(const QuantumTask& quantum_task)
+{
+    if (quantum_task.is_dynamic || quantum_task.has_cc)
+        throw std::runtime_error("Gradients need circuits without classical control.");
+
+    std::vector<Gate> gates;
+    std::size_t slot = 0;
+    for (const auto& instruction : quantum_task.circuit) {
+        const auto name = instruction.at("name").get<std::string>();
+        if (name == "measure")
+            continue;
+        Gate gate{name, instruction.at("qubits").get<std::vector<std::size_t>>(), {}, slot, parameter_slots(name)};
+        if (instruction.contains("params"))
+            gate.params = instruction.at("params").get<std::vector<double>>();
+        if (gate.qubits.size() > 2 || (gate.qubits.size() == 2 && name != "swap" && (name.size() < 2 || name[0] != 'c')))
+            throw std::runtime_error("Gate " + name + " is not supported by the adjoint gradient.");
+        // Fails early on unknown gates
+        if (name != "swap")
+            matrix(target_name(gate), gate.params);
+        slot += gate.n_slots;
+        gates.push_back(std::move(gate));
+    }
+    return gates;
+}
+
+// Re<a|b>
+double real_inner_product(const State& a, const State& b)
+{
+    std::vector<double> partial((a.size() + CHUNK - 1) / CHUNK, 0.0);
+    parallel_for_each_index(partial.size(), [&](std::size_t c) {
+        double sum = 0.0;
+        for (std::size_t i = c * CHUNK; i < std::min(a.size(), (c + 1) * CHUNK); i++)
+            sum += a[i].real() * b[i].real() + a[i].imag() * b[i].imag();
+        partial[c] = sum;
+    });
+    double sum = 0.0;
+    for (auto value : partial)
+        sum += value;
+    return sum;
+}
+
+// The derivative of a controlled gate is zero where the control is 0
+void project_on_control(State& state, std::size_t control)
+{
+    const std::size_t n_chunks = (state.size() + CHUNK - 1) / CHUNK;
+    parallel_for_each_index(n_chunks, [&](std::size_t c) {
+        for (std::size_t i = c * CHUNK; i < std::min(state.size(), (c + 1) * CHUNK); i++)
+            if (!((i >> control) & 1))
+                state[i] = 0.0;
+    });
+}
+
+} // End of anonymous namespace
+
+bool gradient_requested(const JSON& config)
+{
+    return config.contains("gradient") && !config.at("gradient").is_null();
+}
+
+JSON adjoint_gradient(const QuantumTask& quantum_task)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const std::size_t n_qubits = quantum_task.config.at("num_qubits").get<std::size_t>();
+    if (n_qubits > 63)
+        throw std::runtime_error("Gradients need less than 64 qubits.");
+    const Observable observable(quantum_task.config.at("gradient").at("observable"), n_qubits);
+    const auto gates = gates_of(quantum_task);
+    const std::size_t n_params = gates.empty() ? 0 : gates.back().first_slot + gates.back().n_slots;
+
+    // Forward sweep
+    State phi(std::size_t(1) << n_qubits, 0.0);
+    phi[0] = 1.0;
+    for (const auto& gate : gates)
+        apply(phi, n_qubits, gate, gate_matrix(gate));
+
+    State lambda(phi.size());
+    observable.apply(phi.data(), lambda.data());
+    const double expectation = real_inner_product(phi, lambda);
+
+    // Backward sweep: before undoing gate g, lambda is O|ψ> pulled back
+    // through the gates after g and phi is the state before g
+    std::vector<double> gradient(n_params, 0.0);
+    State mu(phi.size());
+    for (auto gate = gates.rbegin(); gate != gates.rend(); ++gate) {
+        const auto m = gate_matrix(*gate);
+        apply(phi, n_qubits, *gate, adjoint(m));
+        for (std::size_t k = 0; k < gate->n_slots; k++) {
+            mu = phi;
+            apply(mu, n_qubits, *gate, gate_derivative(*gate, k));
+            if (controlled(*gate))
+                project_on_control(mu, gate->qubits[0]);
+            gradient[gate->first_slot + k] = 2 * real_inner_product(lambda, mu);
+        }
+        if (gate + 1 != gates.rend())
+            apply(lambda, n_qubits, *gate, adjoint(m));
+    }
+
+    return {
+        {"expectation", expectation},
+        {"gradient", gradient},
+        {"method", "adjoint"},
+        {"time_taken", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()}
+    };
+}
+
+} // End of optimization namespace
+} // End of cunqa namespace
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+// Gradient execution mode ("gradient": {"observable": {...}} in the run
+// config, with the observables of observable.hpp)
+bool gradient_requested(const JSON& config);
+
+// Expectation value of the observable in the state prepared by a static
+// circuit and its gradient with respect to every parameter slot, in the order
+// update_circuit({"params": ...}) assigns them (one per rx, ry and rz, two
+// per r, three per u and cu). The adjoint method takes one forward sweep of
+// the statevector and one backward sweep that undoes each gate on the state
+// and on the observable applied to it, so the cost does not grow with the
+// number of parameters as the parameter shift rule does. Measurements are
+// dropped and the amplitudes are double precision. Returns {"expectation",
+// "gradient", "time_taken", "method": "adjoint"}.
+JSON adjoint_gradient(const QuantumTask& quantum_task);
+
+} // End of optimization namespace
+} // End of cunqa namespace
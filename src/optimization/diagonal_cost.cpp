@@ -0,0 +1,328 @@
+#include <cmath>
+#include <bit>
+#include <limits>
+#include <string>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <stdexcept>
+
+#include "diagonal_cost.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/binary_result.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+namespace {
+
+// Entries of the distribution evaluated by each task of the thread pool
+constexpr std::size_t CHUNK = 1 << 14;
+
+// Weighted cost values of a distribution, reduced per chunk
+struct Moments {
+    double weight = 0.0;
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    double best_value = std::numeric_limits<double>::infinity();
+    std::size_t best = 0;
+
+    void add(double value, double w, std::size_t index)
+    {
+        weight += w;
+        sum += w * value;
+        sum_squares += w * value * value;
+        if (value < best_value) {
+            best_value = value;
+            best = index;
+        }
+    }
+
+    void merge(const Moments& other)
+    {
+        weight += other.weight;
+        sum += other.sum;
+        sum_squares += other.sum_squares;
+        if (other.best_value < best_value) {
+            best_value = other.best_value;
+            best = other.best;
+        }
+    }
+};
+
+// Mean of the lowest alpha fraction of the distribution, the entry at the
+// boundary counted in part
+double cvar(std::vector<std::pair<double, double>>& values_weights, double total_weight, double alpha)
+{
+    std::sort(values_weights.begin(), values_weights.end());
+    const double target = alpha * total_weight;
+    double taken = 0.0, sum = 0.0;
+    for (const auto& [value, weight] : values_weights) {
+        const double w = std::min(weight, target - taken);
+        sum += w * value;
+        taken += w;
+        if (taken >= target)
+            break;
+    }
+    return sum / taken;
+}
+
+// Key of the best outcome (bit i is clbit or qubit i) in the order of the
+// counts of the simulator, so that sampled and exact costs report the same one
+std::string best_key(const std::uint64_t* words, std::size_t n_bits, bool leftmost)
+{
+    std::string key = outcome_to_bitstring(words, n_bits);
+    if (leftmost)
+        std::reverse(key.begin(), key.end());
+    return key;
+}
+
+template<typename T>
+std::vector<double> probabilities(const JSON::binary_t& bytes)
+{
+    const std::size_t size = bytes.size() / sizeof(std::complex<T>);
+    const auto* amplitudes = reinterpret_cast<const std::complex<T>*>(bytes.data());
+    std::vector<double> p(size);
+    for (std::size_t i = 0; i < size; i++)
+        p[i] = std::norm(std::complex<double>(amplitudes[i]));
+    return p;
+}
+
+} // End of anonymous namespace
+
+bool cost_requested(const JSON& config)
+{
+    return config.contains("cost") && !config.at("cost").is_null();
+}
+
+DiagonalCost::DiagonalCost(const JSON& definition)
+{
+    if (definition.contains("ising")) {
+        const auto& ising = definition.at("ising");
+        if (ising.contains("h")) {
+            const auto h = ising.at("h").get<std::vector<double>>();
+            for (std::size_t i = 0; i < h.size(); i++)
+                if (h[i] != 0.0)
+                    add_term_({i}, h[i], true);
+        }
+        if (ising.contains("J"))
+            for (const auto& coupling : ising.at("J"))
+                add_term_({coupling.at(0).get<std::size_t>(), coupling.at(1).get<std::size_t>()}, coupling.at(2).get<double>(), true);
+        if (ising.contains("offset"))
+            offset_ += ising.at("offset").get<double>();
+    } else if (definition.contains("maxcut")) {
+        // -w [x_i != x_j] = w (z_i z_j - 1) / 2
+        for (const auto& edge : definition.at("maxcut")) {
+            const double weight = edge.size() > 2 ? edge.at(2).get<double>() : 1.0;
+            add_term_({edge.at(0).get<std::size_t>(), edge.at(1).get<std::size_t>()}, weight / 2, true);
+            offset_ -= weight / 2;
+        }
+    } else if (definition.contains("polynomial")) {
+        for (const auto& term : definition.at("polynomial"))
+            add_term_(term.at("bits").get<std::vector<std::size_t>>(), term.at("coeff").get<double>(), false);
+    } else {
+        throw std::invalid_argument("The cost needs \"ising\", \"maxcut\" or \"polynomial\" terms.");
+    }
+
+    if (definition.contains("exact"))
+        exact_ = definition.at("exact").get<bool>();
+    if (definition.contains("cvar")) {
+        alpha_ = definition.at("cvar").get<double>();
+        if (!(alpha_ > 0.0 && alpha_ <= 1.0))
+            throw std::invalid_argument("The cvar alpha of the cost must be in (0, 1].");
+    }
+    resize_masks_();
+}
+
+void DiagonalCost::add_term_(const std::vector<std::size_t>& bits, double coeff, bool parity)
+{
+    Term term{{}, coeff, parity};
+    for (auto bit : bits) {
+        n_bits_ = std::max(n_bits_, bit + 1);
+        if (term.mask.size() <= bit / 64)
+            term.mask.resize(bit / 64 + 1, 0);
+        // A repeated spin squares to 1, a repeated bit to itself
+        if (parity)
+            term.mask[bit / 64] ^= std::uint64_t(1) << (bit % 64);
+        else
+            term.mask[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    }
+    terms_.push_back(std::move(term));
+}
+
+void DiagonalCost::resize_masks_()
+{
+    n_words_ = outcome_words(n_bits_);
+    for (auto& term : terms_)
+        term.mask.resize(n_words_, 0);
+}
+
+double DiagonalCost::value(const std::uint64_t* words) const
+{
+    double value = offset_;
+    for (const auto& term : terms_) {
+        if (term.parity) {
+            unsigned ones = 0;
+            for (std::size_t w = 0; w < n_words_; w++)
+                ones += std::popcount(words[w] & term.mask[w]);
+            value += (ones & 1) ? -term.coeff : term.coeff;
+        } else {
+            bool all = true;
+            for (std::size_t w = 0; w < n_words_ && all; w++)
+                all = (words[w] & term.mask[w]) == term.mask[w];
+            if (all)
+                value += term.coeff;
+        }
+    }
+    return value;
+}
+
+void DiagonalCost::evaluate(JSON& result) const
+{
+    if (!result.is_object() || result.contains("ERROR"))
+        return;
+
+    JSON cost = exact_ ? exact_from_state_(result) : sampled_(result);
+
+    for (const auto* key : {"counts", "packed_counts", "memory", "state"})
+        result.erase(key);
+    if (result.contains("results") && result.at("results")[0].contains("data"))
+        result.at("results")[0].at("data").erase("counts");
+    result["cost"] = std::move(cost);
+}
+
+JSON DiagonalCost::sampled_(const JSON& result) const
+{
+    // Outcomes as rows of words, from the packed counts or from the keys of
+    // the counts, at the top level (CUNQA and Munich) or in the experiment
+    // (AER), each one with its own clbit order
+    std::size_t n_clbits, row_words;
+    std::vector<std::uint64_t> outcomes, counts;
+    if (result.contains("packed_counts")) {
+        const auto& packed = result.at("packed_counts");
+        n_clbits = packed.at("n_clbits").get<std::size_t>();
+        outcomes = section_words(packed.at("outcomes"));
+        counts = section_words(packed.at("counts"));
+        row_words = outcome_words(n_clbits);
+    } else {
+        const JSON* json_counts = counts_of(result);
+        if (!json_counts)
+            throw std::runtime_error("The cost needs the counts of the run.");
+        n_clbits = 0;
+        for (const auto& [key, _] : json_counts->items()) {
+            n_clbits = std::count_if(key.begin(), key.end(), [](char c) { return c != ' '; });
+            break;
+        }
+        row_words = outcome_words(n_clbits);
+        outcomes.reserve(json_counts->size() * row_words);
+        for (const auto& [key, count] : json_counts->items()) {
+            outcomes.resize(outcomes.size() + row_words, 0);
+            parse_bitstring(key, outcomes.data() + outcomes.size() - row_words, row_words);
+            counts.push_back(count.get<std::uint64_t>());
+        }
+    }
+    if (n_bits_ > n_clbits)
+        throw std::runtime_error("The cost acts on bit " + std::to_string(n_bits_ - 1) + " but the run has " + std::to_string(n_clbits) + " clbits.");
+
+    // Rows with clbit i at bit i, as the terms of the cost read them
+    const bool leftmost = clbit0_leftmost(result);
+    const std::size_t n = counts.size();
+    std::vector<double> values(n);
+    std::vector<Moments> chunks((n + CHUNK - 1) / CHUNK);
+    parallel_for_each_index(chunks.size(), [&](std::size_t c) {
+        for (std::size_t i = c * CHUNK; i < std::min(n, (c + 1) * CHUNK); i++) {
+            if (leftmost)
+                reverse_outcome(outcomes.data() + i * row_words, n_clbits);
+            values[i] = value(outcomes.data() + i * row_words);
+            chunks[c].add(values[i], static_cast<double>(counts[i]), i);
+        }
+    });
+    Moments moments;
+    for (const auto& chunk : chunks)
+        moments.merge(chunk);
+    if (moments.weight == 0.0)
+        throw std::runtime_error("The cost needs a run with shots.");
+
+    const double mean = moments.sum / moments.weight;
+    JSON cost = {
+        {"value", mean},
+        {"variance", std::max(0.0, moments.sum_squares / moments.weight - mean * mean)},
+        {"best", best_key(outcomes.data() + moments.best * row_words, n_clbits, leftmost)},
+        {"best_value", moments.best_value},
+        {"shots", static_cast<std::uint64_t>(moments.weight)}
+    };
+    if (alpha_ < 1.0) {
+        std::vector<std::pair<double, double>> values_weights(n);
+        for (std::size_t i = 0; i < n; i++)
+            values_weights[i] = {values[i], static_cast<double>(counts[i])};
+        cost["cvar"] = cvar(values_weights, moments.weight, alpha_);
+        cost["alpha"] = alpha_;
+    }
+    return cost;
+}
+
+JSON DiagonalCost::exact_from_state_(const JSON& result) const
+{
+    if (!result.contains("state") || result.at("state").at("type") != "statevector")
+        throw std::runtime_error("The simulator did not return the statevector that an exact cost needs.");
+
+    const auto& state = result.at("state");
+    const std::size_t n_qubits = state.at("n_qubits").get<std::size_t>();
+    if (n_bits_ > n_qubits)
+        throw std::runtime_error("The cost acts on qubit " + std::to_string(n_bits_ - 1) + " but the circuit has " + std::to_string(n_qubits) + " qubits.");
+    if (n_qubits > 63)
+        throw std::runtime_error("Exact costs need less than 64 qubits.");
+
+    const auto& bytes = state.at("data").at("__binary__").get_binary();
+    const auto dtype = static_cast<binary::DType>(bytes.subtype());
+    std::vector<double> p;
+    if (dtype == binary::DType::C64)
+        p = probabilities<float>(bytes);
+    else if (dtype == binary::DType::C128)
+        p = probabilities<double>(bytes);
+    else
+        throw std::runtime_error("Unexpected dtype of the statevector.");
+
+    // Basis state i is its own outcome, qubit 0 the least significant bit
+    const std::size_t n = p.size();
+    std::vector<Moments> chunks((n + CHUNK - 1) / CHUNK);
+    std::vector<double> values(alpha_ < 1.0 ? n : 0);
+    parallel_for_each_index(chunks.size(), [&](std::size_t c) {
+        std::vector<std::uint64_t> words(n_words_, 0);
+        for (std::size_t i = c * CHUNK; i < std::min(n, (c + 1) * CHUNK); i++) {
+            words[0] = i;
+            const double v = value(words.data());
+            if (!values.empty())
+                values[i] = v;
+            if (p[i] > 0.0)
+                chunks[c].add(v, p[i], i);
+        }
+    });
+    Moments moments;
+    for (const auto& chunk : chunks)
+        moments.merge(chunk);
+
+    // Normalized, as single precision states drift from norm 1
+    const double mean = moments.sum / moments.weight;
+    std::uint64_t best = moments.best;
+    JSON cost = {
+        {"value", mean},
+        {"variance", std::max(0.0, moments.sum_squares / moments.weight - mean * mean)},
+        {"best", best_key(&best, n_qubits, clbit0_leftmost(result))},
+        {"best_value", moments.best_value},
+        {"exact", true}
+    };
+    if (alpha_ < 1.0) {
+        std::vector<std::pair<double, double>> values_weights;
+        for (std::size_t i = 0; i < n; i++)
+            if (p[i] > 0.0)
+                values_weights.emplace_back(values[i], p[i]);
+        cost["cvar"] = cvar(values_weights, moments.weight, alpha_);
+        cost["alpha"] = alpha_;
+    }
+    return cost;
+}
+
+} // End of optimization namespace
+} // End of cunqa namespace
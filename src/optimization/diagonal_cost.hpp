@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+// Cost diagonal in the computational basis, evaluated at the QPU on the
+// outcomes of a run ("cost" in the run config) so that only its statistics
+// travel back instead of the counts:
+//
+//     {"ising": {"h": [h0, h1, ...], "J": [[i, j, Jij], ...], "offset": c}}
+//     {"maxcut": [[i, j, w], ...]}
+//     {"polynomial": [{"bits": [i, j, ...], "coeff": c}, ...]}
+//
+// The Ising energy takes the spin +1 for bit 0 and -1 for bit 1, the MaxCut
+// cost is minus the weight of the cut (w defaults to 1), so that every cost is
+// minimized, and a polynomial term is the product of its bits. Bit i is clbit
+// i of the sampled outcomes or, with "exact": true, qubit i of the final
+// statevector, whose probabilities weight the cost instead of the shots.
+// "cvar": alpha adds the mean of the lowest alpha fraction of the cost
+// distribution.
+bool cost_requested(const JSON& config);
+
+class DiagonalCost
+{
+public:
+    explicit DiagonalCost(const JSON& definition);
+
+    std::size_t n_bits() const { return n_bits_; }
+    bool exact() const { return exact_; }
+
+    double value(const std::uint64_t* words) const;
+
+    // Replaces the counts, the memory and the state of a result by
+    // {"cost": {"value", "variance", "cvar", "alpha", "best", "best_value",
+    // "shots" | "exact"}}, "best" written as a key of the counts of the
+    // simulator that ran it (see clbit0_leftmost)
+    void evaluate(JSON& result) const;
+
+private:
+    struct Term {
+        std::vector<std::uint64_t> mask;
+        double coeff;
+        bool parity; // (-1)^(x·mask) for Ising terms, product of the bits otherwise
+    };
+
+    std::size_t n_bits_ = 0;
+    std::size_t n_words_ = 1;
+    double offset_ = 0.0;
+    std::vector<Term> terms_;
+    bool exact_ = false;
+    double alpha_ = 1.0;
+
+    void add_term_(const std::vector<std::size_t>& bits, double coeff, bool parity);
+    void resize_masks_();
+    JSON sampled_(const JSON& result) const;
+    JSON exact_from_state_(const JSON& result) const;
+};
+
+} // End of optimization namespace
+} // End of cunqa namespace
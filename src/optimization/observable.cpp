@@ -0,0 +1,206 @@
+#include <bit>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "observable.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+namespace {
+
+bool qubitwise_commute(const std::string& basis, const std::string& paulis)
+{
+    for (std::size_t q = 0; q < basis.size(); q++)
+        if (basis[q] != 'I' && paulis[q] != 'I' && basis[q] != paulis[q])
+            return false;
+    return true;
+}
+
+// Counts of a result that failed or has none are an error
+const JSON& required_counts(const JSON& result)
+{
+    if (result.contains("ERROR"))
+        throw std::runtime_error(result.at("ERROR").get<std::string>());
+    if (const auto* counts = counts_of(result))
+        return *counts;
+    throw std::runtime_error("Result without counts.");
+}
+
+} // End of anonymous namespace
+
+Observable::Observable(const JSON& definition, std::size_t n_qubits) :
+    n_qubits_{n_qubits}
+{
+    if (definition.contains("pauli")) {
+        for (const auto& term : definition.at("pauli")) {
+            auto label = term.at(0).get<std::string>();
+            if (label.size() != n_qubits_)
+                throw std::invalid_argument("Pauli string " + label + " does not have one character per qubit.");
+            add_term_(std::string(label.rbegin(), label.rend()), term.at(1).get<double>());
+        }
+    } else if (definition.contains("ising") || definition.contains("maxcut") || definition.contains("polynomial")) {
+        if (definition.contains("cvar"))
+            throw std::invalid_argument("The cvar of a cost is not an expectation value, it cannot be optimized as an observable.");
+        cost_.emplace(definition);
+        if (cost_->n_bits() > n_qubits_)
+            throw std::invalid_argument("The cost acts on qubit " + std::to_string(cost_->n_bits() - 1) + " but the circuit has " + std::to_string(n_qubits_) + " qubits.");
+        // One group without terms, measured in the computational basis
+        groups_.push_back({std::string(n_qubits_, 'Z'), {}});
+    } else if (definition.contains("diagonal")) {
+        for (const auto& term : definition.at("diagonal")) {
+            std::string paulis(n_qubits_, 'I');
+            // Z·Z = I on a repeated qubit
+            for (const auto& qubit : term.at("qubits")) {
+                auto& pauli = paulis.at(qubit.get<std::size_t>());
+                pauli = pauli == 'Z' ? 'I' : 'Z';
+            }
+            add_term_(paulis, term.at("coeff").get<double>());
+        }
+    } else {
+        throw std::invalid_argument("The observable needs \"pauli\", \"diagonal\", \"ising\", \"maxcut\" or \"polynomial\" terms.");
+    }
+}
+
+void Observable::add_term_(std::string paulis, double coeff)
+{
+    for (auto& pauli : paulis) {
+        if (pauli == 'i' || pauli == 'x' || pauli == 'y' || pauli == 'z')
+            pauli -= 'a' - 'A';
+        if (pauli != 'I' && pauli != 'X' && pauli != 'Y' && pauli != 'Z')
+            throw std::invalid_argument("Unknown Pauli operator in the observable.");
+    }
+    if (paulis.find_first_not_of('I') == std::string::npos) {
+        constant_ += coeff;
+        return;
+    }
+
+    terms_.push_back({paulis, coeff});
+    const std::size_t term = terms_.size() - 1;
+    for (auto& group : groups_) {
+        if (qubitwise_commute(group.basis, paulis)) {
+            for (std::size_t q = 0; q < n_qubits_; q++)
+                if (paulis[q] != 'I')
+                    group.basis[q] = paulis[q];
+            group.terms.push_back(term);
+            return;
+        }
+    }
+    groups_.push_back({paulis, {term}});
+}
+
+std::vector<QuantumTask> Observable::measurement_tasks(const QuantumTask& ansatz) const
+{
+    if (ansatz.is_dynamic || ansatz.has_cc)
+        throw std::invalid_argument("Only circuits without classical control can be optimized at the QPU.");
+
+    QuantumTask unitary = ansatz;
+    unitary.circuit = JSON::array();
+    for (const auto& instruction : ansatz.circuit)
+        if (instruction.at("name") != "measure")
+            unitary.circuit.push_back(instruction);
+    unitary.config["num_clbits"] = n_qubits_;
+    for (const auto* key : {"result_format", "memory", "save_state", "cost", "gradient"})
+        unitary.config.erase(key);
+
+    std::vector<QuantumTask> tasks;
+    for (const auto& group : groups_) {
+        QuantumTask task = unitary;
+        for (std::size_t q = 0; q < n_qubits_; q++) {
+            if (group.basis[q] == 'Y')
+                task.circuit.push_back({{"name", "sdg"}, {"qubits", {q}}});
+            if (group.basis[q] == 'X' || group.basis[q] == 'Y')
+                task.circuit.push_back({{"name", "h"}, {"qubits", {q}}});
+        }
+        for (std::size_t q = 0; q < n_qubits_; q++)
+            task.circuit.push_back({{"name", "measure"}, {"qubits", {q}}, {"clbits", {q}}});
+        task.hash = hash_circuit(task.circuit, task.config);
+        tasks.push_back(std::move(task));
+    }
+    // Only the constant is left
+    if (tasks.empty())
+        tasks.push_back(unitary);
+    return tasks;
+}
+
+double Observable::expectation(const std::vector<const JSON*>& results) const
+{
+    double value = constant_;
+    const std::size_t n_words = outcome_words(n_qubits_);
+    std::vector<std::uint64_t> words(n_words);
+
+    for (std::size_t g = 0; g < groups_.size(); g++) {
+        const auto& counts = required_counts(*results.at(g));
+        // Qubit q is measured into clbit q, bit q of the words
+        const bool leftmost = clbit0_leftmost(*results.at(g));
+        std::vector<double> sums(groups_[g].terms.size(), 0.0);
+        double shots = 0.0, cost_sum = 0.0;
+        for (const auto& [key, count_json] : counts.items()) {
+            std::fill(words.begin(), words.end(), 0);
+            parse_bitstring(key, words.data(), n_words);
+            if (leftmost)
+                reverse_outcome(words.data(), n_qubits_);
+            const double count = count_json.get<double>();
+            shots += count;
+            if (cost_)
+                cost_sum += count * cost_->value(words.data());
+            for (std::size_t t = 0; t < groups_[g].terms.size(); t++) {
+                const auto& paulis = terms_[groups_[g].terms[t]].paulis;
+                bool odd = false;
+                for (std::size_t q = 0; q < n_qubits_; q++)
+                    if (paulis[q] != 'I' && ((words[q / 64] >> (q % 64)) & 1))
+                        odd = !odd;
+                sums[t] += odd ? -count : count;
+            }
+        }
+        if (shots == 0.0)
+            throw std::runtime_error("Result without shots.");
+        if (cost_)
+            value += cost_sum / shots;
+        for (std::size_t t = 0; t < groups_[g].terms.size(); t++)
+            value += terms_[groups_[g].terms[t]].coeff * sums[t] / shots;
+    }
+    return value;
+}
+
+void Observable::apply(const std::complex<double>* state, std::complex<double>* out) const
+{
+    constexpr std::size_t CHUNK = 1 << 16;
+    const std::size_t size = std::size_t(1) << n_qubits_;
+    const std::size_t n_chunks = (size + CHUNK - 1) / CHUNK;
+
+    parallel_for_each_index(n_chunks, [&](std::size_t c) {
+        for (std::size_t i = c * CHUNK; i < std::min(size, (c + 1) * CHUNK); i++) {
+            std::uint64_t word = i;
+            out[i] = (cost_ ? constant_ + cost_->value(&word) : constant_) * state[i];
+        }
+    });
+
+    // P|i> = i^{#Y} (-1)^{|i & z|} |i ^ x>, with x the qubits with X or Y
+    // and z the ones with Z or Y
+    for (const auto& term : terms_) {
+        std::uint64_t x = 0, z = 0;
+        unsigned n_y = 0;
+        for (std::size_t q = 0; q < n_qubits_; q++) {
+            if (term.paulis[q] == 'X' || term.paulis[q] == 'Y')
+                x |= std::uint64_t(1) << q;
+            if (term.paulis[q] == 'Z' || term.paulis[q] == 'Y')
+                z |= std::uint64_t(1) << q;
+            n_y += term.paulis[q] == 'Y';
+        }
+        static const std::complex<double> powers_of_i[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+        const std::complex<double> factor = term.coeff * powers_of_i[n_y % 4];
+
+        parallel_for_each_index(n_chunks, [&](std::size_t c) {
+            for (std::size_t i = c * CHUNK; i < std::min(size, (c + 1) * CHUNK); i++)
+                out[i ^ x] += (std::popcount(i & z) & 1 ? -factor : factor) * state[i];
+        });
+    }
+}
+
+} // End of optimization namespace
+} // End of cunqa namespace
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <optional>
+
+#include "diagonal_cost.hpp"
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+// Cost of a variational run, a real linear combination of Pauli strings:
+//
+//     {"pauli": [["XZI", 0.5], ["IIZ", -1.0], ...]}
+//
+// with the labels of qiskit (the leftmost character acts on the highest
+// qubit), or a diagonal cost over the measured bitstrings given as products
+// of Z on sets of qubits,
+//
+//     {"diagonal": [{"qubits": [0, 1], "coeff": 1.0}, {"qubits": [], "coeff": 2.0}]}
+//
+// or any "ising", "maxcut" or "polynomial" cost of the run config (see
+// diagonal_cost.hpp, without "cvar"), evaluated on every measured bitstring.
+//
+// The terms are grouped greedily into qubit-wise commuting sets, each one
+// measured by one circuit: the unitary part of the ansatz followed by the
+// basis changes of the set and a measurement of every qubit, qubit q into
+// clbit q. A diagonal cost needs a single circuit.
+class Observable
+{
+public:
+    Observable(const JSON& definition, std::size_t n_qubits);
+
+    std::size_t n_groups() const { return groups_.size(); }
+
+    // One circuit per group, from a static circuit whose measurements are dropped
+    std::vector<QuantumTask> measurement_tasks(const QuantumTask& ansatz) const;
+
+    // Expectation value from the results of the measurement_tasks, in order
+    double expectation(const std::vector<const JSON*>& results) const;
+
+    // out = O state, on a statevector of n_qubits (qubit 0 the least significant bit)
+    void apply(const std::complex<double>* state, std::complex<double>* out) const;
+
+private:
+    struct Term {
+        std::string paulis; // Indexed by qubit, 'I', 'X', 'Y' or 'Z'
+        double coeff;
+    };
+    struct Group {
+        std::string basis; // Indexed by qubit, 'I' where no term acts
+        std::vector<std::size_t> terms;
+    };
+
+    std::size_t n_qubits_;
+    double constant_ = 0.0;
+    std::vector<Term> terms_;
+    std::vector<Group> groups_;
+    std::optional<DiagonalCost> cost_;
+
+    void add_term_(std::string paulis, double coeff);
+};
+
+} // End of optimization namespace
+} // End of cunqa namespace
@@ -0,0 +1,368 @@
+#include <cmath>
+#include <random>
+#include <numbers>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "optimizers.hpp"
+
+#include "logger.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+namespace {
+
+using Point = std::vector<double>;
+
+double option(const JSON& optimizer, const char* key, double default_value)
+{
+    return optimizer.contains(key) ? optimizer.at(key).get<double>() : default_value;
+}
+
+// Cost evaluations, counted
+class Evaluator
+{
+public:
+    explicit Evaluator(const BatchObjective& cost) : cost_{cost} {}
+
+    std::vector<double> operator()(const std::vector<Point>& points)
+    {
+        evaluations += points.size();
+        auto values = cost_(points);
+        if (values.size() != points.size())
+            throw std::runtime_error("The cost was not evaluated at every point.");
+        return values;
+    }
+
+    double operator()(const Point& point) { return (*this)(std::vector<Point>{point})[0]; }
+
+    std::size_t evaluations = 0;
+
+private:
+    const BatchObjective& cost_;
+};
+
+Point axpy(double a, const Point& x, const Point& y)
+{
+    Point result(y);
+    for (std::size_t i = 0; i < x.size(); i++)
+        result[i] += a * x[i];
+    return result;
+}
+
+Point difference(const Point& x, const Point& y)
+{
+    return axpy(-1.0, y, x);
+}
+
+double norm(const Point& x)
+{
+    return std::sqrt(std::inner_product(x.begin(), x.end(), x.begin(), 0.0));
+}
+
+// Solves a x = b in place by Gaussian elimination with partial pivoting,
+// false if a is (numerically) singular
+bool solve(std::vector<Point>& a, Point& b)
+{
+    const std::size_t n = b.size();
+    double scale = 0.0;
+    for (const auto& row : a)
+        for (auto value : row)
+            scale = std::max(scale, std::abs(value));
+    if (scale == 0.0)
+        return n == 0;
+
+    for (std::size_t col = 0; col < n; col++) {
+        std::size_t pivot = col;
+        for (std::size_t row = col + 1; row < n; row++)
+            if (std::abs(a[row][col]) > std::abs(a[pivot][col]))
+                pivot = row;
+        if (std::abs(a[pivot][col]) < 1e-12 * scale)
+            return false;
+        std::swap(a[col], a[pivot]);
+        std::swap(b[col], b[pivot]);
+        for (std::size_t row = col + 1; row < n; row++) {
+            const double factor = a[row][col] / a[col][col];
+            for (std::size_t k = col; k < n; k++)
+                a[row][k] -= factor * a[col][k];
+            b[row] -= factor * b[col];
+        }
+    }
+    for (std::size_t col = n; col-- > 0;) {
+        for (std::size_t k = col + 1; k < n; k++)
+            b[col] -= a[col][k] * b[k];
+        b[col] /= a[col][col];
+    }
+    return true;
+}
+
+std::vector<Point> simplex_around(const Point& x, double step)
+{
+    std::vector<Point> simplex(x.size() + 1, x);
+    for (std::size_t i = 0; i < x.size(); i++)
+        simplex[i + 1][i] += step;
+    return simplex;
+}
+
+OptimizationResult spsa(const JSON& optimizer, Point x, Evaluator& evaluate, std::size_t maxiter)
+{
+    const double a = option(optimizer, "a", 0.2), c = option(optimizer, "c", 0.1);
+    const double alpha = option(optimizer, "alpha", 0.602), gamma = option(optimizer, "gamma", 0.101);
+    const double stability = 0.1 * maxiter;
+    std::mt19937_64 rng(optimizer.contains("seed") ? optimizer.at("seed").get<std::uint64_t>() : 0);
+    std::bernoulli_distribution coin(0.5);
+
+    OptimizationResult result;
+    Point delta(x.size());
+    for (std::size_t k = 0; k < maxiter; k++) {
+        const double ak = a / std::pow(k + 1 + stability, alpha);
+        const double ck = c / std::pow(k + 1, gamma);
+        for (auto& d : delta)
+            d = coin(rng) ? 1.0 : -1.0;
+
+        auto values = evaluate({axpy(ck, delta, x), axpy(-ck, delta, x)});
+        result.trajectory.push_back({k, x, 0.5 * (values[0] + values[1])});
+        for (std::size_t i = 0; i < x.size(); i++)
+            x[i] -= ak * (values[0] - values[1]) / (2.0 * ck * delta[i]);
+    }
+
+    result.cost = evaluate(x);
+    result.params = std::move(x);
+    return result;
+}
+
+OptimizationResult adam(const JSON& optimizer, Point x, Evaluator& evaluate, std::size_t maxiter)
+{
+    const double learning_rate = option(optimizer, "learning_rate", 0.05);
+    const double beta1 = option(optimizer, "beta1", 0.9), beta2 = option(optimizer, "beta2", 0.999);
+    const double tol = option(optimizer, "tol", 1e-6), epsilon = 1e-8;
+    constexpr double SHIFT = std::numbers::pi / 2.0;
+
+    OptimizationResult result;
+    Point m(x.size(), 0.0), v(x.size(), 0.0), gradient(x.size());
+    for (std::size_t k = 0; k < maxiter; k++) {
+        // The point itself for the trajectory and its two shifts per parameter
+        std::vector<Point> points = {x};
+        for (std::size_t i = 0; i < x.size(); i++) {
+            points.push_back(x);
+            points.back()[i] += SHIFT;
+            points.push_back(x);
+            points.back()[i] -= SHIFT;
+        }
+        auto values = evaluate(points);
+        result.trajectory.push_back({k, x, values[0]});
+
+        for (std::size_t i = 0; i < x.size(); i++)
+            gradient[i] = 0.5 * (values[1 + 2 * i] - values[2 + 2 * i]);
+        if (norm(gradient) < tol)
+            break;
+
+        for (std::size_t i = 0; i < x.size(); i++) {
+            m[i] = beta1 * m[i] + (1.0 - beta1) * gradient[i];
+            v[i] = beta2 * v[i] + (1.0 - beta2) * gradient[i] * gradient[i];
+            const double m_hat = m[i] / (1.0 - std::pow(beta1, k + 1));
+            const double v_hat = v[i] / (1.0 - std::pow(beta2, k + 1));
+            x[i] -= learning_rate * m_hat / (std::sqrt(v_hat) + epsilon);
+        }
+    }
+
+    result.cost = evaluate(x);
+    result.params = std::move(x);
+    return result;
+}
+
+OptimizationResult nelder_mead(const JSON& optimizer, const Point& x0, Evaluator& evaluate, std::size_t maxiter)
+{
+    const double xatol = option(optimizer, "xatol", 1e-4), fatol = option(optimizer, "fatol", 1e-4);
+    const std::size_t n = x0.size();
+
+    auto simplex = simplex_around(x0, option(optimizer, "initial_step", 0.1));
+    auto values = evaluate(simplex);
+    std::vector<std::size_t> order(n + 1);
+
+    OptimizationResult result;
+    for (std::size_t k = 0; k < maxiter; k++) {
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t i, std::size_t j) { return values[i] < values[j]; });
+        const std::size_t best = order[0], worst = order[n], second_worst = order[n > 0 ? n - 1 : 0];
+        result.trajectory.push_back({k, simplex[best], values[best]});
+
+        double x_spread = 0.0, f_spread = 0.0;
+        for (std::size_t i = 0; i <= n; i++) {
+            f_spread = std::max(f_spread, std::abs(values[i] - values[best]));
+            for (std::size_t j = 0; j < n; j++)
+                x_spread = std::max(x_spread, std::abs(simplex[i][j] - simplex[best][j]));
+        }
+        if (n == 0 || (x_spread <= xatol && f_spread <= fatol))
+            break;
+
+        Point centroid(n, 0.0);
+        for (std::size_t i = 0; i < n; i++)
+            centroid = axpy(1.0 / n, simplex[order[i]], centroid);
+        const Point away = difference(centroid, simplex[worst]);
+
+        const Point reflected = axpy(1.0, away, centroid);
+        const double f_reflected = evaluate(reflected);
+        if (f_reflected < values[best]) {
+            const Point expanded = axpy(2.0, away, centroid);
+            const double f_expanded = evaluate(expanded);
+            if (f_expanded < f_reflected) {
+                simplex[worst] = expanded;
+                values[worst] = f_expanded;
+            } else {
+                simplex[worst] = reflected;
+                values[worst] = f_reflected;
+            }
+            continue;
+        }
+        if (f_reflected < values[second_worst]) {
+            simplex[worst] = reflected;
+            values[worst] = f_reflected;
+            continue;
+        }
+
+        // Contraction outside or inside the simplex, shrinking if it fails
+        const bool outside = f_reflected < values[worst];
+        const Point contracted = axpy(outside ? 0.5 : -0.5, away, centroid);
+        const double f_contracted = evaluate(contracted);
+        if (f_contracted < (outside ? f_reflected : values[worst])) {
+            simplex[worst] = contracted;
+            values[worst] = f_contracted;
+            continue;
+        }
+        std::vector<Point> shrunk;
+        for (std::size_t i = 1; i <= n; i++)
+            shrunk.push_back(axpy(0.5, difference(simplex[order[i]], simplex[best]), simplex[best]));
+        auto f_shrunk = evaluate(shrunk);
+        for (std::size_t i = 1; i <= n; i++) {
+            simplex[order[i]] = shrunk[i - 1];
+            values[order[i]] = f_shrunk[i - 1];
+        }
+    }
+
+    const auto best = std::min_element(values.begin(), values.end()) - values.begin();
+    result.params = simplex[best];
+    result.cost = values[best];
+    return result;
+}
+
+OptimizationResult cobyla(const JSON& optimizer, const Point& x0, Evaluator& evaluate, std::size_t maxiter)
+{
+    const double rhoend = option(optimizer, "rhoend", 1e-3);
+    double rho = std::max(option(optimizer, "rhobeg", 0.5), rhoend);
+    const std::size_t n = x0.size();
+
+    auto simplex = simplex_around(x0, rho);
+    auto values = evaluate(simplex);
+
+    OptimizationResult result;
+    for (std::size_t k = 0; k < maxiter && n > 0; k++) {
+        const std::size_t best = std::min_element(values.begin(), values.end()) - values.begin();
+        const std::size_t worst = std::max_element(values.begin(), values.end()) - values.begin();
+        result.trajectory.push_back({k, simplex[best], values[best]});
+
+        // Gradient of the linear interpolation of the simplex
+        std::vector<Point> edges;
+        Point rises;
+        for (std::size_t j = 0; j <= n; j++) {
+            if (j == best)
+                continue;
+            edges.push_back(difference(simplex[j], simplex[best]));
+            rises.push_back(values[j] - values[best]);
+        }
+        Point gradient = rises;
+        if (!solve(edges, gradient)) {
+            simplex = simplex_around(simplex[best], rho);
+            values = evaluate(simplex);
+            continue;
+        }
+
+        const double gradient_norm = norm(gradient);
+        double ratio = 0.0;
+        if (gradient_norm > 0.0) {
+            const Point trial = axpy(-rho / gradient_norm, gradient, simplex[best]);
+            const double f_trial = evaluate(trial);
+            ratio = (values[best] - f_trial) / (rho * gradient_norm);
+
+            // As in Powell's method, the trial takes the place of the vertex
+            // whose replacement keeps the largest simplex: the one with the
+            // largest barycentric weight of the trial
+            std::vector<Point> transposed(n, Point(n));
+            std::vector<std::size_t> vertex;
+            for (std::size_t j = 0; j <= n; j++) {
+                if (j == best)
+                    continue;
+                for (std::size_t i = 0; i < n; i++)
+                    transposed[i][vertex.size()] = simplex[j][i] - simplex[best][i];
+                vertex.push_back(j);
+            }
+            Point weights = difference(trial, simplex[best]);
+            std::size_t replaced = worst;
+            if (solve(transposed, weights)) {
+                const auto largest = std::max_element(weights.begin(), weights.end(), [](double a, double b) { return std::abs(a) < std::abs(b); });
+                replaced = vertex[largest - weights.begin()];
+            }
+            if (f_trial < values[best] || f_trial < values[replaced]) {
+                simplex[replaced] = trial;
+                values[replaced] = f_trial;
+            }
+        }
+        if (ratio >= 0.1)
+            continue;
+
+        // The model failed: first the geometry of the simplex is restored,
+        // then the trust radius is reduced
+        std::size_t farthest = best;
+        double distance = 0.0;
+        for (std::size_t j = 0; j <= n; j++) {
+            const double d = norm(difference(simplex[j], simplex[best]));
+            if (d > distance) {
+                distance = d;
+                farthest = j;
+            }
+        }
+        if (distance > 2.0 * rho) {
+            simplex[farthest] = axpy(rho / distance, difference(simplex[farthest], simplex[best]), simplex[best]);
+            values[farthest] = evaluate(simplex[farthest]);
+            continue;
+        }
+        if (rho <= rhoend)
+            break;
+        rho = std::max(0.5 * rho, rhoend);
+    }
+
+    const auto best = std::min_element(values.begin(), values.end()) - values.begin();
+    result.params = simplex[best];
+    result.cost = values[best];
+    return result;
+}
+
+} // End of anonymous namespace
+
+OptimizationResult minimize(const JSON& optimizer, std::vector<double> x0, const BatchObjective& cost)
+{
+    const auto name = optimizer.at("name").get<std::string>();
+    const std::size_t maxiter = optimizer.contains("maxiter") ? optimizer.at("maxiter").get<std::size_t>() : 100;
+
+    Evaluator evaluate(cost);
+    OptimizationResult result;
+    if (name == "spsa")
+        result = spsa(optimizer, std::move(x0), evaluate, maxiter);
+    else if (name == "adam")
+        result = adam(optimizer, std::move(x0), evaluate, maxiter);
+    else if (name == "nelder_mead")
+        result = nelder_mead(optimizer, x0, evaluate, maxiter);
+    else if (name == "cobyla")
+        result = cobyla(optimizer, x0, evaluate, maxiter);
+    else
+        throw std::invalid_argument("Unknown optimizer " + name + ", use spsa, cobyla, nelder_mead or adam.");
+
+    result.evaluations = evaluate.evaluations;
+    LOGGER_DEBUG("Optimization with {} finished after {} iterations and {} cost evaluations.", name, result.trajectory.size(), result.evaluations);
+    return result;
+}
+
+} // End of optimization namespace
+} // End of cunqa namespace
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+// Cost at several points at once, so that all the circuits of an iteration
+// (a simplex, the two SPSA perturbations, the parameter shifts) are simulated
+// as one batch
+using BatchObjective = std::function<std::vector<double>(const std::vector<std::vector<double>>&)>;
+
+struct Step {
+    std::size_t iteration;
+    std::vector<double> params;
+    double cost;
+};
+
+struct OptimizationResult {
+    std::vector<double> params;
+    double cost;
+    std::vector<Step> trajectory;
+    std::size_t evaluations = 0; // Points at which the cost was evaluated
+};
+
+// Minimizes the cost from x0 with the optimizer described by
+//
+//     {"name": "spsa" | "cobyla" | "nelder_mead" | "adam", "maxiter": 100, ...}
+//
+// and its options:
+//   spsa:         a (0.2), c (0.1), alpha (0.602), gamma (0.101), seed
+//   cobyla:       rhobeg (0.5), rhoend (1e-3)
+//   nelder_mead:  initial_step (0.1), xatol (1e-4), fatol (1e-4)
+//   adam:         learning_rate (0.05), beta1 (0.9), beta2 (0.999), tol (1e-6),
+//                 gradients by the parameter shift rule, exact when every
+//                 parameter is the angle of a rx, ry, rz or u gate
+//
+// COBYLA is the linear-model trust region of Powell's method without
+// constraints: the gradient of the linear interpolation of a simplex gives
+// the step, of length the trust radius, and the radius shrinks from rhobeg
+// to rhoend when the model stops predicting decreases.
+OptimizationResult minimize(const JSON& optimizer, std::vector<double> x0, const BatchObjective& cost);
+
+} // End of optimization namespace
+} // End of cunqa namespace
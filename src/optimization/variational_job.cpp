@@ -0,0 +1,73 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "variational_job.hpp"
+#include "observable.hpp"
+#include "optimizers.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+
+#include "logger.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+JSON optimize(const QuantumTask& ansatz, const JSON& request, const BatchExecutor& execute)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const Observable observable(request.at("observable"), ansatz.config.at("num_qubits").get<std::size_t>());
+    const auto x0 = request.contains("initial_params") ? request.at("initial_params").get<std::vector<double>>() : ansatz.params();
+    if (x0.size() != ansatz.params().size())
+        throw std::invalid_argument("initial_params has " + std::to_string(x0.size()) + " values but the circuit has " + std::to_string(ansatz.params().size()) + " parameters.");
+    const std::uint64_t seed = ansatz.config.contains("seed") ? ansatz.config.at("seed").get<std::uint64_t>() : 0;
+
+    std::size_t batches = 0, circuits = 0;
+    BatchObjective cost = [&](const std::vector<std::vector<double>>& points) {
+        if (points.empty())
+            return std::vector<double>{};
+        Hasher64 hasher(seed);
+        hasher.add(static_cast<std::uint64_t>(batches++));
+        const std::uint64_t batch_seed = hasher.digest() & 0x7fffffff;
+
+        std::vector<QuantumTask> tasks;
+        for (const auto& point : points) {
+            QuantumTask task = ansatz;
+            task.update_circuit(JSON{{"params", point}});
+            task.config["seed"] = batch_seed;
+            for (auto& measurement : observable.measurement_tasks(task))
+                tasks.push_back(std::move(measurement));
+        }
+        const std::size_t per_point = tasks.size() / points.size();
+        circuits += tasks.size();
+
+        auto results = execute(std::move(tasks));
+        std::vector<double> values;
+        for (std::size_t p = 0; p < points.size(); p++) {
+            std::vector<const JSON*> point_results;
+            for (std::size_t g = 0; g < per_point; g++)
+                point_results.push_back(&results.at(p * per_point + g));
+            values.push_back(observable.expectation(point_results));
+        }
+        return values;
+    };
+
+    auto result = minimize(request.at("optimizer"), x0, cost);
+
+    JSON trajectory = JSON::array();
+    for (const auto& step : result.trajectory)
+        trajectory.push_back({{"iteration", step.iteration}, {"params", step.params}, {"cost", step.cost}});
+
+    return {
+        {"params", result.params},
+        {"cost", result.cost},
+        {"trajectory", trajectory},
+        {"evaluations", result.evaluations},
+        {"circuits", circuits},
+        {"time_taken", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()}
+    };
+}
+
+} // End of optimization namespace
+} // End of cunqa namespace
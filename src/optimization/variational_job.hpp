@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace optimization {
+
+// Results of circuits executed together, in order
+using BatchExecutor = std::function<std::vector<JSON>(std::vector<QuantumTask>&&)>;
+
+// Whole optimization loop of a variational algorithm run at the QPU on a
+// parametric circuit, so that only the outcome travels back to the client:
+//
+//     {"observable": {...}, "optimizer": {...}, "initial_params": [...]}
+//
+// The observable and the optimizer are described in observable.hpp and
+// optimizers.hpp; without initial_params the current ones of the circuit are
+// the start. The cost of a point is the expectation value of the observable
+// estimated with the shots of the circuit's config. The points the optimizer
+// asks for together run as one batch of circuits, with a seed derived from
+// the one of the config and the number of batches run, so no two batches
+// reuse the same shots. Returns {"params", "cost", "trajectory":
+// [{"iteration", "params", "cost"}], "evaluations", "circuits", "time_taken"}.
+JSON optimize(const QuantumTask& ansatz, const JSON& request, const BatchExecutor& execute);
+
+} // End of optimization namespace
+} // End of cunqa namespace
@@ -1,8 +1,17 @@
 #include <string>
+#include <algorithm>
+#include <optional>
 #include <iostream>
 
 #include "utils/constants.hpp"
+#include "utils/helpers/binary_result.hpp"
+#include "utils/helpers/saved_state.hpp"
 #include "qpu.hpp"
+#include "transpiler/deferred_measurement.hpp"
+#include "transpiler/light_cone.hpp"
+#include "optimization/variational_job.hpp"
+#include "optimization/diagonal_cost.hpp"
+#include "optimization/adjoint_gradient.hpp"
 #include "logger.hpp"
 
 using namespace std::string_literals;
@@ -45,9 +54,25 @@ void QPU::compute_result_()
                 message_queue_.pop();
                 lock.unlock();
                 
-                quantum_task_.update_circuit(message);
-                auto result = backend->execute(quantum_task_);
-                server->send_result(result.dump());
+                auto message_json = message == "" ? JSON() : JSON::parse(message);
+                JSON result;
+                if (message_json.contains("batch")) {
+                    result = execute_batch_(message_json.at("batch"));
+                } else if (message_json.contains("handle")) {
+                    result = run_registered_(message_json);
+                } else if (message_json.contains("register") && message_json.at("register").get<bool>()) {
+                    QuantumTask quantum_task;
+                    quantum_task.update_circuit(message_json);
+                    if (quantum_task.circuit.empty())
+                        throw std::runtime_error("Registration without instructions and config.");
+                    auto client = message_json.contains("client") ? message_json.at("client").get<std::string>() : ""s;
+                    const auto num_params = quantum_task.params().size();
+                    result = {{"handle", circuit_store_.add(client, std::move(quantum_task))}, {"num_params", num_params}};
+                } else {
+                    quantum_task_.update_circuit(message_json);
+                    result = execute_(quantum_task_);
+                }
+                server->send_result(encode_result(result));
 
             } catch(const comm::ServerException& e) {
                 LOGGER_ERROR("There has happened an error sending the result, probably the client has had an error.");
@@ -62,6 +87,246 @@ void QPU::compute_result_()
     }
 }
 
+namespace {
+
+void add_task_info(JSON& result, const QuantumTask& quantum_task, const JSON& transpilation, const JSON& rewrites = JSON())
+{
+    if (!result.is_object() || result.contains("ERROR"))
+        return;
+    result["circuit_hash"] = {
+        {"structure", hash_to_hex(quantum_task.hash.structure)},
+        {"params", hash_to_hex(quantum_task.hash.params)}
+    };
+    if (!transpilation.is_null())
+        result["transpilation"] = transpilation;
+    if (rewrites.is_object())
+        for (const auto& [key, info] : rewrites.items())
+            result[key] = info;
+}
+
+bool noisy(const JSON& backend_config)
+{
+    return backend_config.contains("noise_model") && !backend_config.at("noise_model").empty();
+}
+
+bool exact_cost_requested(const JSON& config)
+{
+    return optimization::cost_requested(config) && optimization::DiagonalCost(config.at("cost")).exact();
+}
+
+// Dynamic circuits with local feed-forward run once as static ones (see
+// deferred_measurement.hpp) when the ancillas fit in the qubits of the QPU and
+// in a dense statevector. Noisy QPUs keep the per-shot simulation, as their
+// readout errors hit the mid-circuit measurements, and so do the runs that
+// save the state or are routed onto the coupling map.
+std::optional<transpiler::DeferredTask> deferred_task(const QuantumTask& quantum_task, const JSON& backend_config)
+{
+    if (!quantum_task.is_dynamic || !transpiler::deferral_allowed(quantum_task.config)
+        || transpiler::transpile_requested(quantum_task.config) || !saved_state_type(quantum_task.config).empty()
+        || noisy(backend_config))
+        return std::nullopt;
+
+    std::size_t max_qubits = constants::MAX_DENSE_QUBITS;
+    if (backend_config.contains("n_qubits"))
+        max_qubits = std::min(max_qubits, backend_config.at("n_qubits").get<std::size_t>());
+    return transpiler::defer_measurements(quantum_task, max_qubits);
+}
+
+// Work outside the light cone of the outcomes is dropped (see light_cone.hpp),
+// unless the run needs every qubit: a saved state, an exact cost or the
+// routing onto the coupling map. Noise models address the qubits by their
+// index, which the pruning changes.
+std::optional<transpiler::PrunedTask> pruned_task(const QuantumTask& quantum_task, const JSON& backend_config)
+{
+    if (!transpiler::pruning_allowed(quantum_task.config) || transpiler::transpile_requested(quantum_task.config)
+        || !saved_state_type(quantum_task.config).empty() || exact_cost_requested(quantum_task.config) || noisy(backend_config))
+        return std::nullopt;
+    return transpiler::prune_light_cone(quantum_task);
+}
+
+// The task as the simulator gets it, if any rewrite applies, with what each
+// rewrite did in rewrites
+std::optional<QuantumTask> rewritten_task(const QuantumTask& quantum_task, const JSON& backend_config, JSON& rewrites)
+{
+    std::optional<QuantumTask> rewritten;
+    if (auto deferred = deferred_task(quantum_task, backend_config)) {
+        rewritten = std::move(deferred->quantum_task);
+        rewrites["deferred_measurement"] = std::move(deferred->info);
+    }
+    if (auto pruned = pruned_task(rewritten ? *rewritten : quantum_task, backend_config)) {
+        rewritten = std::move(pruned->quantum_task);
+        rewrites["light_cone"] = std::move(pruned->info);
+    }
+    return rewritten;
+}
+
+// An exact cost is evaluated on the final statevector, which a copy of the
+// task is asked to save
+std::optional<QuantumTask> cost_state_task(const QuantumTask& quantum_task)
+{
+    if (!exact_cost_requested(quantum_task.config))
+        return std::nullopt;
+    if (transpiler::transpile_requested(quantum_task.config))
+        throw std::runtime_error("Exact costs are evaluated on the qubits of the circuit, they cannot be combined with transpile.");
+
+    QuantumTask with_state = quantum_task;
+    with_state.config["save_state"] = "statevector";
+    with_state.config.erase("save_state_compression");
+    return with_state;
+}
+
+void evaluate_cost(JSON& result, const QuantumTask& quantum_task)
+{
+    if (optimization::cost_requested(quantum_task.config))
+        optimization::DiagonalCost(quantum_task.config.at("cost")).evaluate(result);
+}
+
+} // End of anonymous namespace
+
+JSON QPU::execute_(const QuantumTask& quantum_task)
+{
+    // Gradients come from the exact statevector, independent of the simulator
+    if (optimization::gradient_requested(quantum_task.config)) {
+        if (noisy(backend->config))
+            throw std::runtime_error("Gradients are computed on the noiseless statevector, the QPU has a noise model.");
+        JSON result = optimization::adjoint_gradient(quantum_task);
+        add_task_info(result, quantum_task, JSON());
+        return result;
+    }
+
+    JSON rewrites;
+    const auto rewritten = rewritten_task(quantum_task, backend->config, rewrites);
+    const QuantumTask& task = rewritten ? *rewritten : quantum_task;
+    const auto with_state = cost_state_task(task);
+    JSON result;
+    JSON transpilation;
+    if (with_state) {
+        result = backend->execute(*with_state);
+    } else if (transpiler::transpile_requested(task.config)) {
+        if (!transpiler_)
+            transpiler_ = std::make_unique<transpiler::Transpiler>(backend->config);
+        auto transpiled = transpiler_->transpile(task);
+        result = backend->execute(transpiled.quantum_task);
+        transpilation = std::move(transpiled.info);
+    } else {
+        result = backend->execute(task);
+    }
+
+    evaluate_cost(result, quantum_task);
+    add_task_info(result, quantum_task, transpilation, rewrites);
+    return result;
+}
+
+// Independent circuits sent in one message, executed together so that the
+// simulator can share work among them. An entry can also be a registered
+// circuit ({"handle", "params", "shots", "seed"}), whose params only apply to
+// this batch.
+JSON QPU::execute_batch_(const JSON& batch)
+{
+    std::vector<QuantumTask> quantum_tasks(batch.size());
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        if (batch[i].contains("handle")) {
+            auto handle = batch[i].at("handle").get<std::string>();
+            auto registered = circuit_store_.find(handle, batch[i].value("client", ""s));
+            if (!registered)
+                throw std::runtime_error("Circuit handle " + handle + " is not registered by this client, it was released or evicted: register the circuit again.");
+            quantum_tasks[i] = *registered;
+            if (batch[i].contains("params"))
+                quantum_tasks[i].update_circuit(JSON{{"params", batch[i].at("params")}});
+            for (const auto* key : {"shots", "seed"})
+                if (batch[i].contains(key))
+                    quantum_tasks[i].config[key] = batch[i].at(key);
+        } else {
+            quantum_tasks[i].update_circuit(batch[i]);
+        }
+        if (quantum_tasks[i].circuit.empty())
+            throw std::runtime_error("Every circuit of a batch needs its instructions and config.");
+        if (quantum_tasks[i].has_cc)
+            throw std::runtime_error("Distributed circuits cannot be sent in a batch.");
+        if (optimization::gradient_requested(quantum_tasks[i].config))
+            throw std::runtime_error("Gradients cannot be computed in a batch, run each circuit on its own.");
+    }
+
+    return execute_tasks_(quantum_tasks);
+}
+
+JSON QPU::execute_tasks_(const std::vector<QuantumTask>& quantum_tasks)
+{
+    std::vector<QuantumTask> to_execute;
+    std::vector<JSON> transpilations(quantum_tasks.size()), rewrites(quantum_tasks.size());
+    for (std::size_t i = 0; i < quantum_tasks.size(); i++) {
+        auto rewritten = rewritten_task(quantum_tasks[i], backend->config, rewrites[i]);
+        const QuantumTask& task = rewritten ? *rewritten : quantum_tasks[i];
+        // In the order of execute_, so that an exact cost with transpile fails here too
+        if (auto with_state = cost_state_task(task)) {
+            to_execute.push_back(std::move(*with_state));
+        } else if (transpiler::transpile_requested(task.config)) {
+            if (!transpiler_)
+                transpiler_ = std::make_unique<transpiler::Transpiler>(backend->config);
+            auto transpiled = transpiler_->transpile(task);
+            to_execute.push_back(std::move(transpiled.quantum_task));
+            transpilations[i] = std::move(transpiled.info);
+        } else {
+            to_execute.push_back(task);
+        }
+    }
+
+    JSON result = backend->execute_batch(to_execute);
+    if (result.contains("results")) {
+        for (std::size_t i = 0; i < quantum_tasks.size(); i++) {
+            evaluate_cost(result.at("results")[i], quantum_tasks[i]);
+            add_task_info(result.at("results")[i], quantum_tasks[i], transpilations[i], rewrites[i]);
+        }
+    }
+    return result;
+}
+
+JSON QPU::run_registered_(const JSON& message)
+{
+    auto handle = message.at("handle").get<std::string>();
+    auto client = message.value("client", ""s);
+    if (message.contains("release") && message.at("release").get<bool>())
+        return {{"released", circuit_store_.release(handle, client)}};
+
+    auto quantum_task = circuit_store_.find(handle, client);
+    if (!quantum_task) {
+        LOGGER_ERROR("Circuit handle {} is not registered by this client, it was released or evicted.", handle);
+        return {{"ERROR", "Circuit handle " + handle + " is not registered by this client, it was released or evicted: register the circuit again."}};
+    }
+
+    // New parameters stay, as with a plain parameter update, while shots,
+    // seed and gradient only apply to this run
+    if (message.contains("params"))
+        quantum_task->update_circuit(JSON{{"params", message.at("params")}});
+
+    JSON config = quantum_task->config;
+    for (const auto* key : {"shots", "seed", "gradient"})
+        if (message.contains(key))
+            quantum_task->config[key] = message.at(key);
+
+    JSON result;
+    try {
+        if (message.contains("optimize")) {
+            // The circuits of each step of the optimizer run as one batch
+            result = optimization::optimize(*quantum_task, message.at("optimize"), [this](std::vector<QuantumTask>&& quantum_tasks) {
+                JSON batch_result = execute_tasks_(quantum_tasks);
+                if (!batch_result.contains("results"))
+                    throw std::runtime_error(batch_result.contains("ERROR") ? batch_result.at("ERROR").get<std::string>() : "Batch without results.");
+                return batch_result.at("results").get<std::vector<JSON>>();
+            });
+            // The optimum stays, as new parameters do
+            quantum_task->update_circuit(JSON{{"params", result.at("params")}});
+        } else {
+            result = execute_(*quantum_task);
+        }
+    } catch (...) {
+        quantum_task->config = std::move(config);
+        throw;
+    }
+    quantum_task->config = std::move(config);
+    return result;
+}
+
 void QPU::recv_data_() 
 {   
     server->accept();
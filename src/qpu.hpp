@@ -8,7 +8,10 @@
 
 #include "comm/server.hpp"
 #include "backends/backend.hpp"
+#include "transpiler/transpiler.hpp"
+#include "circuit_store.hpp"
 #include "utils/json.hpp"
+#include "utils/helpers/slurm_env.hpp"
 
 using namespace std::string_literals;
 
@@ -28,8 +31,14 @@ private:
     std::mutex queue_mutex_;
     std::string family_;
     std::string name_;
+    std::unique_ptr<transpiler::Transpiler> transpiler_; // Built on the first task that asks for it
+    CircuitStore circuit_store_;
 
     void compute_result_();
+    JSON execute_(const QuantumTask& quantum_task);
+    JSON execute_batch_(const JSON& batch);
+    JSON execute_tasks_(const std::vector<QuantumTask>& quantum_tasks);
+    JSON run_registered_(const JSON& message);
     void recv_data_();
     
     friend void to_json(JSON& j, const QPU& obj) {
@@ -40,7 +49,7 @@ private:
             {"net", server_json},
             {"name", obj.name_},
             {"family", obj.family_},
-            {"slurm_job_id", std::getenv("SLURM_JOB_ID")}
+            {"slurm_job_id", get_job_id()}
         };
     }
 };
@@ -36,7 +36,11 @@ QuantumTask::QuantumTask(const std::string& quantum_task) { update_circuit(quant
 
 void QuantumTask::update_circuit(const std::string& quantum_task) 
 {
-    auto quantum_task_json = quantum_task == "" ? JSON() : JSON::parse(quantum_task);
+    update_circuit(quantum_task == "" ? JSON() : JSON::parse(quantum_task));
+}
+
+void QuantumTask::update_circuit(const JSON& quantum_task_json) 
+{
     std::vector<std::string> no_communications = {};
 
     if (quantum_task_json.contains("instructions") && quantum_task_json.contains("config")) {
@@ -46,6 +50,8 @@ void QuantumTask::update_circuit(const std::string& quantum_task)
         is_dynamic = ((quantum_task_json.contains("is_dynamic")) ? quantum_task_json.at("is_dynamic").get<bool>() : false);
         has_cc = ((quantum_task_json.contains("has_cc")) ? quantum_task_json.at("has_cc").get<bool>() : false);
         id = quantum_task_json.at("id");
+        // Before the communication endpoints replace the QPU ids
+        hash = hash_circuit(circuit, config);
 
         if (has_cc) {
             std::ifstream communications_file(constants::COMM_FILEPATH); 
@@ -76,6 +82,52 @@ void QuantumTask::update_circuit(const std::string& quantum_task)
         update_params_(quantum_task_json.at("params"));
 }
 
+
+namespace {
+
+// Leading params of the instruction that update_circuit changes
+std::size_t n_variational_params(const JSON& instruction)
+{
+    switch(cunqa::constants::INSTRUCTIONS_MAP.at(instruction.at("name").get<std::string>())){
+        case cunqa::constants::RX:
+        case cunqa::constants::RY:
+        case cunqa::constants::RZ:
+            return 1;
+        case cunqa::constants::R:
+            return 2;
+        case cunqa::constants::U:
+        case cunqa::constants::CU:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+} // End of anonymous namespace
+
+std::vector<double> QuantumTask::params() const
+{
+    std::vector<double> params;
+    for (const auto& instruction : circuit) {
+        const auto n_params = n_variational_params(instruction);
+        for (std::size_t i = 0; i < n_params; i++)
+            params.push_back(instruction.at("params")[i].get<double>());
+    }
+    return params;
+}
+
+std::uint64_t QuantumTask::fixed_params_hash() const
+{
+    Hasher64 hasher;
+    for (const auto& instruction : circuit) {
+        if (!instruction.contains("params"))
+            continue;
+        const auto& params = instruction.at("params");
+        for (std::size_t i = n_variational_params(instruction); i < params.size(); i++)
+            detail::hash_param(params[i], hasher);
+    }
+    return hasher.digest();
+}
     
 void QuantumTask::update_params_(const std::vector<double> params)
 {
@@ -118,6 +170,8 @@ void QuantumTask::update_params_(const std::vector<double> params)
         LOGGER_ERROR("Error updating parameters. (check correct size).");
         throw std::runtime_error("Error updating parameters:" + std::string(e.what())); 
     }
+
+    hash.params = hash_circuit_params(circuit);
 }
 
 } // End of cunqa namespace
\ No newline at end of file
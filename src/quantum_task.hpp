@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include "utils/json.hpp"
+#include "utils/helpers/circuit_hash.hpp"
 
 namespace cunqa {
 
@@ -14,12 +15,20 @@ public:
     bool is_dynamic = false; // C_IF gates & Classical Communications
     bool has_cc = false; // Classical Communications
     std::string id;
+    // Structure and parameter hashes of the circuit, see circuit_hash.hpp
+    CircuitHash hash;
 
     QuantumTask() = default;
     QuantumTask(const std::string& quantum_task);
     QuantumTask(const JSON& circuit, const JSON& config): circuit(circuit), config(config) {};
 
     void update_circuit(const std::string& quantum_task);
+    void update_circuit(const JSON& quantum_task_json);
+    // Current values of the parameters, in the order update_circuit takes them
+    std::vector<double> params() const;
+    // Hash of the params update_circuit does not change, as the matrices of
+    // unitary instructions
+    std::uint64_t fixed_params_hash() const;
     
 private:
     void update_params_(const std::vector<double> params);
@@ -0,0 +1,131 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "deferred_measurement.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+namespace {
+
+// Controlled versions of the gates that can be conditioned
+const std::unordered_map<std::string, std::string> CONTROLLED = {
+    {"x", "cx"}, {"y", "cy"}, {"z", "cz"}, {"rx", "crx"}, {"ry", "cry"}, {"rz", "crz"}
+};
+
+const std::unordered_set<std::string> CONTROLLED_GATES = {
+    "cx", "cy", "cz", "crx", "cry", "crz", "cu"
+};
+
+const std::unordered_set<std::string> DISTRIBUTED_INSTRUCTIONS = {
+    "measure_and_send", "recv", "qsend", "qrecv", "expose", "rcontrol"
+};
+
+// The per-shot interpreters skip the c_if_ forms, so deferring them would
+// change the counts of the circuit
+bool is_placeholder(const std::string& name)
+{
+    return name.rfind("c_if_", 0) == 0;
+}
+
+// Qubits an instruction can take out of a computational basis state. The
+// target of a conditional instruction is its last qubit.
+std::vector<std::size_t> changed_qubits(const JSON& instruction)
+{
+    const auto name = instruction.at("name").get<std::string>();
+    auto qubits = instruction.at("qubits").get<std::vector<std::size_t>>();
+    if (name == "measure")
+        return {};
+    if (instruction.contains("conditional_reg"))
+        return {qubits.back()};
+    if (CONTROLLED_GATES.contains(name) && qubits.size() == 2)
+        return {qubits[1]};
+    return qubits;
+}
+
+} // End of anonymous namespace
+
+std::optional<DeferredTask> defer_measurements(const QuantumTask& quantum_task, std::size_t max_qubits)
+{
+    if (!quantum_task.is_dynamic || quantum_task.has_cc)
+        return std::nullopt;
+
+    const auto& circuit = quantum_task.circuit;
+    const std::size_t n_qubits = quantum_task.config.at("num_qubits").get<std::size_t>();
+    if (n_qubits > max_qubits)
+        return std::nullopt;
+
+    // Last instruction that changes each qubit, a measurement after it can
+    // wait until the end
+    std::vector<std::ptrdiff_t> last_change(n_qubits, -1);
+    for (std::size_t i = 0; i < circuit.size(); i++) {
+        const auto& instruction = circuit[i];
+        const auto name = instruction.at("name").get<std::string>();
+        if (DISTRIBUTED_INSTRUCTIONS.contains(name) || instruction.contains("remote_conditional_reg") || is_placeholder(name))
+            return std::nullopt;
+        if (instruction.contains("conditional_reg")
+            && (instruction.at("conditional_reg").empty() || !CONTROLLED.contains(name)))
+            return std::nullopt;
+        for (auto qubit : changed_qubits(instruction)) {
+            if (qubit >= n_qubits)
+                return std::nullopt;
+            last_change[qubit] = static_cast<std::ptrdiff_t>(i);
+        }
+    }
+
+    // Qubit that holds the outcome of each clbit measured so far
+    std::map<std::size_t, std::size_t> holders;
+    std::size_t n_total = n_qubits;
+    JSON instructions = JSON::array();
+    for (std::size_t i = 0; i < circuit.size(); i++) {
+        const auto& instruction = circuit[i];
+        const auto name = instruction.at("name").get<std::string>();
+
+        if (name == "measure") {
+            const auto qubit = instruction.at("qubits")[0].get<std::size_t>();
+            const auto clbit = instruction.at("clbits")[0].get<std::size_t>();
+            if (last_change[qubit] > static_cast<std::ptrdiff_t>(i)) {
+                const std::size_t ancilla = n_total++;
+                if (n_total > max_qubits)
+                    return std::nullopt;
+                instructions.push_back({{"name", "cx"}, {"qubits", {qubit, ancilla}}});
+                holders[clbit] = ancilla;
+            } else {
+                holders[clbit] = qubit;
+            }
+
+        } else if (instruction.contains("conditional_reg")) {
+            // A clbit never measured reads 0
+            const auto holder = holders.find(instruction.at("conditional_reg")[0].get<std::size_t>());
+            if (holder == holders.end())
+                continue;
+            JSON controlled = {
+                {"name", CONTROLLED.at(name)},
+                {"qubits", {holder->second, instruction.at("qubits").back().get<std::size_t>()}}
+            };
+            if (instruction.contains("params") && !instruction.at("params").empty())
+                controlled["params"] = instruction.at("params");
+            instructions.push_back(std::move(controlled));
+
+        } else {
+            instructions.push_back(instruction);
+        }
+    }
+
+    for (const auto& [clbit, qubit] : holders)
+        instructions.push_back({{"name", "measure"}, {"qubits", {qubit}}, {"clbits", {clbit}}});
+
+    JSON config = quantum_task.config;
+    config["num_qubits"] = n_total;
+    QuantumTask task(instructions, config);
+    task.id = quantum_task.id;
+    task.hash = hash_circuit(task.circuit, task.config);
+    return DeferredTask{std::move(task), {{"ancillas", n_total - n_qubits}}};
+}
+
+} // End of transpiler namespace
+} // End of cunqa namespace
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+// Dynamic circuits are rewritten unless the run config has
+// "defer_measurements": false
+inline bool deferral_allowed(const JSON& config)
+{
+    return !config.contains("defer_measurements") || !config.at("defer_measurements").is_boolean() || config.at("defer_measurements").get<bool>();
+}
+
+struct DeferredTask {
+    QuantumTask quantum_task;
+    JSON info; // Ancilla qubits added
+};
+
+// Deferred measurement: a dynamic circuit whose feed-forward is local becomes
+// a static one with the same distribution of outcomes, so that it is
+// simulated once and sampled instead of once per shot.
+//
+//  - A measurement of a qubit that only acts as a control or is measured
+//    afterwards is moved to the end of the circuit. Otherwise the qubit is
+//    copied with a CX onto a fresh ancilla, measured at the end instead.
+//  - A gate conditioned on a clbit becomes the gate controlled by the qubit
+//    that holds the clbit (x, y, z, rx, ry and rz), and is dropped if the
+//    clbit was never measured.
+//
+// Returns nullopt if the task is not dynamic, has classical communications,
+// c_if_ instructions (which the per-shot interpreters skip) or conditions
+// other gates, or if the ancillas take it over max_qubits.
+std::optional<DeferredTask> defer_measurements(const QuantumTask& quantum_task, std::size_t max_qubits);
+
+} // End of transpiler namespace
+} // End of cunqa namespace
@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+
+#include "light_cone.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+namespace {
+
+// Their qubits are addressed on other QPUs too
+const std::unordered_set<std::string> QUANTUM_COMMUNICATIONS = {
+    "qsend", "qrecv", "expose", "rcontrol"
+};
+
+// They write the outcomes or synchronize with other QPUs
+bool always_kept(const std::string& name)
+{
+    return name == "measure" || name == "measure_and_send" || name == "recv";
+}
+
+} // End of anonymous namespace
+
+std::optional<PrunedTask> prune_light_cone(const QuantumTask& quantum_task)
+{
+    const auto& circuit = quantum_task.circuit;
+    const std::size_t n_qubits = quantum_task.config.at("num_qubits").get<std::size_t>();
+
+    std::vector<bool> in_cone(n_qubits, false), kept(circuit.size(), false);
+    std::size_t n_kept = 0;
+    for (std::size_t i = circuit.size(); i-- > 0;) {
+        const auto& instruction = circuit[i];
+        const auto name = instruction.at("name").get<std::string>();
+        if (QUANTUM_COMMUNICATIONS.contains(name))
+            return std::nullopt;
+
+        const auto qubits = instruction.at("qubits").get<std::vector<std::size_t>>();
+        if (std::any_of(qubits.begin(), qubits.end(), [&](std::size_t q) { return q >= n_qubits; }))
+            return std::nullopt;
+        if (!always_kept(name) && std::none_of(qubits.begin(), qubits.end(), [&](std::size_t q) { return in_cone[q]; }))
+            continue;
+
+        kept[i] = true;
+        n_kept++;
+        for (auto qubit : qubits)
+            in_cone[qubit] = true;
+    }
+
+    std::vector<std::size_t> new_index(n_qubits);
+    std::vector<std::size_t> qubits_kept;
+    for (std::size_t q = 0; q < n_qubits; q++) {
+        if (in_cone[q]) {
+            new_index[q] = qubits_kept.size();
+            qubits_kept.push_back(q);
+        }
+    }
+    if (n_kept == 0 || (n_kept == circuit.size() && qubits_kept.size() == n_qubits))
+        return std::nullopt;
+
+    JSON instructions = JSON::array();
+    for (std::size_t i = 0; i < circuit.size(); i++) {
+        if (!kept[i])
+            continue;
+        JSON instruction = circuit[i];
+        for (auto& qubit : instruction.at("qubits"))
+            qubit = new_index[qubit.get<std::size_t>()];
+        instructions.push_back(std::move(instruction));
+    }
+
+    JSON config = quantum_task.config;
+    config["num_qubits"] = qubits_kept.size();
+    QuantumTask task(instructions, config);
+    task.sending_to = quantum_task.sending_to;
+    task.is_dynamic = quantum_task.is_dynamic;
+    task.has_cc = quantum_task.has_cc;
+    task.id = quantum_task.id;
+    task.hash = hash_circuit(task.circuit, task.config);
+
+    JSON info = {
+        {"qubits", qubits_kept},
+        {"removed_instructions", circuit.size() - n_kept}
+    };
+    return PrunedTask{std::move(task), std::move(info)};
+}
+
+} // End of transpiler namespace
+} // End of cunqa namespace
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+
+#include "quantum_task.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+// Circuits are pruned unless the run config has "prune_light_cone": false
+inline bool pruning_allowed(const JSON& config)
+{
+    return !config.contains("prune_light_cone") || !config.at("prune_light_cone").is_boolean() || config.at("prune_light_cone").get<bool>();
+}
+
+struct PrunedTask {
+    QuantumTask quantum_task;
+    JSON info; // Qubits kept, in their new order, and instructions removed
+};
+
+// Backward light cone of the outcomes: sweeping the circuit from the end, an
+// instruction is kept if it is a measure, measure_and_send or recv, or if it
+// acts on a qubit that a kept instruction after it depends on, and its qubits
+// then join the cone. Conditional gates need nothing else, as every
+// measurement that writes a clbit is kept. The qubits left out of the cone are
+// removed and the rest renumbered in their order, so the cost of the
+// simulation falls exponentially with them.
+//
+// Returns nullopt if nothing is pruned, if no instruction is kept or if the
+// task teleports qubits to or from other QPUs.
+std::optional<PrunedTask> prune_light_cone(const QuantumTask& quantum_task);
+
+} // End of transpiler namespace
+} // End of cunqa namespace
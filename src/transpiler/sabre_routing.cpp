@@ -0,0 +1,309 @@
+#include <queue>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "sabre_routing.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+namespace {
+
+// Lookahead of the SWAP score, as in the SABRE paper
+constexpr std::size_t EXTENDED_SET_SIZE = 20;
+constexpr double EXTENDED_SET_WEIGHT = 0.5;
+constexpr double DECAY_INCREMENT = 0.001;
+
+struct Dag {
+    std::vector<std::vector<int>> successors;
+    std::vector<int> n_predecessors;
+};
+
+// Edges through qubit and classical bit wires
+Dag build_dag(const std::vector<RoutingGate>& gates, int n_logical, int n_clbits)
+{
+    Dag dag{std::vector<std::vector<int>>(gates.size()), std::vector<int>(gates.size(), 0)};
+    std::vector<int> last(n_logical + n_clbits, -1);
+
+    auto depend = [&](int wire, int g) {
+        const int previous = last[wire];
+        if (previous >= 0 && (dag.successors[previous].empty() || dag.successors[previous].back() != g)) {
+            dag.successors[previous].push_back(g);
+            ++dag.n_predecessors[g];
+        }
+        last[wire] = g;
+    };
+
+    for (int g = 0; g < static_cast<int>(gates.size()); ++g) {
+        for (int i = 0; i < gates[g].arity; ++i)
+            depend(gates[g].qubits[i], g);
+        for (int clbit : gates[g].clbits)
+            depend(n_logical + clbit, g);
+    }
+    return dag;
+}
+
+class Layout
+{
+public:
+    Layout(const std::vector<int>& logical_to_physical, int n_physical) :
+        l2p_{logical_to_physical}, p2l_(n_physical, -1)
+    {
+        for (int l = 0; l < static_cast<int>(l2p_.size()); ++l)
+            p2l_[l2p_[l]] = l;
+    }
+
+    int physical(int logical) const { return l2p_[logical]; }
+    const std::vector<int>& logical_to_physical() const { return l2p_; }
+
+    void swap(int a, int b)
+    {
+        std::swap(p2l_[a], p2l_[b]);
+        if (p2l_[a] >= 0) l2p_[p2l_[a]] = a;
+        if (p2l_[b] >= 0) l2p_[p2l_[b]] = b;
+    }
+
+private:
+    std::vector<int> l2p_, p2l_;
+};
+
+struct PassResult {
+    std::vector<RoutedStep> steps;
+    std::vector<int> final_layout;
+    std::size_t n_swaps = 0;
+};
+
+PassResult sabre_pass(const std::vector<RoutingGate>& gates, const Dag& dag, const CouplingGraph& graph, const std::vector<int>& initial_layout)
+{
+    const int n_physical = graph.n_qubits();
+    Layout layout(initial_layout, n_physical);
+    PassResult result;
+    result.steps.reserve(gates.size());
+
+    std::vector<int> n_predecessors = dag.n_predecessors;
+    std::vector<int> front;
+    for (int g = 0; g < static_cast<int>(gates.size()); ++g)
+        if (n_predecessors[g] == 0)
+            front.push_back(g);
+
+    std::vector<double> decay(n_physical, 1.0);
+    int swaps_without_progress = 0;
+
+    auto gate_distance = [&](int g, int a, int b) {
+        // Distance of gate g if physical qubits a and b were swapped
+        auto moved = [&](int p) { return p == a ? b : (p == b ? a : p); };
+        return graph.distance(moved(layout.physical(gates[g].qubits[0])), moved(layout.physical(gates[g].qubits[1])));
+    };
+
+    auto apply_swap = [&](int a, int b) {
+        result.steps.push_back({-1, a, b});
+        layout.swap(a, b);
+        decay[a] += DECAY_INCREMENT;
+        decay[b] += DECAY_INCREMENT;
+        ++result.n_swaps;
+        ++swaps_without_progress;
+    };
+
+    while (!front.empty()) {
+        std::vector<int> next_front, executed;
+        for (int g : front) {
+            const auto& gate = gates[g];
+            if (gate.arity < 2 || graph.adjacent(layout.physical(gate.qubits[0]), layout.physical(gate.qubits[1])))
+                executed.push_back(g);
+            else
+                next_front.push_back(g);
+        }
+
+        if (!executed.empty()) {
+            for (int g : executed) {
+                const auto& gate = gates[g];
+                result.steps.push_back({g, layout.physical(gate.qubits[0]), gate.arity == 2 ? layout.physical(gate.qubits[1]) : -1});
+                for (int successor : dag.successors[g])
+                    if (--n_predecessors[successor] == 0)
+                        next_front.push_back(successor);
+            }
+            front = std::move(next_front);
+            std::fill(decay.begin(), decay.end(), 1.0);
+            swaps_without_progress = 0;
+            continue;
+        }
+
+        // The heuristic can cycle on adversarial layouts, then the first gate
+        // is walked along a shortest path
+        if (swaps_without_progress > 2 * n_physical + 10) {
+            const auto& gate = gates[front[0]];
+            int p = layout.physical(gate.qubits[0]);
+            const int target = layout.physical(gate.qubits[1]);
+            while (graph.distance(p, target) > 1) {
+                for (int neighbor : graph.neighbors(p))
+                    if (graph.distance(neighbor, target) == graph.distance(p, target) - 1) {
+                        apply_swap(p, neighbor);
+                        p = neighbor;
+                        break;
+                    }
+            }
+            continue;
+        }
+
+        // Lookahead: the next two-qubit gates after the front layer
+        std::vector<int> extended;
+        {
+            std::vector<int> pending = n_predecessors;
+            std::queue<int> to_visit;
+            for (int g : front)
+                to_visit.push(g);
+            while (!to_visit.empty() && extended.size() < EXTENDED_SET_SIZE) {
+                const int g = to_visit.front();
+                to_visit.pop();
+                for (int successor : dag.successors[g])
+                    if (--pending[successor] == 0) {
+                        if (gates[successor].arity == 2)
+                            extended.push_back(successor);
+                        to_visit.push(successor);
+                    }
+            }
+        }
+
+        std::vector<std::pair<int, int>> candidates;
+        for (int g : front)
+            for (int i = 0; i < 2; ++i) {
+                const int p = layout.physical(gates[g].qubits[i]);
+                for (int neighbor : graph.neighbors(p))
+                    candidates.emplace_back(std::min(p, neighbor), std::max(p, neighbor));
+            }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        double best_score = std::numeric_limits<double>::infinity();
+        std::pair<int, int> best = candidates.front();
+        for (const auto& [a, b] : candidates) {
+            double front_cost = 0.0, extended_cost = 0.0;
+            for (int g : front)
+                front_cost += gate_distance(g, a, b);
+            for (int g : extended)
+                extended_cost += gate_distance(g, a, b);
+            double score = front_cost / front.size();
+            if (!extended.empty())
+                score += EXTENDED_SET_WEIGHT * extended_cost / extended.size();
+            score *= std::max(decay[a], decay[b]);
+            if (score < best_score) {
+                best_score = score;
+                best = {a, b};
+            }
+        }
+        apply_swap(best.first, best.second);
+    }
+
+    result.final_layout = layout.logical_to_physical();
+    return result;
+}
+
+} // End of anonymous namespace
+
+CouplingGraph::CouplingGraph(const std::vector<std::vector<int>>& coupling_map)
+{
+    for (const auto& edge : coupling_map) {
+        if (edge.size() != 2 || edge[0] < 0 || edge[1] < 0)
+            throw std::runtime_error("Each edge of the coupling_map must be a pair of qubits.");
+        n_qubits_ = std::max({n_qubits_, edge[0] + 1, edge[1] + 1});
+    }
+
+    neighbors_.resize(n_qubits_);
+    out_edges_.resize(n_qubits_);
+    for (const auto& edge : coupling_map) {
+        if (edge[0] == edge[1])
+            continue;
+        out_edges_[edge[0]].push_back(edge[1]);
+        for (auto [a, b] : {std::pair{edge[0], edge[1]}, std::pair{edge[1], edge[0]}})
+            if (std::find(neighbors_[a].begin(), neighbors_[a].end(), b) == neighbors_[a].end())
+                neighbors_[a].push_back(b);
+    }
+
+    // All pairs shortest paths, one BFS per qubit
+    constexpr int UNREACHABLE = std::numeric_limits<int>::max() / 4;
+    distances_.assign(static_cast<std::size_t>(n_qubits_) * n_qubits_, UNREACHABLE);
+    for (int source = 0; source < n_qubits_; ++source) {
+        int* row = distances_.data() + static_cast<std::size_t>(source) * n_qubits_;
+        std::queue<int> to_visit;
+        row[source] = 0;
+        to_visit.push(source);
+        while (!to_visit.empty()) {
+            const int p = to_visit.front();
+            to_visit.pop();
+            for (int neighbor : neighbors_[p])
+                if (row[neighbor] == UNREACHABLE) {
+                    row[neighbor] = row[p] + 1;
+                    to_visit.push(neighbor);
+                }
+        }
+    }
+}
+
+bool CouplingGraph::has_edge(int a, int b) const
+{
+    return std::find(out_edges_[a].begin(), out_edges_[a].end(), b) != out_edges_[a].end();
+}
+
+Routing sabre_route(const std::vector<RoutingGate>& gates, int n_logical, int n_clbits, const CouplingGraph& graph, std::vector<int> initial_layout)
+{
+    Routing routing;
+    routing.n_gates = gates.size();
+
+    const int n_physical = graph.all_to_all() ? n_logical : graph.n_qubits();
+    if (n_logical > n_physical)
+        throw std::runtime_error("The circuit has " + std::to_string(n_logical) + " qubits but the coupling_map only " + std::to_string(n_physical) + ".");
+
+    const bool search_layout = initial_layout.empty();
+    if (search_layout) {
+        initial_layout.resize(n_logical);
+        std::iota(initial_layout.begin(), initial_layout.end(), 0);
+    } else {
+        if (static_cast<int>(initial_layout.size()) != n_logical)
+            throw std::runtime_error("initial_layout must have one physical qubit per qubit of the circuit.");
+        const int bound = graph.all_to_all() ? std::numeric_limits<int>::max() : n_physical;
+        std::unordered_set<int> used;
+        for (int p : initial_layout)
+            if (p < 0 || p >= bound || !used.insert(p).second)
+                throw std::runtime_error("initial_layout must hold distinct physical qubits of the coupling_map.");
+    }
+
+    for (const auto& gate : gates)
+        for (int i = 0; i < gate.arity; ++i)
+            if (gate.qubits[i] < 0 || gate.qubits[i] >= n_logical)
+                throw std::runtime_error("Instruction on a qubit out of the circuit.");
+
+    if (graph.all_to_all()) {
+        routing.steps.reserve(gates.size());
+        for (int g = 0; g < static_cast<int>(gates.size()); ++g)
+            routing.steps.push_back({g, initial_layout[gates[g].qubits[0]], gates[g].arity == 2 ? initial_layout[gates[g].qubits[1]] : -1});
+        routing.initial_layout = routing.final_layout = initial_layout;
+        return routing;
+    }
+
+    for (const auto& gate : gates)
+        if (gate.arity == 2 && graph.distance(initial_layout[gate.qubits[0]], initial_layout[gate.qubits[1]]) > graph.n_qubits())
+            throw std::runtime_error("The coupling_map does not connect the qubits of a two-qubit gate.");
+
+    const Dag dag = build_dag(gates, n_logical, n_clbits);
+    if (search_layout) {
+        // The final layout of the reversed circuit is a good initial layout
+        std::vector<RoutingGate> reversed(gates.rbegin(), gates.rend());
+        const Dag reversed_dag = build_dag(reversed, n_logical, n_clbits);
+        const auto forward = sabre_pass(gates, dag, graph, initial_layout);
+        const auto backward = sabre_pass(reversed, reversed_dag, graph, forward.final_layout);
+        initial_layout = backward.final_layout;
+    }
+
+    auto pass = sabre_pass(gates, dag, graph, initial_layout);
+    routing.steps = std::move(pass.steps);
+    routing.initial_layout = std::move(initial_layout);
+    routing.final_layout = std::move(pass.final_layout);
+    routing.n_swaps = pass.n_swaps;
+    return routing;
+}
+
+} // End of transpiler namespace
+} // End of cunqa namespace
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace cunqa {
+namespace transpiler {
+
+// Physical connectivity of a QPU. An empty coupling map stands for all to all
+// connectivity. Distances are hop counts over the undirected graph.
+class CouplingGraph
+{
+public:
+    explicit CouplingGraph(const std::vector<std::vector<int>>& coupling_map);
+
+    bool all_to_all() const { return n_qubits_ == 0; }
+    int n_qubits() const { return n_qubits_; }
+    bool adjacent(int a, int b) const { return distance(a, b) == 1; }
+    // True if the coupling map lists the directed edge a -> b
+    bool has_edge(int a, int b) const;
+    int distance(int a, int b) const { return distances_[a * n_qubits_ + b]; }
+    const std::vector<int>& neighbors(int p) const { return neighbors_[p]; }
+
+private:
+    int n_qubits_ = 0;
+    std::vector<std::vector<int>> neighbors_;
+    std::vector<std::vector<int>> out_edges_;
+    std::vector<int> distances_;
+};
+
+// What the router needs of an instruction: its qubits (one or two, logical)
+// and the classical bits it reads or writes, which also order instructions
+struct RoutingGate {
+    int arity = 1;
+    std::array<int, 2> qubits = {0, 0};
+    std::vector<int> clbits;
+};
+
+// Gate `gate` at physical qubits (p0, p1), or a SWAP of p0 and p1 when gate is -1
+struct RoutedStep {
+    int gate;
+    int p0, p1;
+};
+
+struct Routing {
+    std::vector<RoutedStep> steps;
+    std::vector<int> initial_layout; // Logical to physical
+    std::vector<int> final_layout;
+    std::size_t n_gates = 0;
+    std::size_t n_swaps = 0;
+};
+
+// SABRE routing (Li, Ding, Xie 2019): gates whose dependencies are done form
+// the front layer, the ones that are adjacent run, and otherwise the SWAP
+// that most reduces the distance of the front layer (plus a lookahead over
+// the next gates, with a decay that spreads SWAPs across qubits) is inserted.
+// Without an initial layout, a forward and a backward pass from the trivial
+// layout choose it first.
+Routing sabre_route(const std::vector<RoutingGate>& gates, int n_logical, int n_clbits, const CouplingGraph& graph,
+                    std::vector<int> initial_layout = {});
+
+} // End of transpiler namespace
+} // End of cunqa namespace
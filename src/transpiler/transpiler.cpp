@@ -0,0 +1,442 @@
+#include <cmath>
+#include <array>
+#include <complex>
+#include <numbers>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "transpiler.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+
+#include "logger.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+namespace {
+
+using Complex = std::complex<double>;
+using Matrix2 = std::array<Complex, 4>; // Row-major
+
+constexpr Complex I{0.0, 1.0};
+constexpr double PI = std::numbers::pi;
+constexpr double EPS = 1e-10;
+
+const Matrix2 IDENTITY = {1, 0, 0, 1};
+const Matrix2 X = {0, 1, 1, 0};
+const Matrix2 H = {M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2};
+const Matrix2 S = {1, 0, 0, I};
+const Matrix2 SDG = {1, 0, 0, -I};
+const Matrix2 SX = {Complex(0.5, 0.5), Complex(0.5, -0.5), Complex(0.5, -0.5), Complex(0.5, 0.5)};
+
+const std::unordered_set<std::string> DISTRIBUTED_INSTRUCTIONS = {
+    "measure_and_send", "recv", "qsend", "qrecv", "expose", "rcontrol"
+};
+
+Matrix2 operator*(const Matrix2& a, const Matrix2& b)
+{
+    return {a[0] * b[0] + a[1] * b[2], a[0] * b[1] + a[1] * b[3],
+            a[2] * b[0] + a[3] * b[2], a[2] * b[1] + a[3] * b[3]};
+}
+
+Matrix2 rx(double theta) { const double c = std::cos(theta / 2), s = std::sin(theta / 2); return {c, -I * s, -I * s, c}; }
+Matrix2 ry(double theta) { const double c = std::cos(theta / 2), s = std::sin(theta / 2); return {c, -s, s, c}; }
+Matrix2 rz(double theta) { return {std::exp(-I * (theta / 2)), 0, 0, std::exp(I * (theta / 2))}; }
+Matrix2 phase(double lambda) { return {1, 0, 0, std::exp(I * lambda)}; }
+
+Matrix2 u(double theta, double phi, double lambda)
+{
+    const double c = std::cos(theta / 2), s = std::sin(theta / 2);
+    return {c, -std::exp(I * lambda) * s, std::exp(I * phi) * s, std::exp(I * (phi + lambda)) * c};
+}
+
+double param(const std::vector<double>& params, std::size_t i, const std::string& name)
+{
+    if (i >= params.size())
+        throw std::runtime_error("Gate " + name + " is missing parameters.");
+    return params[i];
+}
+
+Matrix2 single_qubit_matrix(const std::string& name, const std::vector<double>& params)
+{
+    if (name == "id") return IDENTITY;
+    if (name == "x") return X;
+    if (name == "y") return {0, -I, I, 0};
+    if (name == "z") return {1, 0, 0, -1};
+    if (name == "h") return H;
+    if (name == "s") return S;
+    if (name == "sdg") return SDG;
+    if (name == "t") return phase(PI / 4);
+    if (name == "tdg") return phase(-PI / 4);
+    if (name == "sx") return SX;
+    if (name == "sxdg") return {Complex(0.5, -0.5), Complex(0.5, 0.5), Complex(0.5, 0.5), Complex(0.5, -0.5)};
+    if (name == "rx") return rx(param(params, 0, name));
+    if (name == "ry") return ry(param(params, 0, name));
+    if (name == "rz") return rz(param(params, 0, name));
+    if (name == "p" || name == "u1") return phase(param(params, 0, name));
+    if (name == "u2") return u(PI / 2, param(params, 0, name), param(params, 1, name));
+    if (name == "u" || name == "u3") return u(param(params, 0, name), param(params, 1, name), param(params, 2, name));
+    if (name == "r") {
+        // exp(-i theta/2 (cos(phi) X + sin(phi) Y))
+        const double c = std::cos(param(params, 0, name) / 2), s = std::sin(param(params, 0, name) / 2), phi = param(params, 1, name);
+        return {c, -I * std::exp(-I * phi) * s, -I * std::exp(I * phi) * s, c};
+    }
+    throw std::runtime_error("Gate " + name + " cannot be transpiled.");
+}
+
+bool is_conditional(const JSON& instruction)
+{
+    return instruction.contains("conditional_reg") || instruction.contains("remote_conditional_reg");
+}
+
+// Instructions in terms of CX and single-qubit matrices
+struct LoweredOp {
+    enum class Kind { ONE_QUBIT, CX, PASS } kind;
+    int arity;
+    std::array<int, 2> qubits;
+    Matrix2 matrix;
+    const JSON* source; // Conditions are copied from it, PASS instructions are copied whole
+};
+
+std::vector<LoweredOp> lower(const JSON& instructions)
+{
+    std::vector<LoweredOp> lowered;
+    lowered.reserve(instructions.size());
+
+    for (const auto& instruction : instructions) {
+        const auto name = instruction.at("name").get<std::string>();
+        const auto qubits = instruction.at("qubits").get<std::vector<int>>();
+        const auto params = instruction.contains("params") ? instruction.at("params").get<std::vector<double>>() : std::vector<double>{};
+
+        auto one = [&](int q, const Matrix2& m) { lowered.push_back({LoweredOp::Kind::ONE_QUBIT, 1, {q, 0}, m, &instruction}); };
+        auto cx = [&](int c, int t) { lowered.push_back({LoweredOp::Kind::CX, 2, {c, t}, IDENTITY, &instruction}); };
+
+        if (name == "barrier")
+            continue;
+        if (DISTRIBUTED_INSTRUCTIONS.contains(name))
+            throw std::runtime_error("Distributed instructions (" + name + ") cannot be transpiled.");
+        if (qubits.empty() || qubits.size() > 2 || std::any_of(qubits.begin(), qubits.end(), [](int q) { return q < 0; }))
+            throw std::runtime_error("Gate " + name + " cannot be transpiled.");
+        if (name == "measure" || name.starts_with("c_if_")) {
+            lowered.push_back({LoweredOp::Kind::PASS, static_cast<int>(qubits.size()), {qubits[0], qubits.back()}, IDENTITY, &instruction});
+            continue;
+        }
+
+        if (qubits.size() == 1) {
+            one(qubits[0], single_qubit_matrix(name, params));
+            continue;
+        }
+
+        const int a = qubits[0], b = qubits[1];
+        if (name == "cx") {
+            cx(a, b);
+        } else if (name == "cz") {
+            one(b, H); cx(a, b); one(b, H);
+        } else if (name == "cy") {
+            one(b, SDG); cx(a, b); one(b, S);
+        } else if (name == "swap") {
+            cx(a, b); cx(b, a); cx(a, b);
+        } else if (name == "crz" || name == "cry" || name == "crx") {
+            const double theta = param(params, 0, name);
+            const auto rotation = (name == "cry") ? ry : rz;
+            if (name == "crx") one(b, H);
+            one(b, rotation(theta / 2)); cx(a, b); one(b, rotation(-theta / 2)); cx(a, b);
+            if (name == "crx") one(b, H);
+        } else if (name == "cp" || name == "cu1") {
+            const double lambda = param(params, 0, name);
+            one(a, phase(lambda / 2)); cx(a, b); one(b, phase(-lambda / 2)); cx(a, b); one(b, phase(lambda / 2));
+        } else if (name == "cu") {
+            const double theta = param(params, 0, name), phi = param(params, 1, name), lambda = param(params, 2, name);
+            const double gamma = params.size() > 3 ? params[3] : 0.0;
+            one(a, phase(gamma + (lambda + phi) / 2));
+            one(b, phase((lambda - phi) / 2));
+            cx(a, b);
+            one(b, u(-theta / 2, 0, -(phi + lambda) / 2));
+            cx(a, b);
+            one(b, u(theta / 2, phi, 0));
+        } else if (name == "rzz") {
+            cx(a, b); one(b, rz(param(params, 0, name))); cx(a, b);
+        } else if (name == "ecr") {
+            one(a, S); one(b, SX); cx(a, b); one(a, X);
+        } else {
+            throw std::runtime_error("Gate " + name + " cannot be transpiled.");
+        }
+    }
+    return lowered;
+}
+
+std::vector<RoutingGate> routing_gates(const std::vector<LoweredOp>& lowered, int n_clbits)
+{
+    std::vector<RoutingGate> gates(lowered.size());
+    for (std::size_t i = 0; i < lowered.size(); ++i) {
+        gates[i].arity = lowered[i].arity;
+        gates[i].qubits = lowered[i].qubits;
+        const JSON& source = *lowered[i].source;
+        for (const auto* key : {"clbits", "conditional_reg"})
+            if (source.contains(key))
+                for (const auto& clbit : source.at(key))
+                    if (clbit.is_number_integer() && clbit.get<int>() >= 0 && clbit.get<int>() < n_clbits)
+                        gates[i].clbits.push_back(clbit.get<int>());
+    }
+    return gates;
+}
+
+double wrap_angle(double angle)
+{
+    angle = std::remainder(angle, 2 * PI);
+    return std::abs(angle) < EPS ? 0.0 : angle;
+}
+
+// u = RZ(phi) RY(theta) RZ(lambda) up to a global phase
+struct EulerAngles {
+    double theta, phi, lambda;
+};
+
+EulerAngles zyz_angles(const Matrix2& m)
+{
+    const Complex det = m[0] * m[3] - m[1] * m[2];
+    const Complex scale = 1.0 / std::sqrt(det);
+    const Complex v00 = m[0] * scale, v10 = m[2] * scale, v11 = m[3] * scale;
+
+    const double theta = 2 * std::atan2(std::abs(v10), std::abs(v00));
+    const double sum = std::abs(v11) > EPS ? 2 * std::arg(v11) : 0.0;
+    const double difference = std::abs(v10) > EPS ? 2 * std::arg(v10) : 0.0;
+    return {theta, (sum + difference) / 2, (sum - difference) / 2};
+}
+
+} // End of anonymous namespace
+
+Transpiler::Transpiler(const JSON& backend_config) :
+    graph_{backend_config.contains("coupling_map") ? backend_config.at("coupling_map").get<std::vector<std::vector<int>>>() : std::vector<std::vector<int>>{}}
+{
+    std::unordered_set<std::string> basis;
+    if (backend_config.contains("basis_gates"))
+        for (const auto& gate : backend_config.at("basis_gates"))
+            basis.insert(gate.get<std::string>());
+
+    // p and u1 are rz up to a global phase
+    for (const auto* name : {"rz", "p", "u1"})
+        if (basis.contains(name)) {
+            rz_name_ = name;
+            break;
+        }
+    for (const auto* name : {"u", "u3"})
+        if (basis.contains(name)) {
+            u_name_ = name;
+            break;
+        }
+
+    if (!rz_name_.empty() && basis.contains("ry"))
+        euler_basis_ = EulerBasis::ZYZ;
+    else if (!rz_name_.empty() && basis.contains("sx"))
+        euler_basis_ = EulerBasis::ZSX;
+    else if (!u_name_.empty())
+        euler_basis_ = EulerBasis::U;
+    else if (!rz_name_.empty() && basis.contains("rx"))
+        euler_basis_ = EulerBasis::ZXZ;
+    else
+        throw std::runtime_error("The basis_gates of the backend cannot express every single-qubit gate.");
+
+    if (basis.contains("cx"))
+        entangler_ = "cx";
+    else if (basis.contains("cz"))
+        entangler_ = "cz";
+    else
+        throw std::runtime_error("The basis_gates of the backend need cx or cz to be transpiled to.");
+}
+
+TranspiledTask Transpiler::transpile(const QuantumTask& quantum_task)
+{
+    const auto& config = quantum_task.config;
+    const int n_logical = config.at("num_qubits").get<int>();
+    const int n_clbits = config.at("num_clbits").get<int>();
+    std::vector<int> initial_layout;
+    if (config.contains("initial_layout") && !config.at("initial_layout").is_null())
+        initial_layout = config.at("initial_layout").get<std::vector<int>>();
+
+    const auto lowered = lower(quantum_task.circuit);
+
+    // Routing, from the cache if the structure was already seen
+    Hasher64 key_hasher(quantum_task.hash.structure);
+    key_hasher.add(std::uint64_t(initial_layout.size()));
+    for (int p : initial_layout)
+        key_hasher.add(static_cast<std::uint64_t>(p));
+    const auto key = key_hasher.digest();
+
+    std::shared_ptr<const Routing> routing;
+    bool cached = false;
+    if (auto it = cache_.find(key); it != cache_.end() && it->second->n_gates == lowered.size()) {
+        routing = it->second;
+        cached = true;
+    } else {
+        routing = std::make_shared<const Routing>(sabre_route(routing_gates(lowered, n_clbits), n_logical, n_clbits, graph_, initial_layout));
+        if (!cache_.contains(key)) {
+            if (cache_.size() >= CACHE_CAPACITY) {
+                cache_.erase(cache_order_.front());
+                cache_order_.pop_front();
+            }
+            cache_order_.push_back(key);
+        }
+        cache_[key] = routing;
+    }
+
+    // Emission with the current parameters. Single-qubit matrices wait in
+    // `pending` until an entangler, a measurement or a condition needs their qubit.
+    JSON circuit = JSON::array();
+    int n_physical = n_logical;
+    std::unordered_map<int, Matrix2> pending;
+
+    auto add_instruction = [&](const std::string& name, std::vector<int> qubits, std::vector<double> params, const JSON* source) {
+        for (int q : qubits)
+            n_physical = std::max(n_physical, q + 1);
+        JSON instruction = {{"name", name}, {"qubits", std::move(qubits)}};
+        if (!params.empty())
+            instruction["params"] = std::move(params);
+        if (source)
+            for (const auto* key : {"conditional_reg", "remote_conditional_reg"})
+                if (source->contains(key))
+                    instruction[key] = source->at(key);
+        circuit.push_back(std::move(instruction));
+    };
+
+    auto synthesize = [&](int p, const Matrix2& m, const JSON* source) {
+        const auto [theta, phi, lambda] = zyz_angles(m);
+        const bool diagonal = wrap_angle(theta) == 0.0;
+        auto rotation = [&](const std::string& name, double angle) {
+            if (wrap_angle(angle) != 0.0)
+                add_instruction(name, {p}, {wrap_angle(angle)}, source);
+        };
+
+        if (diagonal) {
+            const double angle = wrap_angle(phi + lambda);
+            if (angle == 0.0)
+                return;
+            if (euler_basis_ == EulerBasis::U)
+                add_instruction(u_name_, {p}, {0.0, 0.0, angle}, source);
+            else
+                add_instruction(rz_name_, {p}, {angle}, source);
+            return;
+        }
+        switch (euler_basis_) {
+            case EulerBasis::ZYZ:
+                rotation(rz_name_, lambda);
+                add_instruction("ry", {p}, {wrap_angle(theta)}, source);
+                rotation(rz_name_, phi);
+                break;
+            case EulerBasis::ZSX:
+                if (wrap_angle(theta - PI / 2) == 0.0) {
+                    rotation(rz_name_, lambda - PI / 2);
+                    add_instruction("sx", {p}, {}, source);
+                    rotation(rz_name_, phi + PI / 2);
+                } else {
+                    rotation(rz_name_, lambda);
+                    add_instruction("sx", {p}, {}, source);
+                    rotation(rz_name_, theta + PI);
+                    add_instruction("sx", {p}, {}, source);
+                    rotation(rz_name_, phi + PI);
+                }
+                break;
+            case EulerBasis::U:
+                add_instruction(u_name_, {p}, {theta, phi, lambda}, source);
+                break;
+            case EulerBasis::ZXZ:
+                rotation(rz_name_, lambda - PI / 2);
+                add_instruction("rx", {p}, {wrap_angle(theta)}, source);
+                rotation(rz_name_, phi + PI / 2);
+                break;
+        }
+    };
+
+    auto flush = [&](int p) {
+        if (auto it = pending.find(p); it != pending.end()) {
+            synthesize(p, it->second, nullptr);
+            pending.erase(it);
+        }
+    };
+
+    auto one_qubit = [&](int p, const Matrix2& m, const JSON* source) {
+        if (source && is_conditional(*source)) {
+            flush(p);
+            synthesize(p, m, source);
+            return;
+        }
+        auto [it, inserted] = pending.try_emplace(p, m);
+        if (!inserted)
+            it->second = m * it->second;
+    };
+
+    auto entangler = [&](int control, int target, const JSON* source) {
+        if (entangler_ == "cz") {
+            one_qubit(target, H, source);
+            flush(control); flush(target);
+            add_instruction("cz", {control, target}, {}, source);
+            one_qubit(target, H, source);
+            return;
+        }
+        // CX against the direction of the coupling map
+        if (!graph_.all_to_all() && !graph_.has_edge(control, target) && graph_.has_edge(target, control)) {
+            one_qubit(control, H, source); one_qubit(target, H, source);
+            flush(control); flush(target);
+            add_instruction("cx", {target, control}, {}, source);
+            one_qubit(control, H, source); one_qubit(target, H, source);
+            return;
+        }
+        flush(control); flush(target);
+        add_instruction("cx", {control, target}, {}, source);
+    };
+
+    for (const auto& step : routing->steps) {
+        if (step.gate < 0) {
+            entangler(step.p0, step.p1, nullptr);
+            entangler(step.p1, step.p0, nullptr);
+            entangler(step.p0, step.p1, nullptr);
+            continue;
+        }
+
+        const auto& op = lowered[step.gate];
+        switch (op.kind) {
+            case LoweredOp::Kind::ONE_QUBIT:
+                one_qubit(step.p0, op.matrix, op.source);
+                break;
+            case LoweredOp::Kind::CX:
+                entangler(step.p0, step.p1, op.source);
+                break;
+            case LoweredOp::Kind::PASS: {
+                flush(step.p0);
+                std::vector<int> qubits = {step.p0};
+                if (op.arity == 2) {
+                    flush(step.p1);
+                    qubits.push_back(step.p1);
+                }
+                for (int q : qubits)
+                    n_physical = std::max(n_physical, q + 1);
+                JSON instruction = *op.source;
+                instruction["qubits"] = std::move(qubits);
+                circuit.push_back(std::move(instruction));
+                break;
+            }
+        }
+    }
+    std::vector<int> remaining;
+    for (const auto& [p, m] : pending)
+        remaining.push_back(p);
+    std::sort(remaining.begin(), remaining.end());
+    for (int p : remaining)
+        flush(p);
+
+    TranspiledTask transpiled{quantum_task, {}};
+    transpiled.quantum_task.circuit = std::move(circuit);
+    transpiled.quantum_task.config["num_qubits"] = n_physical;
+    transpiled.info = {
+        {"initial_layout", routing->initial_layout},
+        {"final_layout", routing->final_layout},
+        {"swaps", routing->n_swaps},
+        {"cached", cached}
+    };
+    LOGGER_DEBUG("Circuit transpiled with {} SWAPs{}.", routing->n_swaps, cached ? " (cached routing)" : "");
+    return transpiled;
+}
+
+} // End of transpiler namespace
+} // End of cunqa namespace
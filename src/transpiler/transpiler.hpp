@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "quantum_task.hpp"
+#include "sabre_routing.hpp"
+#include "utils/json.hpp"
+
+namespace cunqa {
+namespace transpiler {
+
+// Transpilation requested in the run config ("transpile": true)
+inline bool transpile_requested(const JSON& config)
+{
+    return config.contains("transpile") && config.at("transpile").is_boolean() && config.at("transpile").get<bool>();
+}
+
+struct TranspiledTask {
+    QuantumTask quantum_task;
+    JSON info; // Layouts, SWAPs inserted and whether the routing came from the cache
+};
+
+// Native transpilation at the QPU, from the coupling_map and basis_gates of
+// its backend config:
+//
+//  1. Basis translation: every gate is lowered to CX plus single-qubit
+//     matrices, which does not depend on the parameters.
+//  2. Routing: SABRE over the coupling_map (see sabre_routing.hpp), CX on
+//     edges listed only in the other direction are flipped with H gates.
+//  3. Single-qubit resynthesis: runs of single-qubit gates between
+//     entanglers are multiplied and emitted as one Euler decomposition in
+//     the basis (ZYZ, ZSX, U or ZXZ, in this order of preference), and CX as
+//     cx or as cz between H gates.
+//
+// Routing is the expensive part and only depends on the structure of the
+// circuit, so it is cached by the structure hash of the task (and its
+// initial_layout). Circuits that only differ in their parameters, as in the
+// iterations of a variational algorithm, only redo steps 1 and 3.
+class Transpiler
+{
+public:
+    explicit Transpiler(const JSON& backend_config);
+
+    TranspiledTask transpile(const QuantumTask& quantum_task);
+
+private:
+    enum class EulerBasis { ZYZ, ZSX, U, ZXZ };
+
+    CouplingGraph graph_;
+    EulerBasis euler_basis_;
+    std::string rz_name_, u_name_, entangler_;
+
+    static constexpr std::size_t CACHE_CAPACITY = 256;
+    std::unordered_map<std::uint64_t, std::shared_ptr<const Routing>> cache_;
+    std::deque<std::uint64_t> cache_order_;
+};
+
+} // End of transpiler namespace
+} // End of cunqa namespace
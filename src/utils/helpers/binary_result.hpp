@@ -0,0 +1,272 @@
+#pragma once
+
+#include <bit>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/json.hpp"
+
+// Binary result frame. Results that carry large numeric arrays (packed
+// counts, per-shot memory, final states) are not sent as JSON text. Inside the
+// C++ code such an array is a "section": a JSON object holding the raw bytes
+// as a JSON binary value, whose subtype is the dtype code, plus its shape.
+// encode_result() turns a result with sections into the following frame:
+//
+//   [0, 8)   magic "CUNQABIN"
+//   [8, 12)  version, uint32 little-endian
+//   [12, 16) header length H, uint32 little-endian
+//   [16, 16 + H)  header: the result JSON, each section replaced by
+//                 {"__section__": {"dtype", "shape", "offset", "nbytes"}}
+//                 plus any other key of the section (e.g. "compression")
+//   ...      the section bytes, each one starting at an 8-byte aligned offset
+//
+// Offsets are relative to the start of the frame and every array is
+// little-endian, so the python client decodes them zero-copy with
+// numpy.frombuffer. Results without sections are still sent as plain JSON.
+
+namespace cunqa {
+namespace binary {
+
+static_assert(std::endian::native == std::endian::little, "The binary result frame assumes a little-endian host.");
+
+constexpr std::string_view MAGIC = "CUNQABIN";
+constexpr std::uint32_t VERSION = 1;
+
+enum class DType : std::uint8_t {
+    U8 = 1,
+    U32,
+    U64,
+    I64,
+    F32,
+    F64,
+    C64,
+    C128
+};
+
+inline std::string_view dtype_name(DType dtype)
+{
+    switch (dtype) {
+        case DType::U8:   return "<u1";
+        case DType::U32:  return "<u4";
+        case DType::U64:  return "<u8";
+        case DType::I64:  return "<i8";
+        case DType::F32:  return "<f4";
+        case DType::F64:  return "<f8";
+        case DType::C64:  return "<c8";
+        case DType::C128: return "<c16";
+    }
+    throw std::runtime_error("Unknown dtype in binary section.");
+}
+
+inline DType dtype_from_name(std::string_view name)
+{
+    for (auto dtype : {DType::U8, DType::U32, DType::U64, DType::I64, DType::F32, DType::F64, DType::C64, DType::C128})
+        if (dtype_name(dtype) == name)
+            return dtype;
+    throw std::runtime_error("Unknown dtype in binary section: " + std::string(name));
+}
+
+template<typename T> constexpr DType dtype_of();
+template<> constexpr DType dtype_of<std::uint8_t>() { return DType::U8; }
+template<> constexpr DType dtype_of<std::uint32_t>() { return DType::U32; }
+template<> constexpr DType dtype_of<std::uint64_t>() { return DType::U64; }
+template<> constexpr DType dtype_of<std::int64_t>() { return DType::I64; }
+template<> constexpr DType dtype_of<float>() { return DType::F32; }
+template<> constexpr DType dtype_of<double>() { return DType::F64; }
+template<> constexpr DType dtype_of<std::complex<float>>() { return DType::C64; }
+template<> constexpr DType dtype_of<std::complex<double>>() { return DType::C128; }
+
+// Section from already serialized bytes
+inline JSON section(std::vector<std::uint8_t>&& bytes, DType dtype, const std::vector<std::size_t>& shape)
+{
+    JSON s;
+    s["__binary__"] = JSON::binary(std::move(bytes), static_cast<std::uint8_t>(dtype));
+    s["shape"] = shape;
+    return s;
+}
+
+// Section from a contiguous array. If no shape is given, it is one-dimensional.
+template<typename T>
+JSON section(const T* data, std::size_t size, std::vector<std::size_t> shape = {})
+{
+    std::vector<std::uint8_t> bytes(size * sizeof(T));
+    if (size)
+        std::memcpy(bytes.data(), data, bytes.size());
+    if (shape.empty())
+        shape = {size};
+    return section(std::move(bytes), dtype_of<T>(), shape);
+}
+
+template<typename T>
+JSON section(const std::vector<T>& data, std::vector<std::size_t> shape = {})
+{
+    return section(data.data(), data.size(), std::move(shape));
+}
+
+inline bool is_section(const JSON& j)
+{
+    return j.is_object() && j.contains("__binary__") && j.at("__binary__").is_binary();
+}
+
+inline bool has_sections(const JSON& j)
+{
+    if (is_section(j))
+        return true;
+    if (j.is_object() || j.is_array())
+        for (const auto& value : j)
+            if ((value.is_object() || value.is_array()) && has_sections(value))
+                return true;
+    return false;
+}
+
+namespace detail {
+
+inline std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+// Builds the header and gathers the sections, with offsets relative to the
+// start of the data region (they are shifted once the header size is known).
+inline JSON build_header(const JSON& j, std::vector<const JSON::binary_t*>& sections, std::size_t& data_size)
+{
+    if (is_section(j)) {
+        const auto& bytes = j.at("__binary__").get_binary();
+        sections.push_back(&bytes);
+        JSON descriptor = {
+            {"dtype", dtype_name(static_cast<DType>(bytes.subtype()))},
+            {"shape", j.at("shape")},
+            {"offset", data_size},
+            {"nbytes", bytes.size()}
+        };
+        for (const auto& [key, value] : j.items())
+            if (key != "__binary__" && key != "shape")
+                descriptor[key] = value;
+        data_size = align8(data_size + bytes.size());
+        return {{"__section__", descriptor}};
+    }
+    if (j.is_object()) {
+        JSON out = JSON::object();
+        for (const auto& [key, value] : j.items())
+            out[key] = build_header(value, sections, data_size);
+        return out;
+    }
+    if (j.is_array()) {
+        JSON out = JSON::array();
+        for (const auto& value : j)
+            out.push_back(build_header(value, sections, data_size));
+        return out;
+    }
+    return j;
+}
+
+inline void shift_offsets(JSON& j, std::size_t shift)
+{
+    if (j.is_object() && j.contains("__section__")) {
+        auto& offset = j["__section__"]["offset"];
+        offset = offset.get<std::size_t>() + shift;
+        return;
+    }
+    if (j.is_object() || j.is_array())
+        for (auto& value : j)
+            shift_offsets(value, shift);
+}
+
+inline void restore_sections(JSON& j, std::string_view frame)
+{
+    if (j.is_object() && j.contains("__section__")) {
+        const auto& d = j.at("__section__");
+        auto offset = d.at("offset").get<std::size_t>();
+        auto nbytes = d.at("nbytes").get<std::size_t>();
+        if (offset + nbytes > frame.size())
+            throw std::runtime_error("Binary section out of the frame bounds.");
+        std::vector<std::uint8_t> bytes(frame.begin() + offset, frame.begin() + offset + nbytes);
+        JSON restored = section(std::move(bytes), dtype_from_name(d.at("dtype").get<std::string>()), d.at("shape").get<std::vector<std::size_t>>());
+        for (const auto& [key, value] : d.items())
+            if (key != "dtype" && key != "shape" && key != "offset" && key != "nbytes")
+                restored[key] = value;
+        j = std::move(restored);
+        return;
+    }
+    if (j.is_object() || j.is_array())
+        for (auto& value : j)
+            restore_sections(value, frame);
+}
+
+inline void put_u32(std::string& out, std::size_t pos, std::uint32_t value)
+{
+    std::memcpy(out.data() + pos, &value, sizeof(value));
+}
+
+} // End of detail namespace
+
+inline std::string to_wire(const JSON& result)
+{
+    std::vector<const JSON::binary_t*> sections;
+    std::size_t data_size = 0;
+    JSON header = detail::build_header(result, sections, data_size);
+
+    // The header length depends on the offsets written in it, so they are
+    // shifted by an upper bound of the header size and the gap is padded
+    std::size_t header_bound = detail::align8(16 + header.dump().size() + 24 * sections.size());
+    detail::shift_offsets(header, header_bound);
+    std::string header_str = header.dump();
+    if (16 + header_str.size() > header_bound)
+        throw std::runtime_error("Binary result header does not fit its reserved space.");
+    header_str.resize(header_bound - 16, ' ');
+
+    std::string out(header_bound + data_size, '\0');
+    std::memcpy(out.data(), MAGIC.data(), MAGIC.size());
+    detail::put_u32(out, 8, VERSION);
+    detail::put_u32(out, 12, static_cast<std::uint32_t>(header_str.size()));
+    std::memcpy(out.data() + 16, header_str.data(), header_str.size());
+
+    std::size_t offset = header_bound;
+    for (const auto* bytes : sections) {
+        if (!bytes->empty())
+            std::memcpy(out.data() + offset, bytes->data(), bytes->size());
+        offset = detail::align8(offset + bytes->size());
+    }
+    return out;
+}
+
+inline bool is_wire(std::string_view message)
+{
+    return message.size() >= 16 && message.substr(0, MAGIC.size()) == MAGIC;
+}
+
+inline JSON from_wire(std::string_view frame)
+{
+    if (!is_wire(frame))
+        throw std::runtime_error("Message is not a binary result frame.");
+
+    std::uint32_t version, header_size;
+    std::memcpy(&version, frame.data() + 8, sizeof(version));
+    std::memcpy(&header_size, frame.data() + 12, sizeof(header_size));
+    if (version != VERSION)
+        throw std::runtime_error("Unsupported binary result frame version " + std::to_string(version) + ".");
+    if (16 + std::size_t(header_size) > frame.size())
+        throw std::runtime_error("Binary result header out of the frame bounds.");
+
+    JSON result = JSON::parse(frame.substr(16, header_size));
+    detail::restore_sections(result, frame);
+    return result;
+}
+
+} // End of binary namespace
+
+// Serialization of a result to be sent: binary frame if it carries sections,
+// plain JSON otherwise.
+inline std::string encode_result(const JSON& result)
+{
+    return binary::has_sections(result) ? binary::to_wire(result) : result.dump();
+}
+
+inline JSON decode_result(std::string_view message)
+{
+    return binary::is_wire(message) ? binary::from_wire(message) : JSON::parse(message);
+}
+
+} // End of cunqa namespace
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <bit>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstdio>
+
+#include "utils/json.hpp"
+
+// Canonical identity of a decoded circuit, split in two 64-bit hashes:
+//
+//     structure: gate names, qubits, clbits, conditions, communications,
+//                number of parameters and the qubit/clbit counts of the task
+//     params:    values of the parameters, in instruction order
+//
+// Two tasks with the same structure hash are the same circuit modulo
+// parameters (the matrices of unitary instructions included, whose nested
+// arrays are hashed with their shape and real and imaginary parts), which is
+// what result, transpilation and compilation caches key on. The instruction
+// objects are walked field by field in key order (JSON objects are sorted),
+// so the hash does not depend on how the client serialized them, and -0.0
+// hashes as 0.0.
+
+namespace cunqa {
+
+// Streaming 64-bit hash with the round and avalanche of XXH64
+class Hasher64
+{
+public:
+    explicit Hasher64(std::uint64_t seed = 0) : acc_{seed + P5} {}
+
+    void add(std::uint64_t value)
+    {
+        value *= P2;
+        value = std::rotl(value, 31) * P1;
+        acc_ = std::rotl(acc_ ^ value, 27) * P1 + P4;
+        ++length_;
+    }
+
+    void add(std::string_view text)
+    {
+        add(text.size());
+        std::uint64_t word = 0;
+        std::size_t filled = 0;
+        for (unsigned char c : text) {
+            word |= std::uint64_t(c) << (8 * filled);
+            if (++filled == 8) {
+                add(word);
+                word = 0;
+                filled = 0;
+            }
+        }
+        if (filled)
+            add(word);
+    }
+
+    void add(double value)
+    {
+        add(std::bit_cast<std::uint64_t>(value == 0.0 ? 0.0 : value));
+    }
+
+    std::uint64_t digest() const
+    {
+        std::uint64_t h = acc_ + length_;
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ULL;
+    static constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr std::uint64_t P3 = 0x165667B19E3779F9ULL;
+    static constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr std::uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+    std::uint64_t acc_;
+    std::uint64_t length_ = 0;
+};
+
+struct CircuitHash {
+    std::uint64_t structure = 0;
+    std::uint64_t params = 0;
+};
+
+namespace detail {
+
+enum : std::uint64_t { TAG_NULL = 1, TAG_BOOL, TAG_INT, TAG_FLOAT, TAG_STRING, TAG_ARRAY, TAG_OBJECT, TAG_PARAMS };
+
+// Scalars as plain doubles, arrays with their size so the shape counts
+inline void hash_param(const JSON& param, Hasher64& params_hasher)
+{
+    switch (param.type()) {
+        case JSON::value_t::number_integer:
+        case JSON::value_t::number_unsigned:
+        case JSON::value_t::number_float:
+            params_hasher.add(param.get<double>());
+            break;
+        case JSON::value_t::array:
+            params_hasher.add(std::uint64_t(TAG_ARRAY));
+            params_hasher.add(std::uint64_t(param.size()));
+            for (const auto& element : param)
+                hash_param(element, params_hasher);
+            break;
+        case JSON::value_t::string:
+            params_hasher.add(std::uint64_t(TAG_STRING));
+            params_hasher.add(std::string_view(param.get_ref<const std::string&>()));
+            break;
+        case JSON::value_t::boolean:
+            params_hasher.add(std::uint64_t(TAG_BOOL));
+            params_hasher.add(std::uint64_t(param.get<bool>()));
+            break;
+        default:
+            params_hasher.add(std::uint64_t(TAG_NULL));
+            break;
+    }
+}
+
+// With structure_hasher null only the parameters are visited
+inline void hash_json(const JSON& value, Hasher64* structure_hasher, Hasher64& params_hasher)
+{
+    switch (value.type()) {
+        case JSON::value_t::object:
+            if (structure_hasher) {
+                structure_hasher->add(std::uint64_t(TAG_OBJECT));
+                structure_hasher->add(std::uint64_t(value.size()));
+            }
+            for (const auto& [key, field] : value.items()) {
+                if (key == "params" && field.is_array()) {
+                    if (structure_hasher) {
+                        structure_hasher->add(std::uint64_t(TAG_PARAMS));
+                        structure_hasher->add(std::uint64_t(field.size()));
+                    }
+                    for (const auto& param : field)
+                        hash_param(param, params_hasher);
+                    continue;
+                }
+                if (structure_hasher)
+                    structure_hasher->add(std::string_view(key));
+                hash_json(field, structure_hasher, params_hasher);
+            }
+            return;
+        case JSON::value_t::array:
+            if (structure_hasher) {
+                structure_hasher->add(std::uint64_t(TAG_ARRAY));
+                structure_hasher->add(std::uint64_t(value.size()));
+            }
+            for (const auto& element : value)
+                hash_json(element, structure_hasher, params_hasher);
+            return;
+        default:
+            break;
+    }
+
+    if (!structure_hasher)
+        return;
+    switch (value.type()) {
+        case JSON::value_t::string:
+            structure_hasher->add(std::uint64_t(TAG_STRING));
+            structure_hasher->add(std::string_view(value.get_ref<const std::string&>()));
+            break;
+        case JSON::value_t::boolean:
+            structure_hasher->add(std::uint64_t(TAG_BOOL));
+            structure_hasher->add(std::uint64_t(value.get<bool>()));
+            break;
+        case JSON::value_t::number_integer:
+        case JSON::value_t::number_unsigned:
+            structure_hasher->add(std::uint64_t(TAG_INT));
+            structure_hasher->add(static_cast<std::uint64_t>(value.get<std::int64_t>()));
+            break;
+        case JSON::value_t::number_float:
+            structure_hasher->add(std::uint64_t(TAG_FLOAT));
+            structure_hasher->add(value.get<double>());
+            break;
+        default:
+            structure_hasher->add(std::uint64_t(TAG_NULL));
+            break;
+    }
+}
+
+} // End of detail namespace
+
+inline CircuitHash hash_circuit(const JSON& instructions, const JSON& config)
+{
+    Hasher64 structure_hasher, params_hasher;
+    for (const auto* key : {"num_qubits", "num_clbits"})
+        structure_hasher.add(config.contains(key) ? config.at(key).get<std::uint64_t>() : std::uint64_t(0));
+    detail::hash_json(instructions, &structure_hasher, params_hasher);
+    return {structure_hasher.digest(), params_hasher.digest()};
+}
+
+// Only the params hash, for parameter updates of an already hashed circuit
+inline std::uint64_t hash_circuit_params(const JSON& instructions)
+{
+    Hasher64 params_hasher;
+    detail::hash_json(instructions, nullptr, params_hasher);
+    return params_hasher.digest();
+}
+
+// Structure and params of a single instruction in one hash
+inline std::uint64_t hash_instruction(const JSON& instruction)
+{
+    Hasher64 structure_hasher, params_hasher;
+    detail::hash_json(instruction, &structure_hasher, params_hasher);
+    structure_hasher.add(params_hasher.digest());
+    return structure_hasher.digest();
+}
+
+// Fixed width hexadecimal, JSON numbers lose precision beyond 2^53 in most clients
+inline std::string hash_to_hex(std::uint64_t hash)
+{
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+} // End of cunqa namespace
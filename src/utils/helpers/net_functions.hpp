@@ -188,5 +188,15 @@ inline std::string get_IP_address() {
     freeifaddrs(ifaddr);
 
     if (best_mbps > 0 && !best_ip.empty()) return best_ip;
-    else return "";
+
+    // On a SLURM node the QPUs must be reachable from the other nodes, so
+    // loopback is no answer there
+    if (std::getenv("SLURMD_NODENAME")) {
+        LOGGER_ERROR("No network interface of node {} reports its link speed, unable to choose the IP of the QPU.", get_nodename());
+        return "";
+    }
+    // No interface reporting its speed outside of SLURM (e.g. qlocal on a
+    // workstation): fall back to loopback so that local deployments still bind
+    LOGGER_WARN("No network interface reports its link speed, binding to 127.0.0.1: only clients on this machine will reach the QPUs.");
+    return "127.0.0.1";
 }
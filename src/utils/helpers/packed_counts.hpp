@@ -0,0 +1,377 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/json.hpp"
+#include "utils/helpers/binary_result.hpp"
+
+namespace cunqa {
+
+// Opt-in compact counts ("result_format": "packed" in the run config)
+inline bool packed_result_requested(const JSON& config)
+{
+    return config.contains("result_format") && config.at("result_format") == "packed";
+}
+
+// Per-shot outcomes ("memory": true in the run config)
+inline bool memory_requested(const JSON& config)
+{
+    return config.contains("memory") && config.at("memory").is_boolean() && config.at("memory").get<bool>();
+}
+
+inline std::size_t outcome_words(std::size_t n_clbits)
+{
+    return std::max<std::size_t>(1, (n_clbits + 63) / 64);
+}
+
+inline void set_outcome_bit(std::uint64_t* words, std::size_t bit)
+{
+    words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+}
+
+// Binary key of an outcome, most significant bit first
+inline std::string outcome_to_bitstring(const std::uint64_t* words, std::size_t n_clbits)
+{
+    std::string bits(n_clbits, '0');
+    for (std::size_t bit = 0; bit < n_clbits; ++bit)
+        if ((words[bit / 64] >> (bit % 64)) & 1)
+            bits[n_clbits - bit - 1] = '1';
+    return bits;
+}
+
+// Parsing of outcome keys into zeroed words
+inline void parse_bitstring(std::string_view bits, std::uint64_t* words, std::size_t n_words)
+{
+    std::size_t bit = 0;
+    for (auto c = bits.rbegin(); c != bits.rend(); ++c) {
+        if (*c == ' ') continue;
+        if (bit >= n_words * 64)
+            throw std::runtime_error("Bitstring wider than the number of clbits.");
+        if (*c == '1')
+            set_outcome_bit(words, bit);
+        ++bit;
+    }
+}
+
+inline void parse_hex(std::string_view hex, std::uint64_t* words, std::size_t n_words)
+{
+    if (hex.rfind("0x", 0) == 0)
+        hex.remove_prefix(2);
+
+    std::size_t bit = 0;
+    for (auto c = hex.rbegin(); c != hex.rend(); ++c, bit += 4) {
+        std::uint64_t value;
+        if (*c >= '0' && *c <= '9') value = *c - '0';
+        else if (*c >= 'a' && *c <= 'f') value = 10 + (*c - 'a');
+        else if (*c >= 'A' && *c <= 'F') value = 10 + (*c - 'A');
+        else throw std::runtime_error("Invalid hexadecimal outcome.");
+        if (value && bit >= n_words * 64)
+            throw std::runtime_error("Hexadecimal outcome wider than the number of clbits.");
+        if (bit < n_words * 64)
+            words[bit / 64] |= value << (bit % 64);
+    }
+}
+
+// Counts of a result, at the top level (CUNQA and Munich) or in the
+// experiment (AER). nullptr if the result has none.
+inline const JSON* counts_of(const JSON& result)
+{
+    if (result.contains("counts"))
+        return &result.at("counts");
+    if (result.contains("results") && result.at("results")[0].at("data").contains("counts"))
+        return &result.at("results")[0].at("data").at("counts");
+    return nullptr;
+}
+
+inline JSON* counts_of(JSON& result)
+{
+    return const_cast<JSON*>(counts_of(static_cast<const JSON&>(result)));
+}
+
+// Words of a binary section of uint64, such as the outcomes and the counts of
+// the packed counts
+inline std::vector<std::uint64_t> section_words(const JSON& section)
+{
+    const auto& bytes = section.at("__binary__").get_binary();
+    std::vector<std::uint64_t> words(bytes.size() / sizeof(std::uint64_t));
+    if (!words.empty())
+        std::memcpy(words.data(), bytes.data(), words.size() * sizeof(std::uint64_t));
+    return words;
+}
+
+// Order of the clbits in the outcomes of a result. The counts of CUNQA and
+// Munich, and every outcome written by the adapters, have clbit 0 as the
+// leftmost character of the key (the most significant bit of the packed
+// outcome). The experiments of AER ("results" in the result) keep the order
+// of AER, with clbit 0 as the rightmost character (the least significant bit).
+inline bool clbit0_leftmost(const JSON& result)
+{
+    return !result.contains("results");
+}
+
+// Reverses the first n_bits of an outcome, bit i moving to n_bits - i - 1
+inline void reverse_outcome(std::uint64_t* words, std::size_t n_bits)
+{
+    for (std::size_t i = 0, j = n_bits; i + 1 < j; ++i) {
+        --j;
+        const bool low = (words[i / 64] >> (i % 64)) & 1, high = (words[j / 64] >> (j % 64)) & 1;
+        if (low != high) {
+            words[i / 64] ^= std::uint64_t(1) << (i % 64);
+            words[j / 64] ^= std::uint64_t(1) << (j % 64);
+        }
+    }
+}
+
+// Counts accumulated as integer outcomes instead of bitstring keys. The
+// outcome of a bitstring is its value read as a binary number (leftmost
+// character is the most significant bit), so decoding it with the width
+// n_clbits gives back exactly the key the JSON counts would have. Outcomes of
+// more than 64 bits are stored as ceil(n_clbits/64) little-endian words.
+//
+// to_json() returns the "packed_counts" entry of the result, with the outcomes
+// and the counts as parallel binary sections sorted by outcome.
+class PackedCounts {
+public:
+    explicit PackedCounts(std::size_t n_clbits) :
+        n_clbits_{n_clbits},
+        n_words_{outcome_words(n_clbits)}
+    { }
+
+    std::size_t n_clbits() const { return n_clbits_; }
+    std::size_t n_words() const { return n_words_; }
+    std::size_t size() const { return n_words_ == 1 ? single_.size() : multi_.size(); }
+
+    void add(const std::uint64_t* words, std::size_t count = 1)
+    {
+        if (n_words_ == 1)
+            single_[words[0]] += count;
+        else
+            multi_[std::vector<std::uint64_t>(words, words + n_words_)] += count;
+    }
+
+    void reserve(std::size_t n_outcomes)
+    {
+        if (n_words_ == 1)
+            single_.reserve(n_outcomes);
+    }
+
+    void add(std::uint64_t outcome, std::size_t count = 1)
+    {
+        if (n_words_ != 1)
+            throw std::runtime_error("Single word outcome added to counts of more than 64 bits.");
+        single_[outcome] += count;
+    }
+
+    // Binary key, as in the JSON counts. Spaces between registers are skipped.
+    void add_bitstring(std::string_view bits, std::size_t count = 1)
+    {
+        std::vector<std::uint64_t> words(n_words_, 0);
+        parse_bitstring(bits, words.data(), n_words_);
+        add(words.data(), count);
+    }
+
+    // Hexadecimal key, as AER reports its counts
+    void add_hex(std::string_view hex, std::size_t count = 1)
+    {
+        std::vector<std::uint64_t> words(n_words_, 0);
+        parse_hex(hex, words.data(), n_words_);
+        add(words.data(), count);
+    }
+
+    JSON to_json() const
+    {
+        std::vector<std::uint64_t> outcomes, counts;
+        outcomes.reserve(size() * n_words_);
+        counts.reserve(size());
+
+        if (n_words_ == 1) {
+            std::vector<std::pair<std::uint64_t, std::size_t>> sorted(single_.begin(), single_.end());
+            std::sort(sorted.begin(), sorted.end());
+            for (const auto& [outcome, count] : sorted) {
+                outcomes.push_back(outcome);
+                counts.push_back(count);
+            }
+        } else {
+            // Words are stored from the least significant, so the map is
+            // ordered by comparing the reversed words
+            std::vector<const std::pair<const std::vector<std::uint64_t>, std::size_t>*> sorted;
+            sorted.reserve(multi_.size());
+            for (const auto& entry : multi_)
+                sorted.push_back(&entry);
+            std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) {
+                return std::lexicographical_compare(a->first.rbegin(), a->first.rend(), b->first.rbegin(), b->first.rend());
+            });
+            for (const auto* entry : sorted) {
+                outcomes.insert(outcomes.end(), entry->first.begin(), entry->first.end());
+                counts.push_back(entry->second);
+            }
+        }
+
+        std::vector<std::size_t> shape = {counts.size()};
+        if (n_words_ > 1)
+            shape.push_back(n_words_);
+
+        return {
+            {"n_clbits", n_clbits_},
+            {"outcomes", binary::section(outcomes, shape)},
+            {"counts", binary::section(counts)}
+        };
+    }
+
+    // Counts with binary keys, for the JSON result
+    std::map<std::string, std::size_t> to_bitstrings() const
+    {
+        std::map<std::string, std::size_t> counts;
+        if (n_words_ == 1)
+            for (const auto& [outcome, count] : single_)
+                counts[outcome_to_bitstring(&outcome, n_clbits_)] = count;
+        else
+            for (const auto& [outcome, count] : multi_)
+                counts[outcome_to_bitstring(outcome.data(), n_clbits_)] = count;
+        return counts;
+    }
+
+    // From JSON-like counts with binary keys. The width is the one of the keys.
+    template<typename Counts>
+    static PackedCounts from_bitstrings(const Counts& counts, std::size_t n_clbits = 0)
+    {
+        for (const auto& [key, _] : counts) {
+            n_clbits = std::count_if(key.begin(), key.end(), [](char c) { return c != ' '; });
+            break;
+        }
+        PackedCounts packed(n_clbits);
+        for (const auto& [key, count] : counts)
+            packed.add_bitstring(key, count);
+        return packed;
+    }
+
+    static PackedCounts from_bitstrings(const JSON& counts, std::size_t n_clbits = 0)
+    {
+        for (const auto& [key, _] : counts.items()) {
+            n_clbits = std::count_if(key.begin(), key.end(), [](char c) { return c != ' '; });
+            break;
+        }
+        PackedCounts packed(n_clbits);
+        for (const auto& [key, count] : counts.items())
+            packed.add_bitstring(key, count.get<std::size_t>());
+        return packed;
+    }
+
+private:
+    std::size_t n_clbits_;
+    std::size_t n_words_;
+    std::unordered_map<std::uint64_t, std::size_t> single_;
+    std::map<std::vector<std::uint64_t>, std::size_t> multi_;
+};
+
+// Per-shot outcomes as packed rows of ceil(n_clbits/64) words, in a buffer
+// allocated once for all the shots. Rows use the same layout as the outcomes
+// of PackedCounts. to_json() returns the "memory" entry of the result, always
+// as a binary section of shape (shots, words).
+class PackedMemory {
+public:
+    PackedMemory(std::size_t shots, std::size_t n_clbits) :
+        shots_{shots},
+        n_clbits_{n_clbits},
+        n_words_{outcome_words(n_clbits)},
+        rows_(shots * n_words_, 0)
+    { }
+
+    std::size_t n_words() const { return n_words_; }
+    std::uint64_t* row(std::size_t shot) { return rows_.data() + shot * n_words_; }
+    const std::uint64_t* row(std::size_t shot) const { return rows_.data() + shot * n_words_; }
+
+    JSON to_json() const
+    {
+        return {
+            {"n_clbits", n_clbits_},
+            {"rows", binary::section(rows_, {shots_, n_words_})}
+        };
+    }
+
+private:
+    std::size_t shots_;
+    std::size_t n_clbits_;
+    std::size_t n_words_;
+    std::vector<std::uint64_t> rows_;
+};
+
+// Gathers the outcome rows produced by the per-shot interpreters (the
+// dynamic simulate() of the adapters) into the counts and, if requested, the
+// memory of the result:
+//
+//     ShotResults shot_results(config, n_clbits, shots);
+//     for (std::size_t i = 0; i < shots; i++)
+//         execute_shot_(..., shot_results.row(i));
+//     JSON result = shot_results.to_json(time_taken);
+//
+// No string is built per shot; the JSON counts keys are only built once per
+// distinct outcome at the end.
+class ShotResults {
+public:
+    ShotResults(const JSON& config, std::size_t n_clbits, std::size_t shots) :
+        packed_{packed_result_requested(config)},
+        memory_{memory_requested(config)},
+        counts_{n_clbits},
+        shot_memory_{memory_ ? shots : 0, n_clbits},
+        scratch_(outcome_words(n_clbits), 0)
+    { }
+
+    // Zeroed row where the outcome of the shot has to be written
+    std::uint64_t* row(std::size_t shot)
+    {
+        flush_();
+        current_ = memory_ ? shot_memory_.row(shot) : scratch_.data();
+        std::fill(current_, current_ + counts_.n_words(), 0);
+        return current_;
+    }
+
+    bool memory() const { return memory_; }
+
+    // Several shots with the same outcome, only for results without memory
+    void add(const std::uint64_t* words, std::size_t count)
+    {
+        flush_();
+        counts_.add(words, count);
+    }
+
+    void reserve_outcomes(std::size_t n_outcomes) { counts_.reserve(n_outcomes); }
+
+    JSON to_json(float time_taken)
+    {
+        flush_();
+        JSON result = {{"time_taken", time_taken}};
+        if (packed_)
+            result["packed_counts"] = counts_.to_json();
+        else
+            result["counts"] = counts_.to_bitstrings();
+        if (memory_)
+            result["memory"] = shot_memory_.to_json();
+        return result;
+    }
+
+private:
+    bool packed_;
+    bool memory_;
+    PackedCounts counts_;
+    PackedMemory shot_memory_;
+    std::vector<std::uint64_t> scratch_;
+    std::uint64_t* current_ = nullptr;
+
+    void flush_()
+    {
+        if (current_)
+            counts_.add(current_);
+        current_ = nullptr;
+    }
+};
+
+} // End of cunqa namespace
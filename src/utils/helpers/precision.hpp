@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "utils/json.hpp"
+
+namespace cunqa {
+
+// Floating point precision of the simulated state ("precision" in the run
+// config), "double" (complex128 amplitudes, the default) or "single"
+// (complex64). Single precision halves the memory of the state, so one more
+// qubit fits, and roughly doubles the speed of the memory bound gates.
+inline std::string run_precision(const JSON& config)
+{
+    if (!config.contains("precision") || config.at("precision").is_null())
+        return "double";
+
+    const auto& precision = config.at("precision");
+    if (precision == "double" || precision == "single")
+        return precision.get<std::string>();
+    throw std::runtime_error("precision must be \"double\" or \"single\".");
+}
+
+} // End of cunqa namespace
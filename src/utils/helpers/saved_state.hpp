@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "utils/json.hpp"
+#include "utils/helpers/binary_result.hpp"
+
+// Final state of the simulation ("save_state" in the run config). It is added
+// to the result as
+//
+//     "state": {"type": "statevector" | "density_matrix" | "mps",
+//               "n_qubits": n,
+//               "data": section}
+//
+// where the data of a statevector is a complex section of shape (2^n,), the one
+// of a density matrix is row-major of shape (2^n, 2^n) and the one of an MPS
+// is {"tensors": [[G0, G1], ...], "lambdas": [l, ...]} with a section for each
+// matrix. Amplitudes are indexed with qubit 0 as the least significant bit.
+//
+// With "save_state_compression": "zlib" the bytes of every section are
+// compressed and the section carries "compression" and "raw_nbytes".
+
+namespace cunqa {
+
+// Empty if no state was requested. "save_state": true stands for the statevector.
+inline std::string saved_state_type(const JSON& config)
+{
+    if (!config.contains("save_state"))
+        return "";
+
+    const auto& save_state = config.at("save_state");
+    if (save_state.is_boolean())
+        return save_state.get<bool>() ? "statevector" : "";
+    if (save_state.is_string()) {
+        auto type = save_state.get<std::string>();
+        if (type == "statevector" || type == "density_matrix" || type == "mps")
+            return type;
+    }
+    throw std::runtime_error("save_state must be true, \"statevector\", \"density_matrix\" or \"mps\".");
+}
+
+namespace detail {
+
+inline JSON compress_section(JSON section, const JSON& config)
+{
+    if (!config.contains("save_state_compression") || config.at("save_state_compression").is_null())
+        return section;
+    if (config.at("save_state_compression") != "zlib")
+        throw std::runtime_error("Unknown save_state_compression, only \"zlib\" is supported.");
+
+    auto& raw = section.at("__binary__").get_binary();
+    uLongf compressed_size = compressBound(raw.size());
+    std::vector<std::uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK)
+        throw std::runtime_error("Error compressing the saved state.");
+    compressed.resize(compressed_size);
+
+    const auto subtype = raw.subtype();
+    const auto raw_nbytes = raw.size();
+    section["__binary__"] = JSON::binary(std::move(compressed), subtype);
+    section["compression"] = "zlib";
+    section["raw_nbytes"] = raw_nbytes;
+    return section;
+}
+
+// AER reports complex numbers as [re, im] pairs
+inline bool is_json_complex(const JSON& j)
+{
+    return j.is_array() && j.size() == 2 && j[0].is_number() && j[1].is_number();
+}
+
+inline void flatten_json_complex(const JSON& j, std::vector<std::complex<double>>& out, std::vector<std::size_t>& shape, std::size_t depth)
+{
+    if (is_json_complex(j)) {
+        out.emplace_back(j[0].get<double>(), j[1].get<double>());
+        return;
+    }
+    if (!j.is_array())
+        throw std::runtime_error("Unexpected value in a saved state.");
+    if (shape.size() == depth)
+        shape.push_back(j.size());
+    else if (shape[depth] != j.size())
+        throw std::runtime_error("Saved state with ragged dimensions.");
+    for (const auto& value : j)
+        flatten_json_complex(value, out, shape, depth + 1);
+}
+
+} // End of detail namespace
+
+template<typename T>
+JSON state_section(const T* data, std::size_t size, std::vector<std::size_t> shape, const JSON& config)
+{
+    return detail::compress_section(binary::section(data, size, std::move(shape)), config);
+}
+
+template<typename T>
+JSON state_section(const std::vector<T>& data, std::vector<std::size_t> shape, const JSON& config)
+{
+    return state_section(data.data(), data.size(), std::move(shape), config);
+}
+
+// Section from a nested JSON array of [re, im] pairs, as saved by AER
+inline JSON state_section_from_json(const JSON& values, const JSON& config)
+{
+    std::vector<std::complex<double>> data;
+    std::vector<std::size_t> shape;
+    detail::flatten_json_complex(values, data, shape, 0);
+    return state_section(data, shape, config);
+}
+
+inline JSON saved_state(const std::string& type, std::size_t n_qubits, JSON data)
+{
+    return {
+        {"type", type},
+        {"n_qubits", n_qubits},
+        {"data", std::move(data)}
+    };
+}
+
+} // End of cunqa namespace
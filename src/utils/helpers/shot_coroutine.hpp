@@ -0,0 +1,67 @@
+#pragma once
+
+#include <utility>
+#include <exception>
+#include <coroutine>
+
+// Coroutine of one shot of a per-shot interpreter. It starts suspended and
+// suspends itself (co_await std::suspend_always{}) while it waits for a
+// measurement of another QPU, so that the caller can resume other shots in
+// the meantime. An exception thrown in the shot is rethrown by resume().
+//
+//     ShotCoroutine shot = execute_shot_(...);
+//     while (!shot.done()) {
+//         shot.resume();
+//         ...
+//     }
+
+namespace cunqa {
+
+class ShotCoroutine {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        ShotCoroutine get_return_object() { return ShotCoroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    ShotCoroutine() = default;
+    ShotCoroutine(ShotCoroutine&& other) noexcept : handle_{std::exchange(other.handle_, nullptr)} { }
+    ShotCoroutine& operator=(ShotCoroutine&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ShotCoroutine(const ShotCoroutine&) = delete;
+    ShotCoroutine& operator=(const ShotCoroutine&) = delete;
+    ~ShotCoroutine()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    bool valid() const { return static_cast<bool>(handle_); }
+    bool done() const { return !handle_ || handle_.done(); }
+
+    void resume()
+    {
+        handle_.resume();
+        if (handle_.done() && handle_.promise().exception)
+            std::rethrow_exception(handle_.promise().exception);
+    }
+
+private:
+    explicit ShotCoroutine(std::coroutine_handle<promise_type> handle) : handle_{handle} { }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+} // End of cunqa namespace
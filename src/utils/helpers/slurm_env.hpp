@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+
+// SLURM environment getters. Outside of a SLURM allocation (e.g. when the
+// QPUs are raised with qlocal) the variables may be missing, so every getter
+// falls back to a value that keeps the IDs of the processes unique.
+
+inline std::string get_env_or(const char* name, const std::string& fallback)
+{
+    const char* value = std::getenv(name);
+    return value ? std::string(value) : fallback;
+}
+
+inline std::string get_job_id()
+{
+    return get_env_or("SLURM_JOB_ID", "local");
+}
+
+inline std::string get_proc_id()
+{
+    return get_env_or("SLURM_PROCID", "0");
+}
+
+inline std::string get_task_pid()
+{
+    return get_env_or("SLURM_TASK_PID", std::to_string(getpid()));
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <map>
+#include <array>
+#include <random>
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <algorithm>
+
+#include "utils/json.hpp"
+#include "utils/helpers/circuit_hash.hpp"
+#include "utils/helpers/packed_counts.hpp"
+#include "utils/helpers/thread_pool.hpp"
+
+// Sampling of the final measurements of a static circuit from its statevector,
+// shared by the simulators that can hand their dense state. The probabilities
+// are first reduced to the marginal of the measured qubits when there are few
+// of them. The outcomes are split in chunks whose total probabilities (a
+// parallel prefix sum) give the shots of each chunk as a chain of binomial
+// draws; every chunk then draws its shots as sorted uniforms, from cumulative
+// sums of exponential spacings, and walks its cumulative probabilities once.
+// The shots land directly as integer counts of each outcome, and the memory,
+// if requested, gets them in random order. Chunks are seeded from the seed
+// and their index, so the outcomes do not depend on the number of threads.
+
+namespace cunqa {
+
+// Start of the measurements of a circuit made of gates followed only by
+// measurements (the whole circuit if it has none), nullopt if a measurement
+// comes before a gate or an instruction is conditional
+inline std::optional<std::size_t> final_measurements_start(const JSON& circuit)
+{
+    std::optional<std::size_t> start;
+    for (std::size_t i = 0; i < circuit.size(); i++) {
+        const auto& instruction = circuit[i];
+        if (instruction.contains("conditional_reg") || instruction.contains("remote_conditional_reg"))
+            return std::nullopt;
+        if (instruction.at("name") == "measure") {
+            if (!start)
+                start = i;
+        } else if (start) {
+            return std::nullopt;
+        }
+    }
+    return start.value_or(circuit.size());
+}
+
+// (qubit, clbit) of the measurements circuit[from, end) into the n_clbits.
+// A clbit measured twice keeps the last measurement, as in the per-shot runs.
+inline std::vector<std::pair<std::size_t, std::size_t>> measured_bits(const JSON& circuit, std::size_t from, std::size_t n_clbits)
+{
+    std::map<std::size_t, std::size_t> qubit_of;
+    for (std::size_t i = from; i < circuit.size(); i++) {
+        auto clbit = circuit[i].at("clbits")[0].get<std::size_t>();
+        if (clbit < n_clbits)
+            qubit_of[clbit] = circuit[i].at("qubits")[0].get<std::size_t>();
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> measurements;
+    for (const auto& [clbit, qubit] : qubit_of)
+        measurements.emplace_back(qubit, clbit);
+    return measurements;
+}
+
+namespace detail {
+
+constexpr std::size_t SAMPLING_CHUNK = std::size_t(1) << 16;
+// Marginals are accumulated over a fixed number of slices of the state, each
+// one in its own copy, so they stay small
+constexpr std::size_t MAX_MARGINAL_QUBITS = 20;
+constexpr std::size_t MAX_MARGINAL_SLICES = 16;
+
+// Index of the marginal outcome of a basis state (bit j is the j-th measured
+// qubit), with one lookup table per byte of the basis state
+class BitGather {
+public:
+    BitGather(const std::vector<std::size_t>& qubits, std::size_t n_qubits) :
+        tables_((n_qubits + 7) / 8)
+    {
+        for (auto& table : tables_)
+            table.fill(0);
+        for (std::size_t j = 0; j < qubits.size(); j++)
+            for (std::size_t value = 0; value < 256; value++)
+                if ((value >> (qubits[j] % 8)) & 1)
+                    tables_[qubits[j] / 8][value] |= std::uint64_t(1) << j;
+    }
+
+    std::uint64_t operator()(std::uint64_t basis_state) const
+    {
+        std::uint64_t outcome = 0;
+        for (std::size_t b = 0; b < tables_.size(); b++)
+            outcome |= tables_[b][(basis_state >> (8 * b)) & 0xff];
+        return outcome;
+    }
+
+private:
+    std::vector<std::array<std::uint64_t, 256>> tables_;
+};
+
+} // End of detail namespace
+
+template<typename T>
+void sample_statevector(const std::complex<T>* state, std::size_t n_qubits, const std::vector<std::pair<std::size_t, std::size_t>>& measurements,
+                        std::size_t n_clbits, std::size_t shots, std::uint64_t seed, ShotResults& shot_results)
+{
+    using detail::SAMPLING_CHUNK;
+
+    // Measured qubits and the bits of the outcome row each one sets, in the
+    // bit order of the counts keys
+    std::vector<std::size_t> qubits;
+    std::vector<std::vector<std::size_t>> row_bits;
+    for (const auto& [qubit, clbit] : measurements) {
+        auto found = std::find(qubits.begin(), qubits.end(), qubit);
+        if (found == qubits.end()) {
+            qubits.push_back(qubit);
+            row_bits.emplace_back();
+            found = qubits.end() - 1;
+        }
+        row_bits[found - qubits.begin()].push_back(n_clbits - clbit - 1);
+    }
+    const std::size_t k = qubits.size();
+    const std::size_t size = std::size_t(1) << n_qubits;
+
+    // Probabilities of the outcomes, the marginal or the ones of the basis states
+    const bool marginal = k < n_qubits && k <= detail::MAX_MARGINAL_QUBITS;
+    std::vector<double> marginal_p;
+    if (marginal) {
+        const detail::BitGather gather(qubits, n_qubits);
+        const std::size_t n_slices = std::clamp<std::size_t>(size >> (k + 4), 1, detail::MAX_MARGINAL_SLICES);
+        std::vector<std::vector<double>> partial(n_slices);
+        parallel_for_each_index(n_slices, [&](std::size_t s) {
+            partial[s].assign(std::size_t(1) << k, 0.0);
+            for (std::size_t i = s * size / n_slices; i < (s + 1) * size / n_slices; i++)
+                partial[s][gather(i)] += std::norm(std::complex<double>(state[i]));
+        });
+        marginal_p = std::move(partial[0]);
+        for (std::size_t s = 1; s < n_slices; s++)
+            for (std::size_t o = 0; o < marginal_p.size(); o++)
+                marginal_p[o] += partial[s][o];
+    }
+    const std::size_t n_outcomes = marginal ? marginal_p.size() : size;
+    auto probability = [&](std::size_t o) { return marginal ? marginal_p[o] : std::norm(std::complex<double>(state[o])); };
+    auto to_row = [&](std::uint64_t o, std::uint64_t* row) {
+        for (std::size_t j = 0; j < k; j++)
+            if ((o >> (marginal ? j : qubits[j])) & 1)
+                for (auto bit : row_bits[j])
+                    set_outcome_bit(row, bit);
+    };
+
+    // Total of every chunk and shots that fall in it
+    const std::size_t n_chunks = (n_outcomes + SAMPLING_CHUNK - 1) / SAMPLING_CHUNK;
+    std::vector<double> totals(n_chunks, 0.0);
+    parallel_for_each_index(n_chunks, [&](std::size_t c) {
+        for (std::size_t o = c * SAMPLING_CHUNK; o < std::min(n_outcomes, (c + 1) * SAMPLING_CHUNK); o++)
+            totals[c] += probability(o);
+    });
+    std::size_t last = n_chunks - 1;
+    while (last > 0 && totals[last] == 0.0)
+        last--;
+    double remaining_p = 0.0;
+    for (auto total : totals)
+        remaining_p += total;
+
+    std::mt19937_64 rng(seed);
+    std::vector<std::size_t> chunk_shots(n_chunks, 0);
+    std::size_t remaining = shots;
+    for (std::size_t c = 0; c < last && remaining > 0; c++) {
+        if (totals[c] > 0.0) {
+            std::binomial_distribution<std::size_t> binomial(remaining, std::min(1.0, totals[c] / remaining_p));
+            chunk_shots[c] = binomial(rng);
+            remaining -= chunk_shots[c];
+        }
+        remaining_p -= totals[c];
+    }
+    chunk_shots[last] += remaining;
+
+    // Sorted uniforms in [0, total) of every chunk, walked along its cumulative probabilities
+    std::vector<std::vector<std::pair<std::uint64_t, std::size_t>>> chunk_counts(n_chunks);
+    parallel_for_each_index(n_chunks, [&](std::size_t c) {
+        const std::size_t n = chunk_shots[c];
+        if (n == 0)
+            return;
+        Hasher64 hasher(seed);
+        hasher.add(static_cast<std::uint64_t>(c));
+        std::mt19937_64 chunk_rng(hasher.digest());
+        std::exponential_distribution<double> exponential(1.0);
+        std::vector<double> draws(n);
+        double sum = 0.0;
+        for (auto& draw : draws)
+            draw = sum += exponential(chunk_rng);
+        const double scale = totals[c] / (sum + exponential(chunk_rng));
+
+        std::size_t next = 0, last_nonzero = c * SAMPLING_CHUNK;
+        double cumulative = 0.0;
+        for (std::size_t o = c * SAMPLING_CHUNK; o < std::min(n_outcomes, (c + 1) * SAMPLING_CHUNK) && next < n; o++) {
+            const double p = probability(o);
+            if (p == 0.0)
+                continue;
+            cumulative += p;
+            last_nonzero = o;
+            std::size_t count = 0;
+            while (next < n && draws[next] * scale < cumulative) {
+                count++;
+                next++;
+            }
+            if (count)
+                chunk_counts[c].emplace_back(o, count);
+        }
+        // Rounding of the cumulative sum
+        if (next < n) {
+            if (!chunk_counts[c].empty() && chunk_counts[c].back().first == last_nonzero)
+                chunk_counts[c].back().second += n - next;
+            else
+                chunk_counts[c].emplace_back(last_nonzero, n - next);
+        }
+    });
+
+    if (!shot_results.memory()) {
+        std::size_t n_distinct = 0;
+        for (const auto& counts : chunk_counts)
+            n_distinct += counts.size();
+        shot_results.reserve_outcomes(n_distinct);
+        std::vector<std::uint64_t> row(outcome_words(n_clbits));
+        for (const auto& counts : chunk_counts) {
+            for (const auto& [o, count] : counts) {
+                std::fill(row.begin(), row.end(), 0);
+                to_row(o, row.data());
+                shot_results.add(row.data(), count);
+            }
+        }
+        return;
+    }
+
+    std::vector<std::uint64_t> outcomes;
+    outcomes.reserve(shots);
+    for (const auto& counts : chunk_counts)
+        for (const auto& [o, count] : counts)
+            outcomes.insert(outcomes.end(), count, o);
+    std::shuffle(outcomes.begin(), outcomes.end(), rng);
+    for (std::size_t shot = 0; shot < shots; shot++)
+        to_row(outcomes[shot], shot_results.row(shot));
+}
+
+} // End of cunqa namespace
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <exception>
+#include <sched.h>
+
+namespace cunqa {
+
+namespace detail {
+inline thread_local bool in_thread_pool = false;
+}
+
+// CPUs this process may run on. Under SLURM these are the ones of its cpuset
+// (--cpus-per-task), not every core of the node as hardware_concurrency().
+inline std::size_t available_cpus()
+{
+    static const std::size_t cpus = [] {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+            return static_cast<std::size_t>(CPU_COUNT(&set));
+        return static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency()));
+    }();
+    return cpus;
+}
+
+// Whether the caller is a task of parallel_for_each_index
+inline bool inside_thread_pool()
+{
+    return detail::in_thread_pool;
+}
+
+// Runs task(i) for every i in [0, n) on a pool of up to n_threads threads
+// (the available CPUs by default). Every thread takes the next index when it
+// finishes the previous one, so tasks of uneven cost are balanced. Calls made
+// from a task run serially in its thread, as the pool already fills the CPUs.
+// The first exception thrown by a task is rethrown once all have finished.
+template<typename Task>
+void parallel_for_each_index(std::size_t n, Task&& task, std::size_t n_threads = 0)
+{
+    if (n_threads == 0)
+        n_threads = available_cpus();
+    n_threads = std::min(n_threads, n);
+
+    if (n_threads <= 1 || inside_thread_pool()) {
+        for (std::size_t i = 0; i < n; i++)
+            task(i);
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        detail::in_thread_pool = true;
+        for (std::size_t i = next++; i < n; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        detail::in_thread_pool = false;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (std::size_t t = 1; t < n_threads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+} // End of cunqa namespace
@@ -8,6 +8,7 @@
 #include <stdexcept>
 
 #include "json.hpp"
+#include "helpers/slurm_env.hpp"
 
 namespace {
 
@@ -107,10 +108,8 @@ void write_on_file(JSON local_data, const std::string &filename, const std::stri
         auto j = read_json(fd);
 
         // Get key and add data
-        const char *pid_env = std::getenv("SLURM_TASK_PID");
-        const char *job_env = std::getenv("SLURM_JOB_ID");
-        std::string local_id = pid_env ? pid_env : "UNKNOWN";
-        std::string job_id = job_env ? job_env : "UNKNOWN";
+        std::string local_id = get_task_pid();
+        std::string job_id = get_job_id();
         std::string task_id =
             (suffix.empty()) ? (job_id + "_" + local_id)
                              : (job_id + "_" + local_id + "_" + suffix);
@@ -1,4 +1,5 @@
 #include "logger.hpp"
+#include "utils/helpers/slurm_env.hpp"
 #include <string>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
@@ -8,7 +9,7 @@ std::shared_ptr<spdlog::logger> logger;
 
 __attribute__((constructor)) void initializeLogger() {
     // QClient logger initialization
-    std::string id = std::getenv("SLURM_JOB_ID");
+    std::string id = get_job_id();
     std::string qpu_name = "executor_logger_"s + id;
     logger = spdlog::stdout_color_mt(qpu_name);
     logger->set_level(spdlog::level::debug);